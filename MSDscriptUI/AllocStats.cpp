@@ -0,0 +1,154 @@
+#include "AllocStats.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+/**
+ * \file AllocStats.cpp
+ * \brief contains the registry of class counters and the report
+ *
+ * Counters are only ever added, and they are updated with atomics, so objects can be made on any thread.
+ */
+
+
+static std::mutex registry_lock; ///< guards the list of counters
+static AllocCounter *counters = nullptr; ///< every registered class, most recent first
+static std::atomic<size_t> live_bytes(0); ///< bytes of all objects constructed and not yet destroyed
+static std::atomic<size_t> peak_bytes(0); ///< highest live_bytes since the last reset
+
+
+/**
+ * \brief Turns a type into the name it has in the source
+ * @param type - the type
+ * @return - the demangled name where the compiler supports it
+ */
+static std::string type_name(const std::type_info &type) {
+#ifdef __GNUG__
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    if ( status == 0 && demangled != nullptr ) {
+        std::string name = demangled;
+        std::free(demangled);
+        return name;
+    }
+#endif
+    return type.name();
+}
+
+
+/**
+ * \brief Adds the counter for a class, called once per class by alloc_counter
+ * @param type - the class
+ * @param size - sizeof the class
+ * @return - the new counter, which is never freed
+ */
+AllocCounter *alloc_stats_register(const std::type_info &type, size_t size) {
+    AllocCounter *counter = new AllocCounter();
+    counter->name = type_name(type);
+    counter->size = size;
+    counter->constructed = 0;
+    counter->destroyed = 0;
+    counter->constructed_at_reset = 0;
+    counter->destroyed_at_reset = 0;
+
+    std::lock_guard<std::mutex> guard(registry_lock);
+    counter->next = counters;
+    counters = counter;
+    return counter;
+}
+
+
+/**
+ * \brief Records that an object was constructed
+ * @param counter - the counter of the object's class
+ */
+void alloc_stats_constructed(AllocCounter &counter) {
+    counter.constructed.fetch_add(1, std::memory_order_relaxed);
+
+    size_t live = live_bytes.fetch_add(counter.size, std::memory_order_relaxed) + counter.size;
+    size_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while ( live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+
+/**
+ * \brief Records that an object was destroyed
+ * @param counter - the counter of the object's class
+ */
+void alloc_stats_destroyed(AllocCounter &counter) {
+    counter.destroyed.fetch_add(1, std::memory_order_relaxed);
+    live_bytes.fetch_sub(counter.size, std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Starts a new measurement, the report only shows what happens after this
+ *
+ * Objects that are still live stay counted as live, the peak starts again from the bytes live right now.
+ */
+void alloc_stats_reset() {
+    std::lock_guard<std::mutex> guard(registry_lock);
+    for ( AllocCounter *counter = counters; counter != nullptr; counter = counter->next ) {
+        counter->constructed_at_reset = counter->constructed;
+        counter->destroyed_at_reset = counter->destroyed;
+    }
+    peak_bytes = live_bytes.load();
+}
+
+
+/**
+ * \brief Describes what was constructed and destroyed since the last reset
+ *
+ * One line per class that did anything, the classes that made the most objects first, then the live and peak
+ * bytes. Objects still live at the end of an evaluation are the ones that outlived it.
+ * @return - the report, one line per class
+ */
+std::string alloc_stats_report() {
+    struct Line {
+        std::string name;
+        size_t constructed;
+        size_t destroyed;
+        size_t live;
+        size_t size;
+    };
+    std::vector<Line> lines;
+
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        for ( AllocCounter *counter = counters; counter != nullptr; counter = counter->next ) {
+            size_t constructed = counter->constructed;
+            size_t destroyed = counter->destroyed;
+            if ( constructed == counter->constructed_at_reset && destroyed == counter->destroyed_at_reset ) {
+                continue;
+            }
+            lines.push_back({counter->name, constructed - counter->constructed_at_reset,
+                             destroyed - counter->destroyed_at_reset, constructed - destroyed, counter->size});
+        }
+    }
+
+    std::sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) {
+        return a.constructed > b.constructed || (a.constructed == b.constructed && a.name < b.name);
+    });
+
+    std::string report;
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%-16s %12s %12s %10s %6s\n", "class", "constructed", "destroyed", "live",
+             "bytes");
+    report += buffer;
+    for ( const Line &line : lines ) {
+        snprintf(buffer, sizeof(buffer), "%-16s %12zu %12zu %10zu %6zu\n", line.name.c_str(), line.constructed,
+                 line.destroyed, line.live, line.size);
+        report += buffer;
+    }
+    snprintf(buffer, sizeof(buffer), "live bytes %zu, peak bytes %zu\n", live_bytes.load(), peak_bytes.load());
+    report += buffer;
+
+    return report;
+}
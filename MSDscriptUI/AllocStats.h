@@ -0,0 +1,183 @@
+#ifndef MSDSCRIPT_ALLOCSTATS_H
+#define MSDSCRIPT_ALLOCSTATS_H
+
+/**
+ * \file AllocStats.h
+ * \brief optional counting of the objects made by NEW(T)
+ *
+ * When USE_ALLOC_STATS is set in pointer.h, NEW(T) also counts every construction and destruction per concrete
+ * class and keeps track of the bytes that are live, and the peak since the last reset. Bytes are sizeof(T) of
+ * the objects, allocator overhead such as the shared_ptr control block is not included.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include "pointer.h"
+
+
+/**
+ * \brief The counts for one class
+ */
+struct AllocCounter {
+    std::string name; ///< readable class name
+    size_t size; ///< sizeof the class
+    std::atomic<size_t> constructed; ///< objects constructed since the program started
+    std::atomic<size_t> destroyed; ///< objects destroyed since the program started
+    size_t constructed_at_reset; ///< constructed at the last alloc_stats_reset
+    size_t destroyed_at_reset; ///< destroyed at the last alloc_stats_reset
+    AllocCounter *next; ///< the next registered class
+};
+
+
+AllocCounter *alloc_stats_register(const std::type_info &type, size_t size);
+
+void alloc_stats_constructed(AllocCounter &counter);
+
+void alloc_stats_destroyed(AllocCounter &counter);
+
+void alloc_stats_reset();
+
+std::string alloc_stats_report();
+
+
+/**
+ * \brief Returns the counter of a class, registering it on first use
+ * @return - the counter for T
+ */
+template<class T>
+AllocCounter &alloc_counter() {
+    static AllocCounter *counter = alloc_stats_register(typeid(T), sizeof(T));
+    return *counter;
+}
+
+
+#if USE_ARENA_POINTERS || USE_GC_POINTERS
+
+/**
+ * \brief The NEW(T) of the arena pointer mode with counting, see arena_new
+ * @param args - the constructor arguments
+ * @return - a pointer to the new object, owned by the arena
+ */
+template<class T, class... Args>
+T *counted_arena_new(Args &&... args) {
+    T *object = arena_new<T>(std::forward<Args>(args)...);
+    alloc_stats_constructed(alloc_counter<T>());
+
+    //runs when the arena is reset, next to the destructor registered by arena_new
+    Arena::current()->register_destructor([](void *) { alloc_stats_destroyed(alloc_counter<T>()); }, object);
+    return object;
+}
+
+# if USE_GC_POINTERS
+
+/**
+ * \brief A collected T that counts its destruction, the heap deletes it through the virtual destructor
+ */
+template<class T>
+class GcCounted : public T {
+public:
+    using T::T;
+
+    ~GcCounted() {
+        alloc_stats_destroyed(alloc_counter<T>());
+    }
+};
+
+
+/**
+ * \brief The NEW(T) of the gc pointer mode with counting, see gc_new
+ * @param args - the constructor arguments
+ * @return - a pointer to the new object, owned by the heap of this thread or by the current arena
+ */
+template<class T, class... Args>
+T *counted_gc_new(Args &&... args) {
+    if constexpr ( std::is_base_of<GcObject, T>::value ) {
+        T *object = gc_new<GcCounted<T>>(std::forward<Args>(args)...);
+        alloc_stats_constructed(alloc_counter<T>());
+        return object;
+    } else {
+        return counted_arena_new<T>(std::forward<Args>(args)...);
+    }
+}
+
+# endif
+
+#elif USE_PLAIN_POINTERS
+
+/**
+ * \brief The NEW(T) of the plain pointer mode with counting, nothing is ever destroyed
+ * @param args - the constructor arguments
+ * @return - a pointer to the new object
+ */
+template<class T, class... Args>
+T *counted_new(Args &&... args) {
+    T *object = new T(std::forward<Args>(args)...);
+    alloc_stats_constructed(alloc_counter<T>());
+    return object;
+}
+
+#else
+
+/**
+ * \brief An allocator for std::allocate_shared that counts the object it constructs and destroys
+ */
+template<class T>
+struct CountingAllocator {
+    typedef T value_type;
+
+    CountingAllocator() = default;
+
+    template<class U>
+    CountingAllocator(const CountingAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, size_t n) {
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    template<class U, class... Args>
+    void construct(U *p, Args &&... args) {
+        ::new((void *) p) U(std::forward<Args>(args)...);
+        alloc_stats_constructed(alloc_counter<U>());
+    }
+
+    template<class U>
+    void destroy(U *p) {
+        p->~U();
+        alloc_stats_destroyed(alloc_counter<U>());
+    }
+
+    template<class U>
+    bool operator==(const CountingAllocator<U> &) const {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const CountingAllocator<U> &) const {
+        return false;
+    }
+};
+
+
+/**
+ * \brief The NEW(T) of the shared_ptr mode with counting, one allocation like std::make_shared
+ * @param args - the constructor arguments
+ * @return - a shared pointer to the new object
+ */
+template<class T, class... Args>
+std::shared_ptr<T> counted_make_shared(Args &&... args) {
+    return std::allocate_shared<T>(CountingAllocator<T>(), std::forward<Args>(args)...);
+}
+
+#endif
+
+
+#endif //MSDSCRIPT_ALLOCSTATS_H
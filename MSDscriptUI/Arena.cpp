@@ -0,0 +1,238 @@
+#include "Arena.h"
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * \file Arena.cpp
+ * \brief contains the implementation of the bump allocator used by the arena pointer mode
+ */
+
+
+/**
+ * \brief Header at the start of every block of arena memory
+ */
+struct Arena::Block {
+    Block *next;
+    size_t size;
+};
+
+
+/**
+ * \brief A destructor to run when the arena is reset, stored inside the arena itself
+ */
+struct Arena::Cleanup {
+    void (*destroy)(void *);
+    void *object;
+    Cleanup *next;
+};
+
+
+static thread_local Arena *current_arena = nullptr;
+
+static const size_t max_block_size = 1 << 20;
+
+
+/**
+ * \brief Constructor for an empty arena, no memory is taken until the first allocation
+ * @param first_block_size - size of the first block, later blocks double up to 1MB
+ */
+Arena::Arena(size_t first_block_size) {
+    this->blocks = nullptr;
+    this->next = nullptr;
+    this->end = nullptr;
+    this->used = 0;
+    this->cleanups = nullptr;
+    this->lock = nullptr;
+    this->first_block_size = first_block_size;
+}
+
+
+/**
+ * \brief Destructor, runs the pending destructors and gives every block back
+ */
+Arena::~Arena() {
+    reset();
+    std::free(blocks);
+}
+
+
+/**
+ * \brief Adds a new block that can hold at least min_size bytes
+ * @param min_size - the size of the allocation that did not fit
+ */
+void Arena::add_block(size_t min_size) {
+    size_t size = blocks == nullptr ? first_block_size : blocks->size * 2;
+    if ( size > max_block_size ) {
+        size = max_block_size;
+    }
+    if ( size < min_size + alignof(std::max_align_t)) {
+        size = min_size + alignof(std::max_align_t);
+    }
+
+    Block *block = static_cast<Block *>(std::malloc(sizeof(Block) + size));
+    if ( block == nullptr ) {
+        throw std::bad_alloc();
+    }
+    block->next = blocks;
+    block->size = size;
+    blocks = block;
+
+    next = reinterpret_cast<char *>(block + 1);
+    end = next + size;
+}
+
+
+/**
+ * \brief Hands out memory from the current block
+ * @param size - number of bytes
+ * @param align - required alignment, a power of two
+ * @return - uninitialized memory that lives until the arena is reset
+ */
+void *Arena::allocate(size_t size, size_t align) {
+    std::unique_lock<std::mutex> guard;
+    if ( lock != nullptr ) {
+        guard = std::unique_lock<std::mutex>(*lock);
+    }
+
+    uintptr_t p = (reinterpret_cast<uintptr_t>(next) + align - 1) & ~(uintptr_t) (align - 1);
+    if ( p + size > reinterpret_cast<uintptr_t>(end)) {
+        add_block(size + align);
+        p = (reinterpret_cast<uintptr_t>(next) + align - 1) & ~(uintptr_t) (align - 1);
+    }
+
+    next = reinterpret_cast<char *>(p + size);
+    used += size;
+    return reinterpret_cast<void *>(p);
+}
+
+
+/**
+ * \brief Records an object whose destructor has to run when the arena is reset
+ * @param destroy - function that runs the destructor
+ * @param object - the object
+ */
+void Arena::register_destructor(void (*destroy)(void *), void *object) {
+    Cleanup *cleanup = static_cast<Cleanup *>(allocate(sizeof(Cleanup), alignof(Cleanup)));
+
+    std::unique_lock<std::mutex> guard;
+    if ( lock != nullptr ) {
+        guard = std::unique_lock<std::mutex>(*lock);
+    }
+    cleanup->destroy = destroy;
+    cleanup->object = object;
+    cleanup->next = cleanups;
+    cleanups = cleanup;
+}
+
+
+/**
+ * \brief Destroys every object in the arena and rewinds it
+ *
+ * Objects are destroyed newest first. The largest block is kept so the next program does not have to go back
+ * to malloc.
+ */
+void Arena::reset() {
+    while ( cleanups != nullptr ) {
+        Cleanup *cleanup = cleanups;
+        cleanups = cleanup->next;
+        cleanup->destroy(cleanup->object);
+    }
+
+    if ( blocks == nullptr ) {
+        return;
+    }
+
+    //an oversized block for one large allocation can be larger than the newer blocks after it
+    Block *largest = blocks;
+    for ( Block *block = blocks->next; block != nullptr; block = block->next ) {
+        if ( block->size > largest->size ) {
+            largest = block;
+        }
+    }
+    while ( blocks != nullptr ) {
+        Block *older = blocks->next;
+        if ( blocks != largest ) {
+            std::free(blocks);
+        }
+        blocks = older;
+    }
+    largest->next = nullptr;
+    blocks = largest;
+
+    next = reinterpret_cast<char *>(blocks + 1);
+    end = next + blocks->size;
+    used = 0;
+}
+
+
+/**
+ * \brief Number of bytes handed out since the last reset
+ * @return - the byte count
+ */
+size_t Arena::bytes_used() const {
+    return used;
+}
+
+
+/**
+ * \brief The arena NEW(T) allocates from on this thread
+ * @return - the innermost ArenaScope's arena, or the global arena outside of any scope
+ */
+Arena *Arena::current() {
+    if ( current_arena != nullptr ) {
+        return current_arena;
+    }
+    return &global();
+}
+
+
+/**
+ * \brief The arena used outside of any ArenaScope, for long lived objects such as Env::empty
+ *
+ * It is never reset and is shared by every thread, so allocations from it take a lock.
+ * @return - the global arena
+ */
+Arena &Arena::global() {
+    static std::mutex global_lock;
+    static Arena *global_arena = [] {
+        Arena *arena = new Arena();
+        arena->lock = &global_lock;
+        return arena;
+    }();
+    return *global_arena;
+}
+
+
+/**
+ * \brief Makes a fresh arena current until the end of the scope
+ */
+ArenaScope::ArenaScope() {
+    this->arena = &own;
+    this->previous = current_arena;
+    this->reset_at_end = true;
+    current_arena = this->arena;
+}
+
+
+/**
+ * \brief Makes an existing arena current until the end of the scope
+ * @param arena - the arena to allocate from, it can be reused for the next scope
+ * @param reset_at_end - false keeps what was allocated, for an arena that holds objects across several scopes
+ */
+ArenaScope::ArenaScope(Arena &arena, bool reset_at_end) {
+    this->arena = &arena;
+    this->previous = current_arena;
+    this->reset_at_end = reset_at_end;
+    current_arena = this->arena;
+}
+
+
+/**
+ * \brief Restores the previous arena and frees everything allocated inside the scope, unless asked not to
+ */
+ArenaScope::~ArenaScope() {
+    current_arena = previous;
+    if ( reset_at_end ) {
+        arena->reset();
+    }
+}
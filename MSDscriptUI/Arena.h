@@ -0,0 +1,105 @@
+#ifndef MSDSCRIPT_ARENA_H
+#define MSDSCRIPT_ARENA_H
+
+/**
+ * \file Arena.h
+ * \brief bump allocator used by the arena pointer mode
+ *
+ * When USE_ARENA_POINTERS is set in pointer.h, NEW(T) places every Expr, Val and Env in the current arena.
+ * Nothing is freed one object at a time, the whole graph goes away when the arena is reset or destroyed.
+ */
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+/**
+ * \brief A region of memory that hands out objects by bumping a pointer
+ */
+class Arena {
+public:
+    explicit Arena(size_t first_block_size = 4096);
+
+    ~Arena();
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t align);
+
+    void register_destructor(void (*destroy)(void *), void *object);
+
+    void reset();
+
+    size_t bytes_used() const;
+
+    static Arena *current();
+
+    static Arena &global();
+
+    friend class ArenaScope;
+
+private:
+    struct Block;
+    struct Cleanup;
+
+    Block *blocks; ///< most recent block first
+    char *next; ///< next free byte in the most recent block
+    char *end; ///< end of the most recent block
+    size_t used; ///< bytes handed out since the last reset
+    Cleanup *cleanups; ///< objects with destructors, most recent first
+    std::mutex *lock; ///< only set for the global arena, which every thread may reach
+    size_t first_block_size; ///< size of the block taken on the first allocation
+
+    void add_block(size_t min_size);
+};
+
+
+/**
+ * \brief Makes an arena current for the lifetime of the scope and frees it at the end
+ *
+ * The previous arena is restored afterwards, so scopes can nest. Values created inside the scope must not be
+ * used after it ends.
+ */
+class ArenaScope {
+public:
+    ArenaScope();
+
+    explicit ArenaScope(Arena &arena, bool reset_at_end = true);
+
+    ~ArenaScope();
+
+    ArenaScope(const ArenaScope &) = delete;
+
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+private:
+    Arena own; ///< used when no arena was passed in
+    Arena *arena; ///< the arena made current
+    Arena *previous; ///< the arena that was current before
+    bool reset_at_end; ///< whether the arena is freed when the scope ends
+};
+
+
+/**
+ * \brief Constructs a T in the current arena, the NEW(T) of the arena pointer mode
+ * @param args - the constructor arguments
+ * @return - a pointer to the new object, owned by the arena
+ */
+template<class T, class... Args>
+T *arena_new(Args &&... args) {
+    Arena *arena = Arena::current();
+    T *object = new(arena->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+    if ( !std::is_trivially_destructible<T>::value ) {
+        arena->register_destructor([](void *p) { static_cast<T *>(p)->~T(); }, object);
+    }
+    return object;
+}
+
+
+#endif //MSDSCRIPT_ARENA_H
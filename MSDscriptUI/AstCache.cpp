@@ -0,0 +1,489 @@
+#include "AstCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "Expr.h"
+#include "FlatAst.h"
+#include "Lexer.h"
+#include "parse.hpp"
+#include "Symbol.h"
+
+#ifndef _WIN32
+# include <sys/stat.h>
+# include <unistd.h>
+#else
+# include <direct.h>
+# include <process.h>
+#endif
+
+/**
+ * \file AstCache.cpp
+ * \brief contains the implementation of the binary encoding of programs and of the cache on disk
+ *
+ * An encoded program is, in the byte order of the machine that wrote it
+ * - the AstHeader
+ * - the name table: name_count, names_size, name_count + 1 offsets into the name bytes, the last one is names_size,
+ *   and names_size bytes of names, not terminated
+ * - the nodes: node_count, then node_count FlatNodes, children before their parents, where the name of a variable,
+ *   _let or _fun is an index into the name table. The rhs of a _fun is no_node, except in a prelude snapshot where
+ *   it can be the body as written of a function whose body was optimized, see FlatNode
+ * - the source the program was parsed from, source_size bytes, not terminated
+ *
+ * Every count and offset is a uint32_t. A file written on a machine with the other byte order does not start with the
+ * magic number and is ignored.
+ */
+
+
+/**
+ * \brief The start of an encoded program
+ */
+struct AstHeader {
+    uint32_t magic; ///< "MSDA" in the byte order of the writer
+    uint32_t version; ///< ast_format_version of the writer
+    uint64_t source_hash; ///< source_hash of the source it was parsed from
+    uint64_t source_size; ///< length of that source
+    uint64_t body_hash; ///< source_hash of everything after the header, so damage anywhere is noticed
+    uint32_t root; ///< the node of the whole program
+    uint32_t reserved; ///< zero
+};
+
+static_assert(sizeof(AstHeader) == 40, "the header is part of the format");
+static_assert(sizeof(FlatNode) == 16, "the nodes are part of the format");
+
+static const uint32_t ast_magic = 0x4144534d;
+
+
+/**
+ * \brief Hashes a source text, the same way on every platform and in every run
+ * @param source - the text
+ * @return - its 64-bit FNV-1a hash
+ */
+uint64_t source_hash(std::string_view source) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for ( char c : source ) {
+        hash ^= (unsigned char) c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+/**
+ * \brief Appends a count or offset to an encoding
+ * @param value - the number
+ * @param image - the encoding
+ */
+static void put_u32(uint32_t value, std::string &image) {
+    image.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+
+/**
+ * \brief Takes a count or offset off the front of an encoding
+ * @param image - what is left of the encoding, advanced past the number
+ * @param value - set to the number
+ * @return - false when the encoding ends first
+ */
+static bool take_u32(std::string_view &image, uint32_t &value) {
+    if ( image.size() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, image.data(), sizeof(value));
+    image.remove_prefix(sizeof(value));
+    return true;
+}
+
+
+/**
+ * \brief The index of a name, which is added to the table the first time
+ * @param name - the name
+ * @return - its index
+ */
+uint32_t NameTable::index(symbol_t name) {
+    auto found = indexes.emplace(name, (uint32_t) names.size());
+    if ( found.second ) {
+        names.push_back(name);
+    }
+    return found.first->second;
+}
+
+
+/**
+ * \brief Appends the table to an encoding
+ * @param image - the encoding
+ */
+void NameTable::encode(std::string &image) const {
+    std::vector<uint32_t> offsets = {0};
+    std::string text;
+    for ( symbol_t name : names ) {
+        text += symbol_name(name);
+        offsets.push_back((uint32_t) text.size());
+    }
+
+    put_u32((uint32_t) names.size(), image);
+    put_u32((uint32_t) text.size(), image);
+    image.append(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint32_t));
+    image.append(text);
+}
+
+
+/**
+ * \brief Takes a table off the front of an encoding and interns its names
+ * @param image - what is left of the encoding, advanced past the table
+ * @return - false when the table is damaged
+ */
+bool NameTable::decode(std::string_view &image) {
+    uint32_t name_count;
+    uint32_t names_size;
+    if ( !take_u32(image, name_count) || !take_u32(image, names_size) ||
+         image.size() < ((uint64_t) name_count + 1) * sizeof(uint32_t) + names_size ) {
+        return false;
+    }
+    std::string_view offsets = image.substr(0, ((size_t) name_count + 1) * sizeof(uint32_t));
+    std::string_view text = image.substr(offsets.size(), names_size);
+    image.remove_prefix(offsets.size() + names_size);
+
+    names.clear();
+    indexes.clear();
+    uint32_t start = 0;
+    for ( uint32_t i = 0; i <= name_count; i++ ) {
+        uint32_t end;
+        if ( !take_u32(offsets, end) || end < start || end > names_size || (i == 0 && end != 0)) {
+            return false;
+        }
+        if ( i > 0 ) {
+            names.push_back(intern(std::string(text.substr(start, end - start))));
+        }
+        start = end;
+    }
+    return start == names_size;
+}
+
+
+/**
+ * \brief Appends nodes to an encoding, with their names replaced by indexes
+ * @param nodes - the nodes, children before their parents
+ * @param names - the table the names are added to
+ * @param image - the encoding
+ */
+void encode_nodes(const std::vector<FlatNode> &nodes, NameTable &names, std::string &image) {
+    put_u32((uint32_t) nodes.size(), image);
+    for ( FlatNode node : nodes ) {
+        if ( node.kind == expr_var || node.kind == expr_let || node.kind == expr_fun ) {
+            node.value = names.index(node.value);
+        }
+        image.append(reinterpret_cast<const char *>(&node), sizeof(node));
+    }
+}
+
+
+/**
+ * \brief Takes nodes off the front of an encoding and builds their expression trees
+ *
+ * The nodes are read where they are, one pass from the first to the last, so children are always built before
+ * their parents and deep programs take no C++ stack. Every field is checked before it is used.
+ * @param image - what is left of the encoding, advanced past the nodes
+ * @param names - the table the encoding was made with
+ * @param built - set to one entry per node, the unresolved tree of every node that is no other node's child and
+ *                nullptr for the others
+ * @return - false when the nodes are damaged
+ */
+bool decode_nodes(std::string_view &image, const NameTable &names, std::vector<PTR(Expr)> &built) {
+    uint32_t node_count;
+    if ( !take_u32(image, node_count) || image.size() < (uint64_t) node_count * sizeof(FlatNode)) {
+        return false;
+    }
+    const char *nodes = image.data();
+    image.remove_prefix((size_t) node_count * sizeof(FlatNode));
+    uint32_t name_count = (uint32_t) names.names.size();
+
+    //every node is the child of one node at most, so each one is taken out once it has its parent
+    built.assign(node_count, nullptr);
+    auto child = [&](uint32_t node, uint32_t parent) -> PTR(Expr) {
+        if ( node >= parent ) {
+            return nullptr;
+        }
+        PTR(Expr) e = built[node];
+        built[node] = nullptr;
+        return e;
+    };
+
+    for ( uint32_t i = 0; i < node_count; i++ ) {
+        FlatNode n;
+        std::memcpy(&n, nodes + (size_t) i * sizeof(FlatNode), sizeof(n));
+
+        PTR(Expr) lhs = nullptr;
+        PTR(Expr) rhs = nullptr;
+        PTR(Expr) other = nullptr;
+        switch ( n.kind ) {
+            case expr_num:
+                built[i] = NEW (NumExpr)((int) n.value);
+                continue;
+
+            case expr_bool:
+                built[i] = NEW (BoolExpr)(n.value != 0);
+                continue;
+
+            case expr_var:
+                if ( n.value >= name_count ) {
+                    return false;
+                }
+                built[i] = NEW (VarExpr)(names.names[n.value]);
+                continue;
+
+            case expr_fun: {
+                lhs = child(n.lhs, i);
+                rhs = n.rhs == FlatAst::no_node ? lhs : child(n.rhs, i);
+                if ( lhs == nullptr || rhs == nullptr || n.value >= name_count ) {
+                    return false;
+                }
+                PTR(FunExpr) fun = NEW (FunExpr)(names.names[n.value], lhs);
+                fun->source = rhs;
+                built[i] = fun;
+                continue;
+            }
+
+            case expr_if:
+                other = child(n.value, i);
+                if ( other == nullptr ) {
+                    return false;
+                }
+                break;
+
+            case expr_let:
+                if ( n.value >= name_count ) {
+                    return false;
+                }
+                break;
+
+            case expr_add:
+            case expr_mult:
+            case expr_eq:
+            case expr_call:
+                break;
+
+            default:
+                return false;
+        }
+
+        lhs = child(n.lhs, i);
+        rhs = child(n.rhs, i);
+        if ( lhs == nullptr || rhs == nullptr ) {
+            return false;
+        }
+        switch ( n.kind ) {
+            case expr_add:
+                built[i] = NEW (AddExpr)(lhs, rhs);
+                break;
+            case expr_mult:
+                built[i] = NEW (MultExpr)(lhs, rhs);
+                break;
+            case expr_eq:
+                built[i] = NEW (EqExpr)(lhs, rhs);
+                break;
+            case expr_call:
+                built[i] = NEW (CallExpr)(lhs, rhs);
+                break;
+            case expr_let:
+                built[i] = NEW (LetExpr)(names.names[n.value], lhs, rhs);
+                break;
+            case expr_if:
+                built[i] = NEW (IfExpr)(lhs, rhs, other);
+                break;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * \brief Encodes a parsed program
+ * @param ast - the program
+ * @param source - the text it was parsed from
+ * @param hash - the hash of that text
+ * @return - the encoded program
+ */
+static std::string encode(const FlatAst &ast, std::string_view source, uint64_t hash) {
+    if ( ast.root == FlatAst::no_node ) {
+        throw std::runtime_error("empty program");
+    }
+
+    NameTable names;
+    std::string nodes;
+    encode_nodes(ast.nodes, names, nodes);
+
+    AstHeader header;
+    header.magic = ast_magic;
+    header.version = ast_format_version;
+    header.source_hash = hash;
+    header.source_size = source.size();
+    header.body_hash = 0;
+    header.root = ast.root;
+    header.reserved = 0;
+
+    std::string image(reinterpret_cast<const char *>(&header), sizeof(header));
+    names.encode(image);
+    image.append(nodes);
+    image.append(source);
+
+    header.body_hash = source_hash(std::string_view(image).substr(sizeof(header)));
+    std::memcpy(&image[0], &header, sizeof(header));
+    return image;
+}
+
+
+/**
+ * \brief Builds the expression tree of an encoded program
+ *
+ * Two sources can have the same hash and length, so the source kept in the image has to match as well.
+ * @param image - the encoded program, usually a mapped file
+ * @param source - the text it has to come from
+ * @param hash - the hash of that text
+ * @return - the unresolved tree, nullptr when the image is damaged or was made from another source or format
+ */
+static PTR(Expr) decode(std::string_view image, std::string_view source, uint64_t hash) {
+    AstHeader header;
+    if ( image.size() < sizeof(header)) {
+        return nullptr;
+    }
+    std::memcpy(&header, image.data(), sizeof(header));
+    image.remove_prefix(sizeof(header));
+    if ( header.magic != ast_magic || header.version != ast_format_version || header.source_hash != hash ||
+         header.source_size != source.size() || header.body_hash != source_hash(image)) {
+        return nullptr;
+    }
+
+    NameTable names;
+    std::vector<PTR(Expr)> built;
+    if ( !names.decode(image) || !decode_nodes(image, names, built) || image != source ||
+         header.root >= built.size()) {
+        return nullptr;
+    }
+    return built[header.root];
+}
+
+
+/**
+ * \brief Encodes a parsed program, see the layout at the top of this file
+ * @param ast - the program, as returned by parse_flat
+ * @param source - the text it was parsed from
+ * @return - the encoded program
+ */
+std::string encode_ast(const FlatAst &ast, std::string_view source) {
+    return encode(ast, source, source_hash(source));
+}
+
+
+/**
+ * \brief Builds the expression tree of an encoded program
+ * @param image - the encoded program
+ * @param source - the text it has to have been parsed from
+ * @return - the unresolved tree, nullptr when the image is damaged or was made from another source or format
+ */
+PTR(Expr) decode_ast(std::string_view image, std::string_view source) {
+    return decode(image, source, source_hash(source));
+}
+
+
+/**
+ * \brief Writes a file so that no reader ever sees part of it, gives up quietly when it cannot
+ * @param path - the file
+ * @param contents - what goes in it
+ */
+void write_whole_file(const std::string &path, const std::string &contents) {
+    static std::atomic<unsigned> next_temp(0);
+#ifndef _WIN32
+    long process = (long) getpid();
+#else
+    long process = (long) _getpid();
+#endif
+    std::string temp = path + ".tmp" + std::to_string(process) + "." + std::to_string(next_temp++);
+
+    bool written;
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), (std::streamsize) contents.size());
+        written = (bool) out;
+    }
+    if ( !written || std::rename(temp.c_str(), path.c_str()) != 0 ) {
+        std::remove(temp.c_str());
+    }
+}
+
+
+/**
+ * \brief Constructor, creates the directory when it does not exist yet
+ * @param directory - where the encoded programs are kept
+ */
+AstCache::AstCache(std::string directory) : hit_count(0), miss_count(0) {
+    while ( directory.size() > 1 && directory.back() == '/' ) {
+        directory.pop_back();
+    }
+    this->directory = directory.empty() ? "." : directory;
+
+#ifndef _WIN32
+    mkdir(this->directory.c_str(), 0777);
+#else
+    _mkdir(this->directory.c_str());
+#endif
+}
+
+
+/**
+ * \brief Parses a program, or loads it when the same text was parsed before
+ * @param text - the program
+ * @return - its unresolved tree, equal to what parse_str returns
+ */
+PTR(Expr) AstCache::parse(std::string_view text) const {
+    uint64_t hash = source_hash(text);
+    std::string path = path_for(hash);
+
+    try {
+        MappedFile file(path);
+        PTR(Expr) e = decode(file.view(), text, hash);
+        if ( e != nullptr ) {
+            hit_count++;
+            return e;
+        }
+    } catch ( const std::runtime_error & ) {
+        //not cached yet
+    }
+
+    //errors are not cached, they come from the parser every time
+    miss_count++;
+    std::string image = encode(parse_flat(text), text, hash);
+    write_whole_file(path, image);
+    return decode(image, text, hash);
+}
+
+
+/**
+ * \brief Number of programs that were loaded instead of parsed
+ * @return - the count since the cache was made
+ */
+size_t AstCache::hits() const {
+    return hit_count;
+}
+
+
+/**
+ * \brief Number of programs that were parsed, because they were not in the directory or their file did not match
+ * @return - the count since the cache was made
+ */
+size_t AstCache::misses() const {
+    return miss_count;
+}
+
+
+/**
+ * \brief The file of a program
+ * @param hash - the hash of its source
+ * @return - the path of the file in the directory
+ */
+std::string AstCache::path_for(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.msdast", (unsigned long long) hash);
+    return directory + "/" + name;
+}
@@ -0,0 +1,94 @@
+#ifndef MSDSCRIPT_ASTCACHE_H
+#define MSDSCRIPT_ASTCACHE_H
+
+/**
+ * \file AstCache.h
+ * \brief binary encoding of parsed programs and a cache of them on disk
+ *
+ * A program is stored as the node array of its FlatAst behind a small versioned header, so a cached program is
+ * turned back into an expression tree in one pass over the mapped file, without lexing or parsing the source again.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "pointer.h"
+#include "Symbol.h"
+
+class Expr;
+
+class FlatAst;
+
+struct FlatNode;
+
+static const uint32_t ast_format_version = 3; ///< changes whenever the layout of an encoded program changes
+
+uint64_t source_hash(std::string_view source);
+
+std::string encode_ast(const FlatAst &ast, std::string_view source);
+
+PTR(Expr) decode_ast(std::string_view image, std::string_view source);
+
+void write_whole_file(const std::string &path, const std::string &contents);
+
+
+/**
+ * \brief The names an encoding uses, each stored once as text
+ *
+ * Symbols are only valid in the process that interned them, so an encoding refers to a name by its index here.
+ */
+class NameTable {
+public:
+    std::vector<symbol_t> names; ///< in the order of their indexes
+
+    uint32_t index(symbol_t name);
+
+    void encode(std::string &image) const;
+
+    bool decode(std::string_view &image);
+
+private:
+    std::unordered_map<symbol_t, uint32_t> indexes; ///< the index of every name, made by index()
+};
+
+void encode_nodes(const std::vector<FlatNode> &nodes, NameTable &names, std::string &image);
+
+bool decode_nodes(std::string_view &image, const NameTable &names, std::vector<PTR(Expr)> &built);
+
+
+/**
+ * \brief Parses programs, keeping the encoded result of every program it parsed in a directory
+ *
+ * The file of a program is named after the hash of its source, and its header also records the length of the
+ * source, the hash, the format version and a checksum of the rest of the file. The file also keeps the source
+ * itself, since different sources can share a hash. A file that does not match all of them is ignored and written
+ * again. Files are written under a temporary name and renamed, so processes and
+ * threads that share the directory only ever see whole files. A directory that cannot be written to only costs the
+ * time of the parse.
+ *
+ * Safe to call from several threads at once.
+ */
+class AstCache {
+public:
+    explicit AstCache(std::string directory);
+
+    PTR(Expr) parse(std::string_view text) const;
+
+    size_t hits() const;
+
+    size_t misses() const;
+
+private:
+    std::string directory; ///< where the encoded programs are kept
+    mutable std::atomic<size_t> hit_count; ///< programs loaded from the directory
+    mutable std::atomic<size_t> miss_count; ///< programs that had to be parsed
+
+    std::string path_for(uint64_t hash) const;
+};
+
+
+#endif //MSDSCRIPT_ASTCACHE_H
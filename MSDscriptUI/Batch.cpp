@@ -0,0 +1,314 @@
+#include "Batch.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include "parse.hpp"
+#include "Expr.h"
+#include "Val.h"
+#include "Arena.h"
+#include "AstCache.h"
+#include "Cancel.h"
+#include "CEK.h"
+#include "Prelude.h"
+#include "Resolver.h"
+#include "TypeChecker.h"
+#include "Optimizer.h"
+
+#ifndef _WIN32
+# include <pthread.h>
+#else
+# define NOMINMAX
+# include <windows.h>
+# include <process.h>
+#endif
+
+/**
+ * \file Batch.cpp
+ * \brief contains the implementation of the batch runner
+ */
+
+
+#ifndef _WIN32
+typedef pthread_t worker_t;
+#else
+typedef HANDLE worker_t;
+#endif
+
+
+/**
+ * \brief The entry point of a worker thread
+ * @param work - the std::function the worker runs
+ * @return - nothing
+ */
+#ifndef _WIN32
+static void *run_worker(void *work) {
+    (*static_cast<const std::function<void()> *>(work))();
+    return nullptr;
+}
+#else
+static unsigned __stdcall run_worker(void *work) {
+    (*static_cast<const std::function<void()> *>(work))();
+    return 0;
+}
+#endif
+
+
+/**
+ * \brief Starts a thread with a stack of a given size, which std::thread has no way to ask for
+ * @param worker - set to the thread
+ * @param work - what the thread runs, it has to outlive the thread
+ * @param size - bytes of stack
+ * @return - false when the thread could not be started
+ */
+static bool start_worker(worker_t &worker, const std::function<void()> &work, size_t size) {
+    void *argument = const_cast<std::function<void()> *>(&work);
+#ifndef _WIN32
+    pthread_attr_t attributes;
+    if ( pthread_attr_init(&attributes) != 0 ) {
+        return false;
+    }
+    bool started = pthread_attr_setstacksize(&attributes, size) == 0 &&
+                   pthread_create(&worker, &attributes, run_worker, argument) == 0;
+    pthread_attr_destroy(&attributes);
+    return started;
+#else
+    worker = (HANDLE) _beginthreadex(nullptr, (unsigned) size, run_worker, argument,
+                                     STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
+    return worker != 0;
+#endif
+}
+
+
+/**
+ * \brief Waits for a thread started by start_worker to end
+ * @param worker - the thread
+ */
+static void join_worker(worker_t worker) {
+#ifndef _WIN32
+    pthread_join(worker, nullptr);
+#else
+    WaitForSingleObject(worker, INFINITE);
+    CloseHandle(worker);
+#endif
+}
+
+
+/**
+ * \brief Splits an input buffer into records, one expression per line
+ *
+ * A trailing \\r is dropped so files with Windows line endings work. Lines that only hold whitespace are skipped.
+ * @param input - the whole input
+ * @return - views into input, valid as long as input is
+ */
+std::vector<std::string_view> split_records(std::string_view input) {
+    std::vector<std::string_view> records;
+
+    size_t start = 0;
+    while ( start < input.size()) {
+        size_t end = input.find('\n', start);
+        if ( end == std::string_view::npos ) {
+            end = input.size();
+        }
+
+        std::string_view line = input.substr(start, end - start);
+        if ( !line.empty() && line.back() == '\r' ) {
+            line.remove_suffix(1);
+        }
+        if ( std::any_of(line.begin(), line.end(), [](char c) { return !isspace((unsigned char) c); })) {
+            records.push_back(line);
+        }
+
+        start = end + 1;
+    }
+
+    return records;
+}
+
+
+/**
+ * \brief Constructor for a batch runner
+ * @param mode - what to do with every record
+ * @param threads - number of worker threads, 0 for one per core
+ * @param chunk_size - records taken by a worker at a time
+ * @param ast_cache - the cache records are parsed through, nullptr to parse every record
+ * @param prelude - the definitions every record is evaluated with, nullptr for none
+ */
+BatchRunner::BatchRunner(batch_mode_t mode, int threads, size_t chunk_size, const AstCache *ast_cache,
+                         const Prelude *prelude) {
+    if ( threads <= 0 ) {
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    this->mode = mode;
+    this->threads = threads;
+    this->chunk_size = std::max((size_t) 1, chunk_size);
+    this->ast_cache = ast_cache;
+    this->prelude = prelude;
+}
+
+
+/**
+ * \brief Parses and evaluates a single record
+ *
+ * Safe to call from several threads at once. Everything the record allocates is freed before returning, in the gc
+ * pointer mode values and environments are freed by a later collection instead. A record nested deeper than
+ * max_recursive_height is evaluated on the CEK machine without being optimized, resolved or type checked. Printing
+ * needs no such limit, to_string() and to_string_pretty() go through the ExprPrinter, which keeps its own stack.
+ * @param record - the expression text
+ * @param failed - set to true if the record raised an error, left alone otherwise
+ * @param env - the environment the record is evaluated in, made by the calling thread
+ * @return - the result, or the error message prefixed with "error: "
+ */
+std::string BatchRunner::evaluate(std::string_view record, bool &failed, PTR(Env) env) const {
+    //each thread keeps its arena between records, the scope only resets it
+    static thread_local Arena arena;
+    ArenaScope arena_scope(arena);
+
+#if USE_GC_POINTERS
+    //nothing of the earlier records on this thread is reachable, the heap collects once enough of them piled up
+    GcHeap::current().safepoint();
+#endif
+
+    try {
+        PTR(Expr) e = ast_cache != nullptr ? ast_cache->parse(record) : parse_str(record);
+
+        if ( mode == batch_print ) {
+            return e->to_string();
+        } else if ( mode == batch_pretty_print ) {
+            return e->to_string_pretty();
+        }
+
+        if ( e->height > max_recursive_height ) {
+            return cek_interp(e, env)->to_string();
+        }
+
+        Optimizer optimizer;
+        Resolver resolver;
+        TypeChecker checker;
+        PTR(Expr) program = resolver.resolve(optimizer.optimize(e));
+        checker.check(program);
+        return program->interp(env)->to_string();
+
+    } catch ( const std::exception &error ) {
+        failed = true;
+        return std::string("error: ") + error.what();
+    }
+}
+
+
+/**
+ * \brief Evaluates every record and writes one result line per record, in input order
+ *
+ * A worker that cannot restore the prelude stops the others, and the error is raised here once they are joined.
+ * @param records - the expressions, see split_records
+ * @param out - where the results go
+ * @return - the number of records that raised an error
+ */
+size_t BatchRunner::run(const std::vector<std::string_view> &records, std::ostream &out) {
+    size_t chunks = (records.size() + chunk_size - 1) / chunk_size;
+
+    std::vector<std::string> results(records.size());
+    std::atomic<size_t> next_chunk(0);
+    std::atomic<size_t> failures(0);
+    std::atomic<bool> stop(false);
+    //the first error raised outside of a record, guarded by lock
+    std::exception_ptr error;
+    chunks_done.assign(chunks, false);
+
+    std::function<void()> work = [&]() {
+        //the flag is set when a worker fails, the scope also gives the stack budget
+        CancelScope cancel_scope(stop, stack_size - 8 * 1024 * 1024);
+
+        //every worker restores its own prelude, so nothing a record can reach is shared with another thread
+        Arena prelude_arena;
+        PTR(Env) env = nullptr;
+        if ( prelude != nullptr ) {
+            try {
+                ArenaScope scope(prelude_arena, false);
+                env = prelude->restore();
+            } catch ( ... ) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if ( error == nullptr ) {
+                        error = std::current_exception();
+                    }
+                }
+                stop = true;
+                chunk_finished.notify_all();
+                return;
+            }
+        }
+#if USE_GC_POINTERS
+        GcRoot<Env> env_root(env);
+#endif
+
+        while ( true ) {
+            size_t chunk = next_chunk++;
+            if ( chunk >= chunks || stop ) {
+                return;
+            }
+
+            size_t first = chunk * chunk_size;
+            size_t last = std::min(first + chunk_size, records.size());
+            for ( size_t i = first; i < last; i++ ) {
+                bool failed = false;
+                results[i] = evaluate(records[i], failed, env);
+                if ( failed ) {
+                    failures++;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                chunks_done[chunk] = true;
+            }
+            chunk_finished.notify_one();
+        }
+    };
+
+    //the workers that did start take every chunk between them
+    std::vector<worker_t> workers;
+    int worker_count = (int) std::min((size_t) threads, chunks);
+    for ( int i = 0; i < worker_count; i++ ) {
+        worker_t worker;
+        if ( !start_worker(worker, work, stack_size)) {
+            break;
+        }
+        workers.push_back(worker);
+    }
+    if ( workers.empty() && chunks > 0 ) {
+        throw std::runtime_error("cannot start a worker thread");
+    }
+
+    //write chunks in order while later ones are still being evaluated
+    for ( size_t chunk = 0; chunk < chunks; chunk++ ) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            chunk_finished.wait(guard, [&] { return chunks_done[chunk] || error != nullptr; });
+            if ( error != nullptr ) {
+                break;
+            }
+        }
+
+        size_t first = chunk * chunk_size;
+        size_t last = std::min(first + chunk_size, records.size());
+        for ( size_t i = first; i < last; i++ ) {
+            out << results[i] << '\n';
+            std::string().swap(results[i]);
+        }
+    }
+
+    for ( worker_t worker : workers ) {
+        join_worker(worker);
+    }
+    out.flush();
+
+    if ( error != nullptr ) {
+        std::rethrow_exception(error);
+    }
+
+    return failures;
+}
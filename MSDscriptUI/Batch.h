@@ -0,0 +1,76 @@
+#ifndef MSDSCRIPT_BATCH_H
+#define MSDSCRIPT_BATCH_H
+
+/**
+ * \file Batch.h
+ * \brief headless evaluation of many expressions at once
+ *
+ * Contains the declarations for splitting an input buffer into records and for the runner that parses and
+ * evaluates the records on a pool of threads
+ */
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "pointer.h"
+
+class AstCache;
+
+class Env;
+
+class Prelude;
+
+/**
+ * \brief What the batch runner does with every record
+ */
+typedef enum {
+    batch_interp = 0,   ///< optimize, resolve and evaluate, like the Interp button
+    batch_print,        ///< print the parsed expression
+    batch_pretty_print  ///< pretty print the parsed expression, like the Pretty Print button
+} batch_mode_t;
+
+
+std::vector<std::string_view> split_records(std::string_view input);
+
+
+/**
+ * \brief Parses and evaluates records on a pool of threads and writes the results in input order
+ *
+ * Workers take chunks of consecutive records from a shared counter, so a slow record only holds up its own chunk.
+ * The calling thread writes each chunk as soon as it and every chunk before it are done, so output starts before
+ * the whole input is evaluated. Every record is evaluated independently: a failure only produces an error line
+ * for that record.
+ *
+ * Workers run on threads with a stack of stack_size, and calls and nested expressions may use all of it but the last
+ * 8 MB, which the passes over a program of max_recursive_height levels fit in. A record that recurses deeper fails
+ * with "recursion too deep" instead of overflowing the stack of its worker.
+ */
+class BatchRunner {
+public:
+    static const size_t stack_size = 64 * 1024 * 1024; ///< of every worker thread
+
+    BatchRunner(batch_mode_t mode, int threads = 0, size_t chunk_size = 64, const AstCache *ast_cache = nullptr,
+                const Prelude *prelude = nullptr);
+
+    size_t run(const std::vector<std::string_view> &records, std::ostream &out);
+
+    std::string evaluate(std::string_view record, bool &failed, PTR(Env) env = nullptr) const;
+
+private:
+    batch_mode_t mode; ///< what to do with every record
+    int threads; ///< number of worker threads
+    size_t chunk_size; ///< records taken by a worker at a time
+    const AstCache *ast_cache; ///< where records are parsed when set, so unchanged records skip the parser
+    const Prelude *prelude; ///< restored by every worker when set, records are evaluated in its environment
+
+    std::mutex lock; ///< guards chunks_done
+    std::condition_variable chunk_finished; ///< signalled by a worker after each chunk
+    std::vector<bool> chunks_done; ///< which chunks have their results ready
+};
+
+
+#endif //MSDSCRIPT_BATCH_H
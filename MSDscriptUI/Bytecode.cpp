@@ -0,0 +1,341 @@
+#include "Bytecode.h"
+#include "Expr.h"
+#include "Val.h"
+#include "Env.h"
+#include "Value.h"
+#include "Resolver.h"
+#include "Optimizer.h"
+#include "Cancel.h"
+#include <stdexcept>
+
+/**
+ * \file Bytecode.cpp
+ * \brief contains the implementations of the bytecode compiler and the virtual machine
+ *
+ * interp() stays the reference engine, the machine here has to give the same values and the same errors.
+ * Integers and booleans live on the machine's stack as immediate Values, so they never allocate.
+ */
+
+
+/**
+ * \brief Compiles an expression into a top level prototype
+ * @param e - the expression to compile
+ * @return - a prototype that can be passed to VM::run
+ */
+std::shared_ptr<FunctionProto> Compiler::compile(PTR(Expr) e) {
+    //the proto is run many times, so simplify the program once here
+    Optimizer optimizer;
+    Resolver resolver;
+    PTR(Expr) resolved = resolver.resolve(optimizer.optimize(e));
+
+    std::shared_ptr<FunctionProto> proto = std::make_shared<FunctionProto>();
+    proto->formal_arg = 0;
+    proto->frame_size = 0;
+    proto->outer_depth = 0;
+    proto->body = resolved;
+
+    compile_expr(*proto, resolved, true);
+    emit(*proto, op_return);
+
+    return proto;
+}
+
+
+/**
+ * \brief Appends an instruction to a prototype
+ * @param proto - the prototype being compiled
+ * @param op - the opcode
+ * @param arg - the first operand
+ * @param arg2 - the second operand
+ * @return - the index of the new instruction so jumps can be patched later
+ */
+int Compiler::emit(FunctionProto &proto, opcode_t op, int arg, int arg2) {
+    proto.code.push_back({op, arg, arg2});
+    return (int) proto.code.size() - 1;
+}
+
+
+/**
+ * \brief Emits the instructions for an expression, leaving its value on top of the stack
+ * @param proto - the prototype being compiled
+ * @param e - the resolved expression to compile
+ * @param tail - true when nothing but op_return follows the expression
+ */
+void Compiler::compile_expr(FunctionProto &proto, PTR(Expr) e, bool tail) {
+
+    if ( PTR(NumExpr) num = CAST (NumExpr)(e)) {
+        emit(proto, op_num, num->val);
+
+    } else if ( PTR(BoolExpr) boolean = CAST (BoolExpr)(e)) {
+        emit(proto, op_bool, boolean->boolean ? 1 : 0);
+
+    } else if ( PTR(AddExpr) add = CAST (AddExpr)(e)) {
+        compile_expr(proto, add->lhs);
+        compile_expr(proto, add->rhs);
+        emit(proto, op_add);
+
+    } else if ( PTR(MultExpr) mult = CAST (MultExpr)(e)) {
+        compile_expr(proto, mult->lhs);
+        compile_expr(proto, mult->rhs);
+        emit(proto, op_mult);
+
+    } else if ( PTR(EqExpr) eq = CAST (EqExpr)(e)) {
+        compile_expr(proto, eq->lhs);
+        compile_expr(proto, eq->rhs);
+        emit(proto, op_eq);
+
+    } else if ( PTR(VarExpr) var = CAST (VarExpr)(e)) {
+        //a variable the resolver could not find is free and is looked up by name at run time
+        if ( var->depth >= 0 ) {
+            emit(proto, op_load, var->depth, var->slot);
+        } else {
+            emit(proto, op_lookup, (int) var->value);
+        }
+
+    } else if ( PTR(LetExpr) let = CAST (LetExpr)(e)) {
+        compile_expr(proto, let->rhs);
+        if ( let->slot >= 0 ) {
+            emit(proto, op_store, let->slot);
+            compile_expr(proto, let->body, tail);
+        } else {
+            emit(proto, op_bind, (int) let->value);
+            compile_expr(proto, let->body);
+            emit(proto, op_unbind);
+        }
+
+    } else if ( PTR(IfExpr) ifExpr = CAST (IfExpr)(e)) {
+        compile_expr(proto, ifExpr->ifExpr);
+        int jump_to_else = emit(proto, op_jump_unless);
+        compile_expr(proto, ifExpr->thenExpr, tail);
+        int jump_to_end = emit(proto, op_jump);
+        proto.code[jump_to_else].arg = (int) proto.code.size();
+        compile_expr(proto, ifExpr->elseExpr, tail);
+        proto.code[jump_to_end].arg = (int) proto.code.size();
+
+    } else if ( PTR(FunExpr) fun = CAST (FunExpr)(e)) {
+        std::shared_ptr<FunctionProto> nested = std::make_shared<FunctionProto>();
+        nested->formal_arg = fun->formal_arg;
+        nested->frame_size = fun->frame_size;
+        nested->captures = fun->captures;
+        nested->outer_depth = fun->outer_depth;
+        nested->body = fun->body;
+        nested->source = fun->source;
+
+        compile_expr(*nested, fun->body, true);
+        emit(*nested, op_return);
+
+        proto.functions.push_back(nested);
+        emit(proto, op_closure, (int) proto.functions.size() - 1);
+
+    } else if ( PTR(CallExpr) call = CAST (CallExpr)(e)) {
+        compile_expr(proto, call->to_be_called);
+        compile_expr(proto, call->actual_arg);
+        emit(proto, tail ? op_tail_call : op_call);
+
+    } else {
+        throw std::runtime_error("cannot compile expression: " + e->to_string());
+    }
+}
+
+
+/**
+ * \brief An activation of a prototype inside the machine
+ */
+struct CallFrame {
+    std::shared_ptr<FunctionProto> proto; ///< the code being run, kept alive while the frame runs
+    size_t pc; ///< index of the next instruction
+    PTR(Env) env; ///< the current environment
+    size_t saved_base; ///< size of the saved environment stack when the frame was entered
+};
+
+
+#if USE_GC_POINTERS
+
+/**
+ * \brief The stacks of one VM::run, a root set of the heap while it runs
+ */
+struct VMRoots : public GcRoots {
+    const std::vector<Value> &stack;
+    const std::vector<PTR(Env)> &saved_envs;
+    const std::vector<CallFrame> &frames;
+
+    VMRoots(const std::vector<Value> &stack, const std::vector<PTR(Env)> &saved_envs,
+            const std::vector<CallFrame> &frames) : stack(stack), saved_envs(saved_envs), frames(frames) {}
+
+    void trace_roots(GcHeap &heap) {
+        for ( const Value &value : stack ) {
+            heap.mark(value);
+        }
+        for ( PTR(Env) env : saved_envs ) {
+            heap.mark(env);
+        }
+        for ( const CallFrame &frame : frames ) {
+            heap.mark(frame.env);
+        }
+    }
+};
+
+#endif
+
+
+/**
+ * \brief Runs a compiled program
+ * @param program - a prototype created by Compiler::compile
+ * @param env - the environment free variables are looked up in
+ * @return - the value of the program
+ */
+PTR(Val) VM::run(std::shared_ptr<FunctionProto> program, PTR(Env) env) {
+    if ( env == nullptr ) {
+        env = Env::empty;
+    }
+
+    std::vector<Value> stack;
+    std::vector<PTR(Env)> saved_envs;
+    std::vector<CallFrame> frames;
+#if USE_GC_POINTERS
+    VMRoots roots(stack, saved_envs, frames);
+#endif
+
+    frames.push_back({program, 0, env, 0});
+
+    while ( true ) {
+        CallFrame &frame = frames.back();
+        const Instruction &instruction = frame.proto->code[frame.pc++];
+
+        switch ( instruction.op ) {
+
+            case op_num:
+                stack.push_back(Value::from_int(instruction.arg));
+                break;
+
+            case op_bool:
+                stack.push_back(Value::from_bool(instruction.arg != 0));
+                break;
+
+            case op_load:
+                stack.push_back(frame.env->lookup_at(instruction.arg, instruction.arg2));
+                break;
+
+            case op_lookup:
+                stack.push_back(Value::from_val(frame.env->lookup((symbol_t) instruction.arg)));
+                break;
+
+            case op_add: {
+                Value &lhs = stack[stack.size() - 2];
+                lhs = add_values(lhs, stack.back());
+                stack.pop_back();
+                break;
+            }
+
+            case op_mult: {
+                Value &lhs = stack[stack.size() - 2];
+                lhs = mult_values(lhs, stack.back());
+                stack.pop_back();
+                break;
+            }
+
+            case op_eq: {
+                Value &lhs = stack[stack.size() - 2];
+                lhs = Value::from_bool(lhs.equals(stack.back()));
+                stack.pop_back();
+                break;
+            }
+
+            case op_jump:
+                frame.pc = instruction.arg;
+                break;
+
+            case op_jump_unless: {
+                bool condition = stack.back().is_true();
+                stack.pop_back();
+                if ( !condition ) {
+                    frame.pc = instruction.arg;
+                }
+                break;
+            }
+
+            case op_store:
+                frame.env->set_slot(instruction.arg, stack.back());
+                stack.pop_back();
+                break;
+
+            case op_bind:
+                saved_envs.push_back(frame.env);
+                frame.env = NEW (ExtendedEnv)((symbol_t) instruction.arg, stack.back(), frame.env);
+                stack.pop_back();
+                break;
+
+            case op_unbind:
+                frame.env = saved_envs.back();
+                saved_envs.pop_back();
+                break;
+
+            case op_closure: {
+                std::shared_ptr<FunctionProto> nested = frame.proto->functions[instruction.arg];
+                PTR(Env) captured = ClosureEnv::make(nested->captures, nested->outer_depth, frame.env);
+                PTR(FunVal) fun = NEW (FunVal)(nested->formal_arg, nested->body, captured);
+                fun->source = nested->source;
+                fun->frame_size = nested->frame_size;
+                fun->code = nested;
+                stack.push_back(Value::from_val(fun));
+                break;
+            }
+
+            case op_call:
+            case op_tail_call: {
+                Value actual_arg = stack.back();
+                stack.pop_back();
+                Value to_be_called = stack.back();
+                stack.pop_back();
+
+                PTR(FunVal) fun = nullptr;
+                if ( to_be_called.tag == tag_object ) {
+                    fun = CAST (FunVal)(to_be_called.object);
+                }
+
+                if ( fun != nullptr && fun->code != nullptr ) {
+                    check_cancelled();
+                    PTR(Env) call_env = NEW (FrameEnv)(fun->code->frame_size, actual_arg, fun->env);
+                    if ( instruction.op == op_tail_call ) {
+                        //the caller has nothing left to do, so the callee takes over its frame
+                        saved_envs.resize(frame.saved_base);
+                        frame.proto = fun->code;
+                        frame.pc = 0;
+                        frame.env = call_env;
+                    } else {
+                        frames.push_back({fun->code, 0, call_env, saved_envs.size()});
+                    }
+
+#if USE_GC_POINTERS
+                    //the new environment is in a frame, the machine holds nothing outside of its stacks
+                    GcHeap::current().safepoint();
+#endif
+                } else {
+                    stack.push_back(Value::from_val(to_be_called.to_val()->call(actual_arg.to_val())));
+                }
+                break;
+            }
+
+            case op_return:
+                saved_envs.resize(frame.saved_base);
+                frames.pop_back();
+                if ( frames.empty()) {
+                    return stack.back().to_val();
+                }
+                break;
+        }
+    }
+}
+
+
+/**
+ * \brief Compiles and runs an expression, the bytecode counterpart of Expr::interp
+ * @param e - the expression to evaluate
+ * @param env - the environment free variables are looked up in
+ * @return - the value of the expression
+ */
+PTR(Val) vm_interp(PTR(Expr) e, PTR(Env) env) {
+    Compiler compiler;
+    VM vm;
+    return vm.run(compiler.compile(e), env);
+}
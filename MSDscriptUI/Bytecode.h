@@ -0,0 +1,110 @@
+#ifndef MSDSCRIPT_BYTECODE_H
+#define MSDSCRIPT_BYTECODE_H
+
+/**
+ * \file Bytecode.h
+ * \brief bytecode compiler and virtual machine
+ *
+ * Contains the declarations for the compiler that flattens an expression tree into a list of instructions
+ * and for the stack machine that runs those instructions
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "pointer.h"
+#include "Symbol.h"
+#include "Env.h"
+
+class Expr;
+
+class Val;
+
+class Env;
+
+/**
+ * \brief The instructions understood by the virtual machine
+ */
+typedef enum {
+    op_num = 0,       ///< push the integer in arg
+    op_bool,          ///< push _true when arg is 1, _false when arg is 0
+    op_load,          ///< push the value in slot arg2 of the frame arg frames up the environment
+    op_lookup,        ///< push the value of the free variable whose symbol is arg
+    op_add,           ///< pop two values and push their sum
+    op_mult,          ///< pop two values and push their product
+    op_eq,            ///< pop two values and push whether they are equal
+    op_jump,          ///< continue at instruction arg
+    op_jump_unless,   ///< pop a boolean and continue at instruction arg when it is _false
+    op_store,         ///< pop a value into slot arg of the current call's frame
+    op_bind,          ///< pop a value and bind it to the symbol arg in a new ExtendedEnv
+    op_unbind,        ///< drop the innermost ExtendedEnv
+    op_closure,       ///< push a function value for functions[arg]
+    op_call,          ///< pop an argument and a function and call the function
+    op_tail_call,     ///< like op_call, but the callee replaces the current frame
+    op_return         ///< leave the current function with the value on top of the stack
+} opcode_t;
+
+
+/**
+ * \brief A single instruction, an opcode and its integer operands
+ */
+struct Instruction {
+    opcode_t op;
+    int arg;
+    int arg2;
+};
+
+
+/**
+ * \brief The compiled form of a function body (or of a whole program)
+ *
+ * Each prototype owns the prototypes of the functions nested inside it, so a FunVal can keep its code alive
+ * after the program that created it is gone.
+ */
+struct FunctionProto {
+    symbol_t formal_arg; ///< name of the parameter, unused for the top level program
+    int frame_size; ///< slots in the frame of a call
+    std::vector<EnvAddress> captures; ///< what op_closure copies into the closure, from the resolved _fun
+    int outer_depth; ///< levels from where op_closure runs out to where the program started
+    PTR(Expr) body; ///< the expression this prototype was compiled from
+    PTR(Expr) source; ///< the body as the program wrote it, see FunExpr::source
+    std::vector<Instruction> code; ///< the instructions, always ending in op_return
+    std::vector<std::shared_ptr<FunctionProto>> functions; ///< prototypes used by op_closure
+};
+
+
+/**
+ * \brief Compiles an expression tree into a FunctionProto
+ *
+ * The expression is run through the Resolver first, so variables bound by _let and _fun are read from frame
+ * slots and the machine never compares names for them
+ */
+class Compiler {
+public:
+    std::shared_ptr<FunctionProto> compile(PTR(Expr) e);
+
+private:
+    void compile_expr(FunctionProto &proto, PTR(Expr) e, bool tail = false);
+
+    int emit(FunctionProto &proto, opcode_t op, int arg = 0, int arg2 = 0);
+};
+
+
+/**
+ * \brief A stack machine that runs compiled prototypes
+ *
+ * Calls to functions created by the machine push a call frame instead of recursing in C++, any other function
+ * value falls back to Val::call. Calls in tail position reuse the caller's frame, so tail recursion runs in
+ * constant space. In the gc pointer mode the stacks are a root set of the heap while run() runs, and the heap may
+ * collect at every call.
+ */
+class VM {
+public:
+    PTR(Val) run(std::shared_ptr<FunctionProto> program, PTR(Env) env = nullptr);
+};
+
+
+PTR(Val) vm_interp(PTR(Expr) e, PTR(Env) env = nullptr);
+
+
+#endif //MSDSCRIPT_BYTECODE_H
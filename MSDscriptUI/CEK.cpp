@@ -0,0 +1,340 @@
+#include "CEK.h"
+#include <cstdint>
+#include "Expr.h"
+#include "Val.h"
+#include "Env.h"
+#include "Cancel.h"
+
+/**
+ * \file CEK.cpp
+ * \brief contains the implementation of the stackless evaluator
+ */
+
+
+/**
+ * \brief Constructor for a machine with nothing to evaluate
+ */
+CEKMachine::CEKMachine() {
+    this->control = nullptr;
+    this->env = nullptr;
+    this->have_value = false;
+    this->running = false;
+    this->step_count = 0;
+}
+
+
+/**
+ * \brief Evaluates an expression
+ * @param e - the expression, resolved or not
+ * @param env - the environment free variables are looked up in
+ * @return - the value of the expression
+ */
+PTR(Val) CEKMachine::interp(PTR(Expr) e, PTR(Env) env) {
+    start(e, env);
+    run(SIZE_MAX);
+    return result();
+}
+
+
+/**
+ * \brief Loads an expression, dropping whatever the machine was evaluating
+ * @param e - the expression, resolved or not
+ * @param env - the environment free variables are looked up in
+ */
+void CEKMachine::start(PTR(Expr) e, PTR(Env) env) {
+    continuations.clear();
+    this->control = e;
+    this->env = env == nullptr ? Env::empty : env;
+    this->val = Value();
+    this->have_value = false;
+    this->running = true;
+    this->step_count = 0;
+}
+
+
+/**
+ * \brief Whether the evaluation is over
+ * @return - true once the value is known or an error ended it, also before start()
+ */
+bool CEKMachine::finished() const {
+    return !running;
+}
+
+
+/**
+ * \brief The value of the expression
+ * @return - the value once run() returned true, nullptr before that
+ */
+PTR(Val) CEKMachine::result() const {
+    if ( running || !have_value ) {
+        return nullptr;
+    }
+    return val.to_val();
+}
+
+
+/**
+ * \brief Transitions made so far
+ * @return - the count since start(), including the ones of runs that ran out of fuel
+ */
+size_t CEKMachine::steps() const {
+    return step_count;
+}
+
+
+#if USE_GC_POINTERS
+
+/**
+ * \brief Marks the registers and every continuation, what an evaluation that was stopped by run() still needs
+ * @param heap - the heap being collected
+ */
+void CEKMachine::trace_roots(GcHeap &heap) {
+    heap.mark(env);
+    heap.mark(val);
+    for ( const Continuation &k : continuations ) {
+        heap.mark(k.env);
+        heap.mark(k.val);
+    }
+}
+
+#endif
+
+
+/**
+ * \brief Continues the evaluation for a bounded number of transitions
+ *
+ * Every transition takes one expression apart or hands one value to one continuation, so the fuel bounds the time
+ * a call takes apart from the single arithmetic operation or allocation of a transition.
+ * @param fuel - the most transitions to make
+ * @return - true when the evaluation finished, false when the fuel ran out first
+ */
+bool CEKMachine::run(size_t fuel) {
+    if ( !running ) {
+        return true;
+    }
+
+    try {
+        return run_steps(fuel);
+    } catch ( ... ) {
+        //the state was half way through a transition, nothing can resume it
+        running = false;
+        have_value = false;
+        continuations.clear();
+        throw;
+    }
+}
+
+
+/**
+ * \brief The transitions of run(), which cleans up when one of them throws
+ * @param fuel - the most transitions to make
+ * @return - true when the evaluation finished
+ */
+bool CEKMachine::run_steps(size_t fuel) {
+    //the loop works on locals, which can stay in registers, and puts them back when the fuel runs out
+    PTR(Expr) control = std::move(this->control);
+    PTR(Env) env = std::move(this->env);
+    Value val = std::move(this->val);
+    bool have_value = this->have_value;
+
+    for ( size_t left = fuel; left > 0; left-- ) {
+
+        if ( !have_value ) {
+            //take the control expression apart, pushing what is left to do
+            Expr *expr = &*control;
+
+            switch ( expr->kind ) {
+
+                case expr_num:
+                    val = Value::from_int(static_cast<NumExpr *>(expr)->val);
+                    have_value = true;
+                    break;
+
+                case expr_bool:
+                    val = Value::from_bool(static_cast<BoolExpr *>(expr)->boolean);
+                    have_value = true;
+                    break;
+
+                case expr_var: {
+                    VarExpr *var = static_cast<VarExpr *>(expr);
+                    if ( var->depth >= 0 ) {
+                        val = env->lookup_at(var->depth, var->slot);
+                    } else {
+                        val = Value::from_val(env->lookup(var->value));
+                    }
+                    have_value = true;
+                    break;
+                }
+
+                case expr_fun: {
+                    FunExpr *fun = static_cast<FunExpr *>(expr);
+                    PTR(FunVal) fun_val = NEW (FunVal)(fun->formal_arg, fun->body, fun->closure_env(env));
+                    fun_val->source = fun->source;
+                    fun_val->frame_size = fun->frame_size;
+                    val = Value::from_val(fun_val);
+                    have_value = true;
+                    break;
+                }
+
+                case expr_add: {
+                    AddExpr *add = static_cast<AddExpr *>(expr);
+                    continuations.push_back({k_add_rhs, add->rhs, nullptr, env});
+                    control = add->lhs;
+                    break;
+                }
+
+                case expr_mult: {
+                    MultExpr *mult = static_cast<MultExpr *>(expr);
+                    continuations.push_back({k_mult_rhs, mult->rhs, nullptr, env});
+                    control = mult->lhs;
+                    break;
+                }
+
+                case expr_eq: {
+                    EqExpr *eq = static_cast<EqExpr *>(expr);
+                    continuations.push_back({k_eq_rhs, eq->rhs, nullptr, env});
+                    control = eq->lhs;
+                    break;
+                }
+
+                case expr_if: {
+                    IfExpr *ifExpr = static_cast<IfExpr *>(expr);
+                    continuations.push_back({k_if, ifExpr->thenExpr, ifExpr->elseExpr, env});
+                    control = ifExpr->ifExpr;
+                    break;
+                }
+
+                case expr_let: {
+                    LetExpr *let = static_cast<LetExpr *>(expr);
+                    Continuation k = {k_let_body, let->body, nullptr, env};
+                    k.name = let->value;
+                    k.slot = let->slot;
+                    continuations.push_back(k);
+                    control = let->rhs;
+                    break;
+                }
+
+                case expr_call: {
+                    CallExpr *call = static_cast<CallExpr *>(expr);
+                    continuations.push_back({k_call_arg, call->actual_arg, nullptr, env});
+                    control = call->to_be_called;
+                    break;
+                }
+            }
+
+        } else {
+            //hand the value to the innermost continuation
+            if ( continuations.empty()) {
+                this->val = std::move(val);
+                this->have_value = true;
+                running = false;
+                step_count += fuel - left + 1;
+                return true;
+            }
+
+            Continuation &k = continuations.back();
+
+            switch ( k.kind ) {
+
+                case k_add_rhs:
+                case k_mult_rhs:
+                case k_eq_rhs:
+                case k_call_arg:
+                    //keep the value just computed in the same entry and evaluate the second operand
+                    k.kind = (cont_kind_t) (k.kind + 1);
+                    k.val = std::move(val);
+                    control = std::move(k.expr);
+                    env = std::move(k.env);
+                    have_value = false;
+                    break;
+
+                case k_add:
+                    val = add_values(k.val, val);
+                    continuations.pop_back();
+                    break;
+
+                case k_mult:
+                    val = mult_values(k.val, val);
+                    continuations.pop_back();
+                    break;
+
+                case k_eq:
+                    val = Value::from_bool(k.val.equals(val));
+                    continuations.pop_back();
+                    break;
+
+                case k_if:
+                    control = val.is_true() ? std::move(k.expr) : std::move(k.other);
+                    env = std::move(k.env);
+                    continuations.pop_back();
+                    have_value = false;
+                    break;
+
+                case k_let_body:
+                    env = std::move(k.env);
+                    if ( k.slot >= 0 ) {
+                        env->set_slot(k.slot, val);
+                    } else {
+                        env = NEW (ExtendedEnv)(k.name, val, env);
+                    }
+                    control = std::move(k.expr);
+                    continuations.pop_back();
+                    have_value = false;
+                    break;
+
+                case k_call: {
+                    Value to_be_called = std::move(k.val);
+                    continuations.pop_back();
+
+                    FunVal *fun = nullptr;
+                    if ( to_be_called.tag == tag_object ) {
+                        fun = dynamic_cast<FunVal *>(&*to_be_called.object);
+                    }
+
+                    if ( fun == nullptr ) {
+                        //not a function, let the value report the error
+                        val = Value::from_val(to_be_called.to_val()->call(val.to_val()));
+                        break;
+                    }
+
+                    check_cancelled();
+
+                    //nothing was pushed for the call, so a call in tail position runs in constant space
+                    if ( fun->frame_size >= 0 ) {
+                        env = NEW (FrameEnv)(fun->frame_size, val, fun->env);
+                    } else {
+                        env = NEW (ExtendedEnv)(fun->formal_arg, val, fun->env);
+                    }
+                    control = fun->body;
+                    have_value = false;
+
+#if USE_GC_POINTERS
+                    //the new environment is the only thing the loop holds that the machine does not
+                    this->env = env;
+                    GcHeap::current().safepoint();
+#endif
+                    break;
+                }
+            }
+        }
+    }
+
+    this->control = std::move(control);
+    this->env = std::move(env);
+    this->val = std::move(val);
+    this->have_value = have_value;
+    step_count += fuel;
+    return false;
+}
+
+
+/**
+ * \brief Evaluates an expression on a fresh CEK machine, the stackless counterpart of Expr::interp
+ * @param e - the expression to evaluate
+ * @param env - the environment free variables are looked up in
+ * @return - the value of the expression
+ */
+PTR(Val) cek_interp(PTR(Expr) e, PTR(Env) env) {
+    CEKMachine machine;
+    return machine.interp(e, env);
+}
@@ -0,0 +1,109 @@
+#ifndef MSDSCRIPT_CEK_H
+#define MSDSCRIPT_CEK_H
+
+/**
+ * \file CEK.h
+ * \brief stackless evaluator
+ *
+ * Contains the declarations for a CEK machine (control, environment, continuation) that evaluates an expression
+ * tree without recursing on the C++ stack
+ */
+
+#include <cstddef>
+#include <vector>
+#include "pointer.h"
+#include "Symbol.h"
+#include "Value.h"
+
+class Expr;
+
+class Val;
+
+class Env;
+
+/**
+ * \brief What a continuation does with the value it receives
+ */
+typedef enum {
+    k_add_rhs = 0, ///< the lhs of an _add is done, evaluate expr next
+    k_add,         ///< add the saved lhs to the value
+    k_mult_rhs,    ///< the lhs of a _mult is done, evaluate expr next
+    k_mult,        ///< multiply the saved lhs with the value
+    k_eq_rhs,      ///< the lhs of an == is done, evaluate expr next
+    k_eq,          ///< compare the saved lhs with the value
+    k_if,          ///< the condition is done, evaluate expr or other
+    k_let_body,    ///< the rhs of a _let is done, bind it and evaluate expr
+    k_call_arg,    ///< the function is done, evaluate the argument expr next
+    k_call         ///< call the saved function with the value
+} cont_kind_t;
+
+
+/**
+ * \brief One entry of the machine's continuation stack
+ */
+struct Continuation {
+    cont_kind_t kind;
+    PTR(Expr) expr; ///< the next expression to evaluate
+    PTR(Expr) other; ///< the _else branch for k_if
+    PTR(Env) env; ///< the environment expr is evaluated in
+    Value val = Value(); ///< the saved lhs or function
+    symbol_t name = 0; ///< the variable bound by k_let_body
+    int slot = -1; ///< the slot bound by k_let_body, -1 to extend the environment
+};
+
+
+/**
+ * \brief Evaluates expressions with an explicit continuation stack
+ *
+ * A call in tail position replaces the current control and environment without pushing anything, so tail
+ * recursive loops run in constant space. Other calls grow the continuation stack on the heap instead of the
+ * C++ stack. Values and errors match Expr::interp.
+ *
+ * Since the whole state of an evaluation is in the machine, it can also be run a few steps at a time. start() loads
+ * an expression, and every run() makes at most the given number of transitions before it returns, to be resumed by
+ * the next run() where it stopped. An error thrown by run() ends the evaluation.
+ *
+ * In the gc pointer mode the machine is a root set of the heap, its registers and continuations are everything the
+ * evaluation still needs, so the heap may collect at every call.
+ */
+#if USE_GC_POINTERS
+class CEKMachine : public GcRoots {
+#else
+class CEKMachine {
+#endif
+public:
+    CEKMachine();
+
+    PTR(Val) interp(PTR(Expr) e, PTR(Env) env = nullptr);
+
+    void start(PTR(Expr) e, PTR(Env) env = nullptr);
+
+    bool run(size_t fuel);
+
+    bool finished() const;
+
+    PTR(Val) result() const;
+
+    size_t steps() const;
+
+#if USE_GC_POINTERS
+    void trace_roots(GcHeap &heap);
+#endif
+
+private:
+    std::vector<Continuation> continuations;
+    PTR(Expr) control; ///< the expression being taken apart when have_value is false
+    PTR(Env) env; ///< the environment control is evaluated in
+    Value val; ///< the value being handed to the continuations when have_value is true
+    bool have_value; ///< which of the two the machine is doing
+    bool running; ///< an evaluation was started and has not finished or failed
+    size_t step_count; ///< transitions made since start()
+
+    bool run_steps(size_t fuel);
+};
+
+
+PTR(Val) cek_interp(PTR(Expr) e, PTR(Env) env = nullptr);
+
+
+#endif //MSDSCRIPT_CEK_H
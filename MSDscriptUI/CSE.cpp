@@ -0,0 +1,508 @@
+#include "CSE.h"
+#include "Expr.h"
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+/**
+ * \file CSE.cpp
+ * \brief contains the implementation of common subexpression elimination
+ */
+
+
+/**
+ * \brief Records every variable name that appears in an expression, bound or free
+ * @param e - the expression
+ * @param names - the set to add to
+ */
+static void gather_names(PTR(Expr) e, std::unordered_set<symbol_t> &names) {
+    switch ( e->kind ) {
+        case expr_num:
+        case expr_bool:
+            break;
+        case expr_var:
+            names.insert(static_cast<VarExpr *>(&*e)->value);
+            break;
+        case expr_add:
+            gather_names(static_cast<AddExpr *>(&*e)->lhs, names);
+            gather_names(static_cast<AddExpr *>(&*e)->rhs, names);
+            break;
+        case expr_mult:
+            gather_names(static_cast<MultExpr *>(&*e)->lhs, names);
+            gather_names(static_cast<MultExpr *>(&*e)->rhs, names);
+            break;
+        case expr_eq:
+            gather_names(static_cast<EqExpr *>(&*e)->lhs, names);
+            gather_names(static_cast<EqExpr *>(&*e)->rhs, names);
+            break;
+        case expr_if:
+            gather_names(static_cast<IfExpr *>(&*e)->ifExpr, names);
+            gather_names(static_cast<IfExpr *>(&*e)->thenExpr, names);
+            gather_names(static_cast<IfExpr *>(&*e)->elseExpr, names);
+            break;
+        case expr_let:
+            names.insert(static_cast<LetExpr *>(&*e)->value);
+            gather_names(static_cast<LetExpr *>(&*e)->rhs, names);
+            gather_names(static_cast<LetExpr *>(&*e)->body, names);
+            break;
+        case expr_fun:
+            names.insert(static_cast<FunExpr *>(&*e)->formal_arg);
+            gather_names(static_cast<FunExpr *>(&*e)->body, names);
+            break;
+        case expr_call:
+            gather_names(static_cast<CallExpr *>(&*e)->to_be_called, names);
+            gather_names(static_cast<CallExpr *>(&*e)->actual_arg, names);
+            break;
+    }
+}
+
+
+/**
+ * \brief Checks if an expression can only evaluate to a number, when it evaluates at all
+ * @param e - the expression
+ * @return - true for number literals and arithmetic
+ */
+static bool surely_number(PTR(Expr) e) {
+    return e->kind == expr_num || e->kind == expr_add || e->kind == expr_mult;
+}
+
+
+/**
+ * \brief Eliminates common subexpressions from a whole program
+ * @param e - the program
+ * @return - a program with the same value where repeated subexpressions are evaluated once
+ */
+PTR(Expr) CSE::eliminate(PTR(Expr) e) {
+    used_names.clear();
+    next_name = 0;
+    gather_names(e, used_names);
+    scope.clear();
+    return eliminate_region(e);
+}
+
+
+/**
+ * \brief Binds the repeated subexpressions of a region at its top, a round at a time, then handles nested regions
+ * @param e - the region
+ * @return - the rewritten region
+ */
+PTR(Expr) CSE::eliminate_region(PTR(Expr) e) {
+    //the bindings made so far, in the order they are evaluated, each in the scope of the ones before it
+    std::vector<std::pair<symbol_t, PTR(Expr)>> bindings;
+
+    for ( int round = 0; round < max_rounds; round++ ) {
+        candidates.clear();
+        unsafe.clear();
+        bound.clear();
+        functions = 0;
+        next_position = 0;
+        clock = 0;
+        for ( auto &binding : bindings ) {
+            collect(binding.second, true);
+            bound.insert(binding.first);
+        }
+        collect(e, true);
+
+        std::vector<Candidate *> picked = choose();
+        if ( picked.empty()) {
+            break;
+        }
+
+        targets_t targets;
+        std::vector<std::pair<symbol_t, PTR(Expr)>> added;
+        for ( Candidate *candidate : picked ) {
+            symbol_t name = fresh_name();
+            targets[candidate->expr->hash].push_back({candidate->expr, name});
+            added.push_back({name, candidate->expr});
+        }
+
+        bound.clear();
+        for ( auto &binding : bindings ) {
+            binding.second = replace(binding.second, targets);
+            bound.insert(binding.first);
+        }
+        e = replace(e, targets);
+
+        //the new bindings come first, their first copies were evaluated before anything that can fail
+        bindings.insert(bindings.begin(), added.begin(), added.end());
+    }
+
+    candidates.clear();
+    unsafe.clear();
+    bound.clear();
+
+    for ( auto &binding : bindings ) {
+        binding.second = eliminate_nested(binding.second);
+        scope.insert(binding.first);
+    }
+    e = eliminate_nested(e);
+    for ( size_t i = bindings.size(); i-- > 0; ) {
+        scope.erase(scope.find(bindings[i].first));
+        e = NEW (LetExpr)(bindings[i].first, bindings[i].second, e);
+    }
+    return e;
+}
+
+
+/**
+ * \brief Copies an expression, treating every _fun body, _let body and _if branch in it as a region of its own
+ * @param e - the expression
+ * @return - the rewritten expression
+ */
+PTR(Expr) CSE::eliminate_nested(PTR(Expr) e) {
+    switch ( e->kind ) {
+
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(&*e);
+            PTR(Expr) lhs = eliminate_nested(add->lhs);
+            return NEW (AddExpr)(lhs, eliminate_nested(add->rhs));
+        }
+
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(&*e);
+            PTR(Expr) lhs = eliminate_nested(mult->lhs);
+            return NEW (MultExpr)(lhs, eliminate_nested(mult->rhs));
+        }
+
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(&*e);
+            PTR(Expr) lhs = eliminate_nested(eq->lhs);
+            return NEW (EqExpr)(lhs, eliminate_nested(eq->rhs));
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(&*e);
+            PTR(Expr) condition = eliminate_nested(ifExpr->ifExpr);
+            PTR(Expr) then_expr = eliminate_region(ifExpr->thenExpr);
+            return NEW (IfExpr)(condition, then_expr, eliminate_region(ifExpr->elseExpr));
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(&*e);
+            PTR(Expr) rhs = eliminate_nested(let->rhs);
+            scope.insert(let->value);
+            PTR(Expr) body = eliminate_region(let->body);
+            scope.erase(scope.find(let->value));
+            return NEW (LetExpr)(let->value, rhs, body);
+        }
+
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(&*e);
+            scope.insert(fun->formal_arg);
+            PTR(FunExpr) result = NEW (FunExpr)(fun->formal_arg, eliminate_region(fun->body));
+            scope.erase(scope.find(fun->formal_arg));
+            result->source = fun->source;
+            return result;
+        }
+
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(&*e);
+            PTR(Expr) to_be_called = eliminate_nested(call->to_be_called);
+            return NEW (CallExpr)(to_be_called, eliminate_nested(call->actual_arg));
+        }
+
+        default:
+            return e;
+    }
+}
+
+
+/**
+ * \brief Numbers the nodes of a region, counts its compound subexpressions whose variables all refer to bindings
+ * outside of it, and records the nodes that may fail
+ * @param e - the expression to walk
+ * @param unconditional - true when e is evaluated every time the region is
+ * @return - the number of nodes in e
+ */
+int CSE::collect(PTR(Expr) e, bool unconditional) {
+    uint32_t position = next_position++;
+    uint64_t start = clock++;
+    int size = 1;
+
+    switch ( e->kind ) {
+
+        case expr_num:
+        case expr_bool:
+        case expr_var:
+            break;
+
+        case expr_add:
+            size += collect(static_cast<AddExpr *>(&*e)->lhs, unconditional);
+            size += collect(static_cast<AddExpr *>(&*e)->rhs, unconditional);
+            break;
+
+        case expr_mult:
+            size += collect(static_cast<MultExpr *>(&*e)->lhs, unconditional);
+            size += collect(static_cast<MultExpr *>(&*e)->rhs, unconditional);
+            break;
+
+        case expr_eq:
+            size += collect(static_cast<EqExpr *>(&*e)->lhs, unconditional);
+            size += collect(static_cast<EqExpr *>(&*e)->rhs, unconditional);
+            break;
+
+        case expr_call:
+            size += collect(static_cast<CallExpr *>(&*e)->to_be_called, unconditional);
+            size += collect(static_cast<CallExpr *>(&*e)->actual_arg, unconditional);
+            break;
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(&*e);
+            size += collect(ifExpr->ifExpr, unconditional);
+            size += collect(ifExpr->thenExpr, false);
+            size += collect(ifExpr->elseExpr, false);
+            break;
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(&*e);
+            size += collect(let->rhs, unconditional);
+            bound.insert(let->value);
+            size += collect(let->body, unconditional);
+            bound.erase(bound.find(let->value));
+            break;
+        }
+
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(&*e);
+            functions++;
+            bound.insert(fun->formal_arg);
+            size += collect(fun->body, false);
+            bound.erase(bound.find(fun->formal_arg));
+            functions--;
+            break;
+        }
+    }
+
+    uint64_t done = clock++;
+    //what a function body does happens when it is called, which a call in the region already counts as unsafe
+    if ( functions == 0 && may_fail(&*e)) {
+        unsafe.push_back({done, position});
+    }
+
+    //a function is cheap to build, only its body is looked at
+    if ( e->kind == expr_num || e->kind == expr_bool || e->kind == expr_var || e->kind == expr_fun ) {
+        return size;
+    }
+
+    //a copy that uses a variable bound inside the region means something else at the top of the region
+    if ( shadowed(e)) {
+        return size;
+    }
+
+    std::vector<Candidate> &group = candidates[e->hash];
+    for ( Candidate &candidate : group ) {
+        if ( candidate.expr->equals(e)) {
+            if ( unconditional ) {
+                if ( candidate.hits == 0 ) {
+                    candidate.first = start;
+                }
+                candidate.hits++;
+            } else {
+                candidate.extra++;
+            }
+            candidate.copies.push_back(position);
+            return size;
+        }
+    }
+    group.push_back({e, unconditional ? 1 : 0, unconditional ? 0 : 1, size, unconditional ? start : 0, {position}});
+    return size;
+}
+
+
+/**
+ * \brief Checks if evaluating a node by itself, once its children have been evaluated, might raise an error or loop
+ * @param e - the node
+ * @return - false only when it surely produces a value
+ */
+bool CSE::may_fail(Expr *e) {
+    switch ( e->kind ) {
+
+        case expr_var: {
+            symbol_t name = static_cast<VarExpr *>(e)->value;
+            return scope.count(name) == 0 && bound.count(name) == 0;
+        }
+
+        case expr_add:
+            return !surely_number(static_cast<AddExpr *>(e)->lhs) || !surely_number(static_cast<AddExpr *>(e)->rhs);
+
+        case expr_mult:
+            return !surely_number(static_cast<MultExpr *>(e)->lhs) || !surely_number(static_cast<MultExpr *>(e)->rhs);
+
+        case expr_if: {
+            expr_kind_t condition = static_cast<IfExpr *>(e)->ifExpr->kind;
+            return condition != expr_eq && condition != expr_bool;
+        }
+
+        case expr_call:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * \brief Picks the candidates of the last collect to bind, in the order their first copies are evaluated
+ *
+ * A candidate is only picked while every node that may fail before its first copy lies inside a copy of a candidate
+ * already picked, which is then evaluated before it too. The copies of a picked candidate never overlap those of
+ * another one.
+ * @return - the candidates to bind
+ */
+std::vector<CSE::Candidate *> CSE::choose() {
+    std::vector<Candidate *> order;
+    for ( auto &entry : candidates ) {
+        for ( Candidate &candidate : entry.second ) {
+            if ( candidate.hits >= 1 && candidate.hits + candidate.extra >= 2 ) {
+                order.push_back(&candidate);
+            }
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const Candidate *a, const Candidate *b) {
+        return a->first < b->first;
+    });
+
+    std::map<uint32_t, uint32_t> claimed; //from the first position of a copy to the one after it
+    auto overlaps = [&claimed](uint32_t start, uint32_t end) {
+        auto next = claimed.lower_bound(start);
+        if ( next != claimed.end() && next->first < end ) {
+            return true;
+        }
+        return next != claimed.begin() && std::prev(next)->second > start;
+    };
+
+    std::vector<Candidate *> picked;
+    size_t next_unsafe = 0;
+    for ( Candidate *candidate : order ) {
+        for ( ; next_unsafe < unsafe.size() && unsafe[next_unsafe].done < candidate->first; next_unsafe++ ) {
+            uint32_t position = unsafe[next_unsafe].position;
+            if ( !overlaps(position, position + 1)) {
+                return picked;
+            }
+        }
+
+        bool taken = false;
+        for ( uint32_t position : candidate->copies ) {
+            if ( overlaps(position, position + candidate->size)) {
+                taken = true;
+                break;
+            }
+        }
+        if ( taken ) {
+            continue;
+        }
+
+        for ( uint32_t position : candidate->copies ) {
+            claimed[position] = position + candidate->size;
+        }
+        picked.push_back(candidate);
+    }
+    return picked;
+}
+
+
+/**
+ * \brief Checks if a variable of an expression is rebound inside the region, at the point being walked
+ * @param e - the expression
+ * @return - true if one is
+ */
+bool CSE::shadowed(PTR(Expr) e) {
+    if ( bound.empty()) {
+        return false;
+    }
+    for ( symbol_t name : e->free_variables()) {
+        if ( bound.count(name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * \brief Replaces every copy of the targets that is not under a rebinding of their variables
+ * @param e - the expression to rewrite
+ * @param targets - the subexpressions, each with the variable that now holds its value
+ * @return - the rewritten expression
+ */
+PTR(Expr) CSE::replace(PTR(Expr) e, const targets_t &targets) {
+    auto found = targets.find(e->hash);
+    if ( found != targets.end()) {
+        for ( auto &target : found->second ) {
+            if ( target.first->equals(e) && !shadowed(e)) {
+                return NEW (VarExpr)(target.second);
+            }
+        }
+    }
+
+    switch ( e->kind ) {
+
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(&*e);
+            PTR(Expr) lhs = replace(add->lhs, targets);
+            return NEW (AddExpr)(lhs, replace(add->rhs, targets));
+        }
+
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(&*e);
+            PTR(Expr) lhs = replace(mult->lhs, targets);
+            return NEW (MultExpr)(lhs, replace(mult->rhs, targets));
+        }
+
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(&*e);
+            PTR(Expr) lhs = replace(eq->lhs, targets);
+            return NEW (EqExpr)(lhs, replace(eq->rhs, targets));
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(&*e);
+            PTR(Expr) condition = replace(ifExpr->ifExpr, targets);
+            PTR(Expr) then_expr = replace(ifExpr->thenExpr, targets);
+            return NEW (IfExpr)(condition, then_expr, replace(ifExpr->elseExpr, targets));
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(&*e);
+            PTR(Expr) rhs = replace(let->rhs, targets);
+            bound.insert(let->value);
+            PTR(Expr) body = replace(let->body, targets);
+            bound.erase(bound.find(let->value));
+            return NEW (LetExpr)(let->value, rhs, body);
+        }
+
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(&*e);
+            bound.insert(fun->formal_arg);
+            PTR(FunExpr) result = NEW (FunExpr)(fun->formal_arg, replace(fun->body, targets));
+            bound.erase(bound.find(fun->formal_arg));
+            result->source = fun->source;
+            return result;
+        }
+
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(&*e);
+            PTR(Expr) to_be_called = replace(call->to_be_called, targets);
+            return NEW (CallExpr)(to_be_called, replace(call->actual_arg, targets));
+        }
+
+        default:
+            return e;
+    }
+}
+
+
+/**
+ * \brief Makes a variable name that does not appear anywhere in the program
+ * @return - the interned name
+ */
+symbol_t CSE::fresh_name() {
+    while ( true ) {
+        symbol_t name = intern("cse" + std::to_string(++next_name));
+        if ( used_names.insert(name).second ) {
+            return name;
+        }
+    }
+}
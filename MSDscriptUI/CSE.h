@@ -0,0 +1,93 @@
+#ifndef MSDSCRIPT_CSE_H
+#define MSDSCRIPT_CSE_H
+
+/**
+ * \file CSE.h
+ * \brief common subexpression elimination
+ *
+ * Finds subexpressions that are evaluated more than once in the same scope and binds them once with a _let
+ */
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "pointer.h"
+#include "Symbol.h"
+
+class Expr;
+
+/**
+ * \brief Rewrites repeated subexpressions into a single _let binding
+ *
+ * The program is split into regions: the whole program, the body of every _fun, _let body and _if branch. The
+ * pass counts the compound subexpressions evaluated whenever a region is evaluated (everything but the insides
+ * of _if branches and _fun bodies). If one is repeated, or appears once there and again in a branch or
+ * function, it is bound to a fresh variable at the top of the region. Every copy is then replaced by that
+ * variable. Copies are grouped with equals, and a copy only counts when none of its variables are rebound by a
+ * _let or _fun inside the region, so shadowing never changes what a variable refers to.
+ *
+ * Binding a subexpression at the top of the region evaluates it before whatever came before its first copy, so
+ * it is only done when everything evaluated before that copy cannot fail or loop, or is itself bound before it.
+ * The program then raises the same error, or runs forever, exactly when it did before.
+ *
+ * Each round counts the region once and binds every subexpression that qualifies and does not overlap one bound
+ * before it, in the order their first copies are evaluated, and replaces all of them in one rewrite. A few rounds
+ * pick up the repeated parts of what the earlier rounds bound, then the nested regions are handled.
+ */
+class CSE {
+public:
+    PTR(Expr) eliminate(PTR(Expr) e);
+
+private:
+    static const int max_rounds = 4; ///< rounds of counting and replacing per region
+
+    struct Candidate {
+        PTR(Expr) expr; ///< the first copy seen
+        int hits; ///< copies evaluated whenever the region is
+        int extra; ///< copies in branches and functions
+        int size; ///< nodes in the subexpression
+        uint64_t first; ///< when the first copy evaluated whenever the region is starts, in collect's clock
+        std::vector<uint32_t> copies; ///< the position of every copy, in collect's numbering of the nodes
+    };
+
+    /**
+     * \brief A node of the region that may raise an error or loop
+     */
+    struct Unsafe {
+        uint64_t done; ///< when it finishes, in collect's clock
+        uint32_t position; ///< its position in collect's numbering of the nodes
+    };
+
+    typedef std::unordered_map<size_t, std::vector<std::pair<PTR(Expr), symbol_t>>> targets_t; ///< by hash
+
+    std::unordered_map<size_t, std::vector<Candidate>> candidates; ///< by structural hash
+    std::vector<Unsafe> unsafe; ///< in the order they finish
+    std::unordered_multiset<symbol_t> bound; ///< variables bound since the top of the region
+    std::unordered_multiset<symbol_t> scope; ///< variables bound around the region
+    int functions; ///< _fun bodies collect is in, which are not evaluated with the region
+    uint32_t next_position; ///< collect's numbering of the nodes, in the order they start
+    uint64_t clock; ///< counts every start and finish of a node in collect
+    std::unordered_set<symbol_t> used_names; ///< every variable in the program, fresh names avoid them
+    int next_name; ///< counter for fresh names
+
+    PTR(Expr) eliminate_region(PTR(Expr) e);
+
+    PTR(Expr) eliminate_nested(PTR(Expr) e);
+
+    int collect(PTR(Expr) e, bool unconditional);
+
+    bool may_fail(Expr *e);
+
+    std::vector<Candidate *> choose();
+
+    bool shadowed(PTR(Expr) e);
+
+    PTR(Expr) replace(PTR(Expr) e, const targets_t &targets);
+
+    symbol_t fresh_name();
+};
+
+
+#endif //MSDSCRIPT_CSE_H
@@ -0,0 +1,74 @@
+#include "Cancel.h"
+#include <stdexcept>
+
+/**
+ * \file Cancel.cpp
+ * \brief contains the per thread stop flag
+ */
+
+
+static thread_local const std::atomic<bool> *current_flag = nullptr;
+
+static thread_local const char *stack_limit = nullptr; ///< lowest stack address a call may start at, stacks grow down
+
+
+/**
+ * \brief Describes the cancellation
+ * @return - the message
+ */
+const char *EvalCancelled::what() const noexcept {
+    return "evaluation cancelled";
+}
+
+
+/**
+ * \brief Makes a flag the one checked on this thread until the end of the scope
+ * @param flag - set from any thread to stop the evaluation, it has to outlive the scope
+ * @param stack_budget - bytes of stack below the scope that calls may use, 0 for no limit
+ */
+CancelScope::CancelScope(const std::atomic<bool> &flag, size_t stack_budget) {
+    this->previous = current_flag;
+    this->previous_limit = stack_limit;
+    current_flag = &flag;
+
+    if ( stack_budget > 0 ) {
+        char here;
+        stack_limit = &here - stack_budget;
+    }
+}
+
+
+/**
+ * \brief Restores the previous flag
+ */
+CancelScope::~CancelScope() {
+    current_flag = previous;
+    stack_limit = previous_limit;
+}
+
+
+/**
+ * \brief Stops the evaluation running on this thread if its flag was set
+ *
+ * Does nothing outside of any CancelScope, throws EvalCancelled otherwise once the flag is set, and a
+ * std::runtime_error once the calls went past the stack budget of the scope
+ */
+void check_cancelled() {
+    if ( current_flag != nullptr && current_flag->load(std::memory_order_relaxed)) {
+        throw EvalCancelled();
+    }
+
+    char here;
+    if ( stack_limit != nullptr && &here < stack_limit ) {
+        throw std::runtime_error("recursion too deep");
+    }
+}
+
+
+/**
+ * \brief The stack budget of the current CancelScope, for code that cannot call check_cancelled
+ * @return - the lowest stack address a call may start at, nullptr when there is no budget
+ */
+const char *current_stack_limit() {
+    return stack_limit;
+}
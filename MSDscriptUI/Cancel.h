@@ -0,0 +1,58 @@
+#ifndef MSDSCRIPT_CANCEL_H
+#define MSDSCRIPT_CANCEL_H
+
+/**
+ * \file Cancel.h
+ * \brief cooperative cancellation of a running evaluation
+ *
+ * A thread that wants its evaluations to be stoppable opens a CancelScope on a flag another thread can set. Every
+ * function call in interp(), the CEK machine and the VM checks the flag, so an evaluation stops at its next call,
+ * which every evaluation that does not finish keeps making, and unwinds normally.
+ *
+ * interp() recurses on the native stack for every call, so a scope can also be given a stack budget. A call that
+ * would go deeper than that raises an ordinary error instead of overflowing the stack of the thread. The parser
+ * checks the same way at every nested expression.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+
+/**
+ * \brief Thrown by check_cancelled once the flag of the current CancelScope is set
+ *
+ * It is not a std::runtime_error, so code that handles evaluation errors does not mistake it for one.
+ */
+class EvalCancelled : public std::exception {
+public:
+    const char *what() const noexcept override;
+};
+
+
+/**
+ * \brief Makes a flag the one checked by evaluations on this thread until the scope ends
+ *
+ * The previous flag and stack budget are restored afterwards, so scopes can nest.
+ */
+class CancelScope {
+public:
+    explicit CancelScope(const std::atomic<bool> &flag, size_t stack_budget = 0);
+
+    ~CancelScope();
+
+    CancelScope(const CancelScope &) = delete;
+
+    CancelScope &operator=(const CancelScope &) = delete;
+
+private:
+    const std::atomic<bool> *previous; ///< the flag that was checked before
+    const char *previous_limit; ///< the stack limit that was checked before
+};
+
+
+void check_cancelled();
+
+const char *current_stack_limit();
+
+
+#endif //MSDSCRIPT_CANCEL_H
@@ -3,28 +3,212 @@
 //
 
 #include "Env.h"
+#include <stdexcept>
 
 
-PTR(Env) Env::empty = NEW(EmptyEnv)();
+#if USE_GC_POINTERS
+//not owned by any heap, so no thread ever collects it
+static EmptyEnv empty_env;
+PTR(Env) const Env::empty = &empty_env;
+#else
+PTR(Env) const Env::empty = NEW(EmptyEnv)();
+#endif
 
 
-ExtendedEnv::ExtendedEnv(std::string name, PTR(Val) val, PTR(Env) rest) {
+ExtendedEnv::ExtendedEnv(symbol_t name, PTR(Val) val, PTR(Env) rest) {
+    this->name = name;
+    this->val = Value::from_val(val);
+    this->rest = rest;
+}
+
+
+ExtendedEnv::ExtendedEnv(symbol_t name, Value val, PTR(Env) rest) {
     this->name = name;
     this->val = val;
     this->rest = rest;
 }
 
 
-PTR(Val) EmptyEnv::lookup(std::string find_name) {
-    throw std::runtime_error("free variable: " + find_name);
+void Env::set_slot(int slot, Value val) {
+    throw std::runtime_error("environment has no slots");
+}
+
+
+PTR(Val) EmptyEnv::lookup(symbol_t find_name) {
+    throw std::runtime_error("free variable: " + symbol_name(find_name));
+}
+
+
+Value EmptyEnv::lookup_at(int depth, int slot) {
+    throw std::runtime_error("binding depth out of range");
+}
+
+
+bool EmptyEnv::find(symbol_t find_name, Value &val) {
+    return false;
+}
+
+
+PTR(Env) EmptyEnv::outer(int depth) {
+    return THIS;
 }
 
 
-PTR(Val) ExtendedEnv::lookup(std::string find_name) {
+PTR(Val) ExtendedEnv::lookup(symbol_t find_name) {
     if ( find_name == name ) {
-        return val;
+        return val.to_val();
     } else {
         return rest->lookup(find_name);
     }
 }
 
+
+Value ExtendedEnv::lookup_at(int depth, int slot) {
+    if ( depth == 0 ) {
+        return val;
+    } else {
+        return rest->lookup_at(depth - 1, slot);
+    }
+}
+
+
+bool ExtendedEnv::find(symbol_t find_name, Value &val) {
+    if ( find_name == name ) {
+        val = this->val;
+        return true;
+    } else {
+        return rest->find(find_name, val);
+    }
+}
+
+
+PTR(Env) ExtendedEnv::outer(int depth) {
+    if ( depth == 0 ) {
+        return THIS;
+    } else {
+        return rest->outer(depth - 1);
+    }
+}
+
+
+#if USE_GC_POINTERS
+void ExtendedEnv::trace(GcHeap &heap) {
+    heap.mark(val);
+    heap.mark(rest);
+}
+#endif
+
+
+FrameEnv::FrameEnv(int frame_size, Value arg, PTR(Env) rest) : locals(frame_size - 1) {
+    this->arg = arg;
+    this->rest = rest;
+}
+
+
+PTR(Val) FrameEnv::lookup(symbol_t find_name) {
+    return rest->lookup(find_name);
+}
+
+
+Value FrameEnv::lookup_at(int depth, int slot) {
+    if ( depth == 0 ) {
+        return slot == 0 ? arg : locals[slot - 1];
+    } else {
+        return rest->lookup_at(depth - 1, slot);
+    }
+}
+
+
+bool FrameEnv::find(symbol_t find_name, Value &val) {
+    return rest->find(find_name, val);
+}
+
+
+PTR(Env) FrameEnv::outer(int depth) {
+    if ( depth == 0 ) {
+        return THIS;
+    } else {
+        return rest->outer(depth - 1);
+    }
+}
+
+
+void FrameEnv::set_slot(int slot, Value val) {
+    if ( slot == 0 ) {
+        arg = val;
+    } else {
+        locals[slot - 1] = val;
+    }
+}
+
+
+#if USE_GC_POINTERS
+void FrameEnv::trace(GcHeap &heap) {
+    heap.mark(arg);
+    for ( const Value &local : locals ) {
+        heap.mark(local);
+    }
+    heap.mark(rest);
+}
+#endif
+
+
+ClosureEnv::ClosureEnv(const std::vector<EnvAddress> &captures, PTR(Env) rest, PTR(Env) env) {
+    for ( size_t i = 0; i < captures.size(); i++ ) {
+        Value val = env->lookup_at(captures[i].depth, captures[i].slot);
+        if ( i < inline_size ) {
+            first[i] = val;
+        } else {
+            more.push_back(val);
+        }
+    }
+    this->rest = rest;
+}
+
+
+//a closure that captures nothing keeps only the environment the program was started in
+PTR(Env) ClosureEnv::make(const std::vector<EnvAddress> &captures, int outer_depth, PTR(Env) env) {
+    PTR(Env) rest = env->outer(outer_depth);
+    if ( captures.empty()) {
+        return rest;
+    }
+    return NEW (ClosureEnv)(captures, rest, env);
+}
+
+
+PTR(Val) ClosureEnv::lookup(symbol_t find_name) {
+    return rest->lookup(find_name);
+}
+
+
+Value ClosureEnv::lookup_at(int depth, int slot) {
+    if ( depth == 0 ) {
+        return (size_t) slot < inline_size ? first[slot] : more[slot - inline_size];
+    } else {
+        return rest->lookup_at(depth - 1, slot);
+    }
+}
+
+
+bool ClosureEnv::find(symbol_t find_name, Value &val) {
+    return rest->find(find_name, val);
+}
+
+
+//not counted, closures that capture nothing do not have one
+PTR(Env) ClosureEnv::outer(int depth) {
+    return rest->outer(depth);
+}
+
+
+#if USE_GC_POINTERS
+void ClosureEnv::trace(GcHeap &heap) {
+    for ( const Value &captured : first ) {
+        heap.mark(captured);
+    }
+    for ( const Value &captured : more ) {
+        heap.mark(captured);
+    }
+    heap.mark(rest);
+}
+#endif
@@ -4,17 +4,38 @@
 #pragma once
 
 #include "pointer.h"
+#include "Value.h"
+#include "Symbol.h"
 #include "string"
 #include <stdio.h>
+#include <vector>
 
 class Val;
 
-CLASS (Env) {
+/**
+ * \brief Where a variable is, frames up from an environment and the slot in that frame
+ */
+struct EnvAddress {
+    int depth;
+    int slot;
+};
+
+
+GC_CLASS (Env) {
 
 public:
-    static PTR(Env) empty;
+    //created before main and never reassigned, so every thread can read it without a lock
+    static PTR(Env) const empty;
+
+    virtual PTR(Val) lookup(symbol_t find_name) = 0;
+
+    virtual Value lookup_at(int depth, int slot) = 0;
+
+    virtual bool find(symbol_t find_name, Value &val) = 0;
 
-    virtual PTR(Val) lookup(std::string find_name) = 0;
+    virtual PTR(Env) outer(int depth) = 0;
+
+    virtual void set_slot(int slot, Value val);
 
 };
 
@@ -24,20 +45,107 @@ public:
 
     EmptyEnv() = default;
 
-    PTR(Val) lookup(std::string find_name);
+    PTR(Val) lookup(symbol_t find_name);
+
+    Value lookup_at(int depth, int slot);
+
+    bool find(symbol_t find_name, Value &val);
+
+    PTR(Env) outer(int depth);
 
 };
 
 
 class ExtendedEnv : public Env {
 private:
-    std::string name;
-    PTR(Val) val;
+    symbol_t name;
+    Value val;
+    PTR(Env) rest;
+
+public:
+    ExtendedEnv(symbol_t name, PTR(Val) val, PTR(Env) rest);
+
+    ExtendedEnv(symbol_t name, Value val, PTR(Env) rest);
+
+    PTR(Val) lookup(symbol_t find_name);
+
+    Value lookup_at(int depth, int slot);
+
+    bool find(symbol_t find_name, Value &val);
+
+    PTR(Env) outer(int depth);
+
+#if USE_GC_POINTERS
+    void trace(GcHeap &heap);
+#endif
+
+    friend class PreludeWriter;
+
+};
+
+
+/**
+ * \brief The environment of one function call, with a numbered slot for the argument and every _let in the body
+ *
+ * Variables annotated by the Resolver are read straight out of a slot. A frame counts as one level of depth,
+ * just like an ExtendedEnv.
+ */
+class FrameEnv : public Env {
+private:
+    Value arg; ///< slot 0
+    std::vector<Value> locals; ///< slots 1 and up, empty for functions without a _let
     PTR(Env) rest;
 
 public:
-    ExtendedEnv(std::string name, PTR(Val) val, PTR(Env) rest);
+    FrameEnv(int frame_size, Value arg, PTR(Env) rest);
+
+    PTR(Val) lookup(symbol_t find_name);
+
+    Value lookup_at(int depth, int slot);
+
+    bool find(symbol_t find_name, Value &val);
+
+    PTR(Env) outer(int depth);
+
+    void set_slot(int slot, Value val);
+
+#if USE_GC_POINTERS
+    void trace(GcHeap &heap);
+#endif
+
+};
+
+
+/**
+ * \brief The environment of a closure, only the variables its body uses copied out of where the _fun was evaluated
+ *
+ * The Resolver numbers the variables a _fun captures, its body reads them at depth 1, below the FrameEnv of the
+ * call. Nothing else of the enclosing environments is kept alive, except the environment the program was started
+ * in, where free variables are looked up by name. A closure that captures nothing keeps only that one, see make().
+ */
+class ClosureEnv : public Env {
+private:
+    static const size_t inline_size = 2; ///< captures kept in the object itself, most closures have no more
+
+    Value first[inline_size]; ///< the first captured values, in the order of the Resolver's capture list
+    std::vector<Value> more; ///< the captured values after those
+    PTR(Env) rest; ///< the environment the program was started in
+
+public:
+    ClosureEnv(const std::vector<EnvAddress> &captures, PTR(Env) rest, PTR(Env) env);
+
+    static PTR(Env) make(const std::vector<EnvAddress> &captures, int outer_depth, PTR(Env) env);
+
+    PTR(Val) lookup(symbol_t find_name);
+
+    Value lookup_at(int depth, int slot);
+
+    bool find(symbol_t find_name, Value &val);
+
+    PTR(Env) outer(int depth);
 
-    PTR(Val) lookup(std::string find_name);
+#if USE_GC_POINTERS
+    void trace(GcHeap &heap);
+#endif
 
 };
\ No newline at end of file
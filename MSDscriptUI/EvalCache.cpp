@@ -0,0 +1,358 @@
+#include "EvalCache.h"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include "parse.hpp"
+#include "CEK.h"
+#include "Expr.h"
+#include "Val.h"
+#include "ExprTable.h"
+#include "Optimizer.h"
+#include "Resolver.h"
+#include "TypeChecker.h"
+
+/**
+ * \file EvalCache.cpp
+ * \brief contains the implementation of the memoizing front end
+ */
+
+
+/**
+ * \brief Hashes a node by the structural hash its constructor computed
+ * @param e - a node of the table
+ * @return - the hash
+ */
+size_t EvalCache::StructuralHash::operator()(const Expr *e) const {
+    return e->hash;
+}
+
+
+/**
+ * \brief Constructor for an empty cache
+ * @param max_nodes - table size that makes the next parse start over
+ * @param min_size - smallest subtree, in nodes, whose value is kept
+ */
+EvalCache::EvalCache(size_t max_nodes, int min_size) {
+    this->table.reset(new ExprTable());
+    this->max_nodes = max_nodes;
+    this->min_size = min_size;
+    this->hit_count = 0;
+    this->last_root = nullptr;
+    this->printed_root = nullptr;
+    this->vars_bound = false;
+}
+
+
+/**
+ * \brief Destructor, drops the nodes before the arena that holds them
+ */
+EvalCache::~EvalCache() {
+    clear();
+}
+
+
+/**
+ * \brief Forgets every node, value and printed text
+ */
+void EvalCache::clear() {
+    values.clear();
+    infos.clear();
+    printed_root = nullptr;
+    printed.clear();
+    last_root = nullptr;
+    last_text.clear();
+    table.reset(new ExprTable());
+#if USE_ARENA_POINTERS || USE_GC_POINTERS
+    arena.reset();
+#endif
+}
+
+
+/**
+ * \brief Number of subtrees that were replaced by a kept value
+ * @return - the count since the cache was made
+ */
+size_t EvalCache::hits() const {
+    return hit_count;
+}
+
+
+/**
+ * \brief Parses a program into the table, the same text is only parsed once
+ * @param text - the program
+ * @return - its canonical tree, which shares unchanged subtrees with earlier programs
+ */
+PTR(Expr) EvalCache::parse(const std::string &text) {
+    if ( last_root != nullptr && text == last_text ) {
+        return last_root;
+    }
+
+    if ( table->size() > max_nodes ) {
+        clear();
+    }
+
+#if USE_ARENA_POINTERS || USE_GC_POINTERS
+    ArenaScope scope(arena, false);
+#endif
+    last_root = parse_str(text, *table);
+    last_text = text;
+    return last_root;
+}
+
+
+/**
+ * \brief Evaluates a program, taking the value of every closed subtree seen before from the cache
+ * @param text - the program
+ * @return - the value printed with to_string
+ */
+std::string EvalCache::interp(const std::string &text) {
+    PTR(Expr) root = parse(text);
+    if ( root->height > max_recursive_height ) {
+        //the cache walks the tree recursively too, so nothing of a deep program is kept
+        return cek_interp(root)->to_string();
+    }
+    vars_bound = info(&*root).free.empty();
+
+    PTR(Expr) residual;
+    try {
+        bool pending;
+        residual = reduce(root, pending);
+    } catch ( const std::runtime_error & ) {
+        //the optimizer may move work around, so the whole program is evaluated again to raise the error it raises
+        residual = root;
+    }
+
+    Optimizer optimizer;
+    Resolver resolver;
+    TypeChecker checker;
+    PTR(Expr) program = resolver.resolve(optimizer.optimize(residual));
+    checker.check(program);
+    return program->interp()->to_string();
+}
+
+
+/**
+ * \brief Pretty prints a program, printing again only when it changed
+ * @param text - the program
+ * @return - the text of to_string_pretty
+ */
+std::string EvalCache::pretty_print(const std::string &text) {
+    PTR(Expr) root = parse(text);
+    if ( &*root != printed_root ) {
+        printed = root->to_string_pretty();
+        printed_root = &*root;
+    }
+    return printed;
+}
+
+
+/**
+ * \brief Returns the free variables and size of a node, working them out once per node
+ * @param e - a node of the table
+ * @return - what is known about it, valid until the next clear
+ */
+const EvalCache::Info &EvalCache::info(Expr *e) {
+    auto found = infos.find(e);
+    if ( found != infos.end()) {
+        return found->second;
+    }
+
+    Info result;
+    result.size = 1;
+
+    //adds a child's free variables, without bound when it is bound around the child
+    auto add_child = [&](Expr *child, symbol_t bound, bool binds) {
+        const Info &child_info = info(child);
+        std::vector<symbol_t> merged;
+        std::set_union(result.free.begin(), result.free.end(), child_info.free.begin(), child_info.free.end(),
+                       std::back_inserter(merged));
+        if ( binds ) {
+            auto it = std::find(merged.begin(), merged.end(), bound);
+            bool outer = std::binary_search(result.free.begin(), result.free.end(), bound);
+            if ( it != merged.end() && !outer ) {
+                merged.erase(it);
+            }
+        }
+        result.free.swap(merged);
+        result.size += child_info.size;
+    };
+
+    switch ( e->kind ) {
+        case expr_num:
+        case expr_bool:
+            break;
+        case expr_var:
+            result.free.push_back(static_cast<VarExpr *>(e)->value);
+            break;
+        case expr_add:
+            add_child(&*static_cast<AddExpr *>(e)->lhs, 0, false);
+            add_child(&*static_cast<AddExpr *>(e)->rhs, 0, false);
+            break;
+        case expr_mult:
+            add_child(&*static_cast<MultExpr *>(e)->lhs, 0, false);
+            add_child(&*static_cast<MultExpr *>(e)->rhs, 0, false);
+            break;
+        case expr_eq:
+            add_child(&*static_cast<EqExpr *>(e)->lhs, 0, false);
+            add_child(&*static_cast<EqExpr *>(e)->rhs, 0, false);
+            break;
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(e);
+            add_child(&*let->rhs, 0, false);
+            add_child(&*let->body, let->value, true);
+            break;
+        }
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            add_child(&*ifExpr->ifExpr, 0, false);
+            add_child(&*ifExpr->thenExpr, 0, false);
+            add_child(&*ifExpr->elseExpr, 0, false);
+            break;
+        }
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(e);
+            add_child(&*fun->body, fun->formal_arg, true);
+            break;
+        }
+        case expr_call:
+            add_child(&*static_cast<CallExpr *>(e)->to_be_called, 0, false);
+            add_child(&*static_cast<CallExpr *>(e)->actual_arg, 0, false);
+            break;
+    }
+
+    return infos.emplace(e, std::move(result)).first->second;
+}
+
+
+/**
+ * \brief Replaces the closed subtrees interp() would evaluate next by their values
+ *
+ * A closed subtree of min_size nodes or more is looked up, and evaluated and kept when it is not there yet.
+ * @param e - a node of the table
+ * @param pending - set when the result still has work that could fail or not finish, nothing after it in
+ * evaluation order may be evaluated ahead of it then
+ * @return - an expression with the same value and the same errors
+ */
+PTR(Expr) EvalCache::reduce(PTR(Expr) e, bool &pending) {
+    const Info &node = info(&*e);
+    if ( !node.free.empty() || node.size < min_size ) {
+        return reduce_children(e, pending);
+    }
+
+    auto found = values.find(&*e);
+    if ( found == values.end()) {
+        PTR(Expr) residual = reduce_children(e, pending);
+
+        Optimizer optimizer;
+        Resolver resolver;
+        TypeChecker checker;
+        PTR(Expr) program = resolver.resolve(optimizer.optimize(residual));
+        checker.check(program);
+        Value value = Value::from_val(program->interp());
+        if ( value.tag == tag_object ) {
+            //from_val keeps NumVal and BoolVal boxed, unwrap them so they can be kept
+            if ( PTR(NumVal) num = CAST (NumVal)(value.object)) {
+                value = Value::from_int(num->val);
+            } else if ( PTR(BoolVal) boolean = CAST (BoolVal)(value.object)) {
+                value = Value::from_bool(boolean->boolean);
+            } else {
+                //a closure is not kept, but the residual just evaluated without an error
+                pending = false;
+                return residual;
+            }
+        }
+        found = values.emplace(&*e, value).first;
+    } else {
+        hit_count++;
+    }
+
+    pending = false;
+    if ( found->second.tag == tag_int ) {
+        return NEW (NumExpr)(found->second.num);
+    }
+    return NEW (BoolExpr)(found->second.boolean);
+}
+
+
+/**
+ * \brief Reduces the children of a node that is not kept itself, in the order interp() evaluates them
+ *
+ * Once a child is left pending the later ones are not touched, and the bodies of _fun and the branches of an _if
+ * whose condition is not a literal are never reduced.
+ * @param e - the node
+ * @param pending - set when the result still has work that could fail or not finish
+ * @return - the node, or a copy of it with reduced children
+ */
+PTR(Expr) EvalCache::reduce_children(PTR(Expr) e, bool &pending) {
+    bool first_pending = false;
+    bool second_pending = false;
+
+    switch ( e->kind ) {
+        case expr_num:
+        case expr_bool:
+        case expr_fun:
+            pending = false;
+            return e;
+
+        case expr_var:
+            pending = !vars_bound;
+            return e;
+
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(&*e);
+            PTR(Expr) lhs = reduce(add->lhs, first_pending);
+            PTR(Expr) rhs = first_pending ? add->rhs : reduce(add->rhs, second_pending);
+            pending = true;
+            return lhs == add->lhs && rhs == add->rhs ? e : NEW (AddExpr)(lhs, rhs);
+        }
+
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(&*e);
+            PTR(Expr) lhs = reduce(mult->lhs, first_pending);
+            PTR(Expr) rhs = first_pending ? mult->rhs : reduce(mult->rhs, second_pending);
+            pending = true;
+            return lhs == mult->lhs && rhs == mult->rhs ? e : NEW (MultExpr)(lhs, rhs);
+        }
+
+        case expr_eq: {
+            //comparing two values that were computed cannot fail
+            EqExpr *eq = static_cast<EqExpr *>(&*e);
+            PTR(Expr) lhs = reduce(eq->lhs, first_pending);
+            PTR(Expr) rhs = first_pending ? eq->rhs : reduce(eq->rhs, second_pending);
+            pending = first_pending || second_pending;
+            return lhs == eq->lhs && rhs == eq->rhs ? e : NEW (EqExpr)(lhs, rhs);
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(&*e);
+            PTR(Expr) rhs = reduce(let->rhs, first_pending);
+            PTR(Expr) body = first_pending ? let->body : reduce(let->body, second_pending);
+            pending = first_pending || second_pending;
+            return rhs == let->rhs && body == let->body ? e : NEW (LetExpr)(let->value, rhs, body);
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(&*e);
+            PTR(Expr) condition = reduce(ifExpr->ifExpr, first_pending);
+            if ( !first_pending && condition->kind == expr_bool ) {
+                //the branch that is taken is all that is left
+                return reduce(static_cast<BoolExpr *>(&*condition)->boolean ? ifExpr->thenExpr : ifExpr->elseExpr,
+                              pending);
+            }
+            pending = true;
+            return condition == ifExpr->ifExpr ? e : NEW (IfExpr)(condition, ifExpr->thenExpr, ifExpr->elseExpr);
+        }
+
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(&*e);
+            PTR(Expr) to_be_called = reduce(call->to_be_called, first_pending);
+            PTR(Expr) actual_arg = first_pending ? call->actual_arg : reduce(call->actual_arg, second_pending);
+            pending = true;
+            return to_be_called == call->to_be_called && actual_arg == call->actual_arg ? e :
+                   NEW (CallExpr)(to_be_called, actual_arg);
+        }
+    }
+
+    pending = true;
+    return e;
+}
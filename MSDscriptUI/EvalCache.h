@@ -0,0 +1,103 @@
+#ifndef MSDSCRIPT_EVALCACHE_H
+#define MSDSCRIPT_EVALCACHE_H
+
+/**
+ * \file EvalCache.h
+ * \brief memoized parsing and evaluation across edits of the same program
+ *
+ * Keeps parsed programs in one hash-consing table between evaluations, so an edited program shares every unchanged
+ * subtree with the previous one, and remembers the value of closed subtrees by node
+ */
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "pointer.h"
+#include "Symbol.h"
+#include "Value.h"
+#include "Arena.h"
+
+class Expr;
+
+class ExprTable;
+
+/**
+ * \brief Parses and evaluates programs, reusing the work done for earlier versions of them
+ *
+ * A subtree without free variables always has the same value. Once one of at least min_size nodes has evaluated to
+ * an integer or a boolean, the value is kept, and the next program that contains the same subtree gets the literal
+ * instead. Since the table gives equal subtrees the same node, the values are found by node, hashed by the
+ * structural hash. Editing one literal only changes the nodes on the path to the root, everything beside that path
+ * comes from the cache.
+ *
+ * Subtrees are only evaluated where interp() would evaluate them anyway and in the same order, so code in an
+ * untaken branch or an uncalled function is never run. A program that raises an error is evaluated again in full,
+ * so it reports the error it always did.
+ *
+ * Nodes live as long as the cache, so in the arena and gc pointer modes they are kept in an arena of its own. Values
+ * and residual programs are made in the current arena. When the table grows past max_nodes everything is dropped.
+ */
+class EvalCache {
+public:
+    explicit EvalCache(size_t max_nodes = 1 << 20, int min_size = 8);
+
+    ~EvalCache();
+
+    EvalCache(const EvalCache &) = delete;
+
+    EvalCache &operator=(const EvalCache &) = delete;
+
+    PTR(Expr) parse(const std::string &text);
+
+    std::string interp(const std::string &text);
+
+    std::string pretty_print(const std::string &text);
+
+    void clear();
+
+    size_t hits() const;
+
+private:
+    /**
+     * \brief What the cache knows about one node, which never changes since nodes are never modified
+     */
+    struct Info {
+        std::vector<symbol_t> free; ///< free variables, sorted
+        int size; ///< nodes in the subtree
+    };
+
+    /**
+     * \brief Hashes a canonical node by its structure, equal structures are the same node
+     */
+    struct StructuralHash {
+        size_t operator()(const Expr *e) const;
+    };
+
+#if USE_ARENA_POINTERS || USE_GC_POINTERS
+    Arena arena; ///< holds the nodes of the table
+#endif
+    std::unique_ptr<ExprTable> table; ///< every node parsed since the last clear
+    size_t max_nodes; ///< table size that makes the next parse start over
+    int min_size; ///< smallest subtree whose value is kept
+    size_t hit_count; ///< subtrees replaced by a kept value since the cache was made
+
+    std::string last_text; ///< the text parsed last
+    PTR(Expr) last_root; ///< its canonical tree
+    Expr *printed_root; ///< the tree printed last
+    std::string printed; ///< how it printed
+
+    std::unordered_map<const Expr *, Info, StructuralHash> infos; ///< free variables and size of every node seen
+    std::unordered_map<const Expr *, Value, StructuralHash> values; ///< values of closed subtrees
+    bool vars_bound; ///< whether the program being reduced is closed, so looking up a variable cannot fail
+
+    const Info &info(Expr *e);
+
+    PTR(Expr) reduce(PTR(Expr) e, bool &pending);
+
+    PTR(Expr) reduce_children(PTR(Expr) e, bool &pending);
+};
+
+
+#endif //MSDSCRIPT_EVALCACHE_H
@@ -5,6 +5,10 @@
 #include "Expr.h"
 #include "Val.h"
 #include "Env.h"
+#include "ExprPrinter.h"
+#include "Jit.h"
+#include <algorithm>
+#include <vector>
 
 /**
  * \file Expr.cpp
@@ -16,13 +20,219 @@
  */
 
 
+/**
+ * \brief Mixes the kind and fields of a node into a structural hash
+ * @param kind - the kind of node
+ * @param a - the first field, a value or a child's hash
+ * @param b - the second field, 0 when unused
+ * @param c - the third field, 0 when unused
+ * @return - a hash that is equal for structurally equal nodes
+ */
+size_t expr_hash(expr_kind_t kind, size_t a, size_t b, size_t c) {
+    size_t h = (size_t) kind + 1;
+    h ^= a + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= b + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= c + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief Drops a reference to a child node without recursing into it
+ *
+ * When this is the last reference, the child is moved to a worklist owned by the outermost call and freed from
+ * there, so freeing a tree takes constant stack no matter how deep it is
+ * @param child - the child pointer of a node that is being destroyed
+ */
+void release_expr(PTR(Expr) &child) {
+    static thread_local std::vector<PTR(Expr)> *pending = nullptr;
+
+    if ( child == nullptr || child.use_count() != 1 ) {
+        return;
+    }
+
+    if ( pending != nullptr ) {
+        pending->push_back(std::move(child));
+        return;
+    }
+
+    std::vector<PTR(Expr)> worklist;
+    pending = &worklist;
+    worklist.push_back(std::move(child));
+    while ( !worklist.empty()) {
+        //freeing the node runs its destructor, which adds its own children to the worklist
+        PTR(Expr) next = std::move(worklist.back());
+        worklist.pop_back();
+        next.reset();
+    }
+    pending = nullptr;
+}
+
+#endif
+
+
+/**
+ * \brief Interprets the expression into a tagged value
+ *
+ * Numbers and booleans stay immediate all the way through arithmetic, comparisons, _lets and calls, so only the
+ * final result of interp() is boxed. Nodes without an immediate result wrap what interp() returns.
+ * @param env - the environment to evaluate in
+ * @return - the value of the expression
+ */
+Value Expr::interp_value(PTR(Env) env) {
+    return Value::from_val(interp(env));
+}
+
+
+/**
+ * \brief Prints the expression with every operation parenthesized
+ * \param ot, a an output stream
+ */
+void Expr::print(std::ostream &ot) {
+    ot << to_string();
+}
+
+
+/**
+ * \brief Prints the expression over several lines with indentation
+ * \param ot, a an output stream
+ */
+void Expr::pretty_print(std::ostream &ot) {
+    ot << to_string_pretty();
+}
+
+
+/**
+ * \brief Returns what print writes
+ * \return the printed expression
+ */
+std::string Expr::to_string() {
+    ExprPrinter printer;
+    return printer.print(this);
+}
+
+
+/**
+ * \brief Returns what pretty_print writes
+ * \return the pretty printed expression
+ */
+std::string Expr::to_string_pretty() {
+    ExprPrinter printer;
+    return printer.pretty_print(this);
+}
+
+
+/**
+ * \brief Adds the free variables of a child to a sorted set
+ * @param result - the set so far
+ * @param child - the free variables of the child
+ * @param bound - a variable the parent binds around the child, which is not free there
+ * @param binds - whether bound is used
+ */
+static void add_free_variables(std::vector<symbol_t> &result, const std::vector<symbol_t> &child,
+                               symbol_t bound = 0, bool binds = false) {
+    std::vector<symbol_t> merged;
+    merged.reserve(result.size() + child.size());
+
+    size_t i = 0;
+    for ( symbol_t name : child ) {
+        if ( binds && name == bound ) {
+            continue;
+        }
+        while ( i < result.size() && result[i] < name ) {
+            merged.push_back(result[i++]);
+        }
+        if ( i < result.size() && result[i] == name ) {
+            i++;
+        }
+        merged.push_back(name);
+    }
+    merged.insert(merged.end(), result.begin() + (long) i, result.end());
+    result.swap(merged);
+}
+
+
+/**
+ * \brief The variables the expression uses without binding them
+ *
+ * Worked out on the first call and kept in the node, along with the sets of all its children, nodes are never
+ * changed once made
+ * @return - the free variables, sorted
+ */
+const std::vector<symbol_t> &Expr::free_variables() {
+    if ( free_vars != nullptr ) {
+        return *free_vars;
+    }
+
+    std::vector<symbol_t> result;
+    switch ( kind ) {
+        case expr_num:
+        case expr_bool:
+            break;
+
+        case expr_var:
+            result.push_back(static_cast<VarExpr *>(this)->value);
+            break;
+
+        case expr_add:
+            add_free_variables(result, static_cast<AddExpr *>(this)->lhs->free_variables());
+            add_free_variables(result, static_cast<AddExpr *>(this)->rhs->free_variables());
+            break;
+
+        case expr_mult:
+            add_free_variables(result, static_cast<MultExpr *>(this)->lhs->free_variables());
+            add_free_variables(result, static_cast<MultExpr *>(this)->rhs->free_variables());
+            break;
+
+        case expr_eq:
+            add_free_variables(result, static_cast<EqExpr *>(this)->lhs->free_variables());
+            add_free_variables(result, static_cast<EqExpr *>(this)->rhs->free_variables());
+            break;
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(this);
+            add_free_variables(result, let->rhs->free_variables());
+            add_free_variables(result, let->body->free_variables(), let->value, true);
+            break;
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(this);
+            add_free_variables(result, ifExpr->ifExpr->free_variables());
+            add_free_variables(result, ifExpr->thenExpr->free_variables());
+            add_free_variables(result, ifExpr->elseExpr->free_variables());
+            break;
+        }
+
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(this);
+            add_free_variables(result, fun->body->free_variables(), fun->formal_arg, true);
+            break;
+        }
+
+        case expr_call:
+            add_free_variables(result, static_cast<CallExpr *>(this)->to_be_called->free_variables());
+            add_free_variables(result, static_cast<CallExpr *>(this)->actual_arg->free_variables());
+            break;
+    }
+
+    free_vars.reset(new std::vector<symbol_t>(std::move(result)));
+    return *free_vars;
+}
+
+
 /**
  * \brief a constructor for a Num object
  * \param val, an integer value that is stored inside the object
  * \return a num object with the value inside
  */
 NumExpr::NumExpr(int val) {
+    this->kind = expr_num;
     this->val = val;
+    this->hash = expr_hash(expr_num, (unsigned) val);
+    this->height = 1;
 }
 
 
@@ -32,10 +242,13 @@ NumExpr::NumExpr(int val) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool NumExpr::equals(PTR(Expr) e) {
-    PTR(NumExpr) num = CAST (NumExpr)(e);
-    if ( num == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    NumExpr *num = static_cast<NumExpr *>(&*e);
     return this->val == num->val;
 }
 
@@ -49,6 +262,15 @@ PTR(Val) NumExpr::interp(PTR(Env) env) {
 }
 
 
+/**
+ * \brief Interprets the number as an immediate value
+ * \return the number
+ */
+Value NumExpr::interp_value(PTR(Env) env) {
+    return Value::from_int(val);
+}
+
+
 /**
  * \brief Checks if the number expression has a variable object in it
  * \return returns false
@@ -64,37 +286,15 @@ bool NumExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire number expression object with the substitution
  */
-PTR(Expr) NumExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) NumExpr::subst(symbol_t s, PTR(Expr) e) {
     return NEW (NumExpr)(this->val);
 }
 
 
-/**
- * \brief Function that prints the contents of the Num object
- * \param ot, a an output stream
- */
-void NumExpr::print(std::ostream &ot) {
-    ot << std::to_string(val);
-}
 
 
-/**
- * \brief Function that prints the contents of the Num object in a prettier format
- * \param ot, a an output stream
- */
-void NumExpr::pretty_print(std::ostream &ot) {
-    ot << std::to_string(val);
-}
 
 
-/**
- * \brief Helper function that prints the contents of the Num object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void NumExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
-    ot << std::to_string(val);
-}
 
 
 /**
@@ -103,10 +303,26 @@ void NumExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::st
  * \param rhs, right hand side of the expression
  */
 AddExpr::AddExpr(PTR(Expr) lhs, PTR(Expr) rhs) {
+    this->kind = expr_add;
     this->lhs = lhs;
     this->rhs = rhs;
+    this->hash = expr_hash(expr_add, lhs->hash, rhs->hash);
+    this->height = 1 + std::max(lhs->height, rhs->height);
+}
+
+
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief destructor that hands the children to release_expr instead of freeing them recursively
+ */
+AddExpr::~AddExpr() {
+    release_expr(this->lhs);
+    release_expr(this->rhs);
 }
 
+#endif
+
 
 /**
  * \brief takes an expression and compares other expressions of the same type and determines if they are equal expressions
@@ -114,10 +330,13 @@ AddExpr::AddExpr(PTR(Expr) lhs, PTR(Expr) rhs) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool AddExpr::equals(PTR(Expr) e) {
-    PTR(AddExpr) add = CAST (AddExpr)(e);
-    if ( add == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    AddExpr *add = static_cast<AddExpr *>(&*e);
     return this->lhs->equals(add->lhs) && this->rhs->equals(add->rhs);
 }
 
@@ -127,12 +346,27 @@ bool AddExpr::equals(PTR(Expr) e) {
  * \return an integer that gives the value of the objects in the left hand side and right hand side
  */
 PTR(Val) AddExpr::interp(PTR(Env) env) {
+    return interp_value(env).to_val();
+}
+
+
+/**
+ * \brief Adds the immediate values of both sides, the left hand side is evaluated first
+ * \return the sum
+ */
+Value AddExpr::interp_value(PTR(Env) env) {
     if ( env == nullptr ) {
         env = Env::empty;
     }
 
-    return lhs->interp(env)
-            ->add_to(rhs->interp(env));
+    Value lhs_val = lhs->interp_value(env);
+    Value rhs_val = rhs->interp_value(env);
+
+    //the TypeChecker proved both operands are numbers
+    if ( this->type == type_int ) {
+        return Value::from_int((int) ((unsigned) lhs_val.as_int() + (unsigned) rhs_val.as_int()));
+    }
+    return add_values(lhs_val, rhs_val);
 }
 
 
@@ -151,53 +385,15 @@ bool AddExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire add expression object with the substitution
  */
-PTR(Expr) AddExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) AddExpr::subst(symbol_t s, PTR(Expr) e) {
     return NEW (AddExpr)(this->lhs->subst(s, e), this->rhs->subst(s, e));
 }
 
 
-/**
- * \brief Function that prints the contents of the Add object with parentheses around each expression
- * \param ot, a an output stream
- */
-void AddExpr::print(std::ostream &ot) {
-    ot << "(";
-    this->lhs->print(ot);
-    ot << "+";
-    this->rhs->print(ot);
-    ot << ")";
-}
 
 
-/**
- * \brief Function that prints the contents of the Add object in a prettier format
- * \param ot, a an output stream
- */
-void AddExpr::pretty_print(std::ostream &ot) {
-    std::streampos position = ot.tellp();
-    pretty_print_at(ot, prec_add, position, false);
-}
-
-
-/**
- * \brief Helper function that prints the contents of the Add object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void AddExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
-
-    if ( precedence > prec_add ) {
-        ot << "(";
-    }
 
-    this->lhs->pretty_print_at(ot, static_cast<precedence_t>(prec_add + 1), pos, true);
-    ot << " + ";
-    this->rhs->pretty_print_at(ot, prec_add, pos, false);
 
-    if ( precedence > prec_add ) {
-        ot << ")";
-    }
-}
 
 
 /**
@@ -206,21 +402,40 @@ void AddExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::st
  * \param rhs, right hand side of the expression
  */
 MultExpr::MultExpr(PTR(Expr) lhs, PTR(Expr) rhs) {
+    this->kind = expr_mult;
     this->lhs = lhs;
     this->rhs = rhs;
+    this->hash = expr_hash(expr_mult, lhs->hash, rhs->hash);
+    this->height = 1 + std::max(lhs->height, rhs->height);
 }
 
 
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief destructor that hands the children to release_expr instead of freeing them recursively
+ */
+MultExpr::~MultExpr() {
+    release_expr(this->lhs);
+    release_expr(this->rhs);
+}
+
+#endif
+
+
 /**
  * \brief takes an expression and compares other expressions of the same type and determines if they are equal expressions
  * \param e, an expression which can be either a Num, Add, Mult, or Variable object
  * \return a boolean value based on if the object is equal to the other object
  */
 bool MultExpr::equals(PTR(Expr) e) {
-    PTR(MultExpr) mult = CAST (MultExpr)(e);
-    if ( mult == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    MultExpr *mult = static_cast<MultExpr *>(&*e);
     return this->lhs->equals(mult->lhs) && this->rhs->equals(mult->rhs);
 }
 
@@ -230,12 +445,27 @@ bool MultExpr::equals(PTR(Expr) e) {
  * \return an integer that gives the value of the objects in the left hand side and right hand side
  */
 PTR(Val) MultExpr::interp(PTR(Env) env) {
+    return interp_value(env).to_val();
+}
+
+
+/**
+ * \brief Multiplies the immediate values of both sides, the left hand side is evaluated first
+ * \return the product
+ */
+Value MultExpr::interp_value(PTR(Env) env) {
     if ( env == nullptr ) {
         env = Env::empty;
     }
 
-    return lhs->interp(env)
-            ->mult_with(rhs->interp(env));
+    Value lhs_val = lhs->interp_value(env);
+    Value rhs_val = rhs->interp_value(env);
+
+    //the TypeChecker proved both operands are numbers
+    if ( this->type == type_int ) {
+        return Value::from_int((int) ((unsigned) lhs_val.as_int() * (unsigned) rhs_val.as_int()));
+    }
+    return mult_values(lhs_val, rhs_val);
 }
 
 
@@ -254,53 +484,15 @@ bool MultExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire Mult expression object with the substitution
  */
-PTR(Expr) MultExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) MultExpr::subst(symbol_t s, PTR(Expr) e) {
     return NEW (MultExpr)(this->lhs->subst(s, e), this->rhs->subst(s, e));
 }
 
 
-/**
- * \brief Function that prints the contents of the Mult object in a prettier format
- * \param ot, a an output stream
- */
-void MultExpr::print(std::ostream &ot) {
-    ot << "(";
-    this->lhs->print(ot);
-    ot << "*";
-    this->rhs->print(ot);
-    ot << ")";
-}
 
 
-/**
- * \brief Function that prints the contents of the Mult object in a prettier format
- * \param ot, a an output stream
- */
-void MultExpr::pretty_print(std::ostream &ot) {
-    std::streampos position = ot.tellp();
-    pretty_print_at(ot, prec_mult, position, false);
-}
 
 
-/**
- * \brief Helper function that prints the contents of the Mult object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void MultExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
-
-    if ( precedence > prec_mult ) {
-        ot << "(";
-    }
-
-    this->lhs->pretty_print_at(ot, static_cast<precedence_t>(prec_mult + 1), pos, true);
-    ot << " * ";
-    this->rhs->pretty_print_at(ot, prec_mult, pos, false);
-
-    if ( precedence > prec_mult ) {
-        ot << ")";
-    }
-}
 
 
 /**
@@ -308,8 +500,13 @@ void MultExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::s
  * \param val, a string value that is stored inside the object
  * \return a Variable object with the value inside
  */
-VarExpr::VarExpr(std::string value) {
+VarExpr::VarExpr(symbol_t value) {
+    this->kind = expr_var;
     this->value = value;
+    this->hash = expr_hash(expr_var, value);
+    this->height = 1;
+    this->depth = -1;
+    this->slot = -1;
 }
 
 
@@ -319,10 +516,13 @@ VarExpr::VarExpr(std::string value) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool VarExpr::equals(PTR(Expr) e) {
-    PTR(VarExpr) var = CAST (VarExpr)(e);
-    if ( var == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    VarExpr *var = static_cast<VarExpr *>(&*e);
     return this->value == var->value;
 }
 
@@ -332,11 +532,29 @@ bool VarExpr::equals(PTR(Expr) e) {
  * \return an integer that notifies the system of an error
  */
 PTR(Val) VarExpr::interp(PTR(Env) env) {
+    return interp_value(env).to_val();
+}
+
+
+/**
+ * \brief Reads the value of the variable without boxing it
+ * \return the value it is bound to, throws the free variable error when it is not bound
+ */
+Value VarExpr::interp_value(PTR(Env) env) {
     if ( env == nullptr ) {
         env = Env::empty;
     }
 
-    return env->lookup(this->value);
+    //variables annotated by the Resolver are read straight from their frame
+    if ( this->depth >= 0 ) {
+        return env->lookup_at(this->depth, this->slot);
+    }
+
+    Value val;
+    if ( env->find(this->value, val)) {
+        return val;
+    }
+    return Value::from_val(env->lookup(this->value));
 }
 
 
@@ -355,7 +573,7 @@ bool VarExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire Variable expression object with the substitution
  */
-PTR(Expr) VarExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) VarExpr::subst(symbol_t s, PTR(Expr) e) {
     //check if the s exists
     if ( s == this->value ) {
         return e;
@@ -365,43 +583,39 @@ PTR(Expr) VarExpr::subst(std::string s, PTR(Expr) e) {
 }
 
 
-/**
- * \brief Function that prints the contents of the Variable object
- * \param ot, a an output stream
- */
-void VarExpr::print(std::ostream &ot) {
-    ot << this->value;
-}
 
 
-/**
- * \brief Function that prints the contents of the Variable object in a prettier format
- * \param ot, a an output stream
- */
-void VarExpr::pretty_print(std::ostream &ot) {
-    ot << this->value;
-}
 
 
-/**
- * \brief Helper function that prints the contents of the Variable object in a prettier format
- * \param ot, a an output stream
- */
-void VarExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
-    ot << this->value;
-}
 
 
 /**
  * \brief A constructor for a LetExpr object
  * \param variable object is passed in as a parameter
  */
-LetExpr::LetExpr(std::string val, PTR(Expr) sub, PTR(Expr) body) {
+LetExpr::LetExpr(symbol_t val, PTR(Expr) sub, PTR(Expr) body) {
+    this->kind = expr_let;
     this->value = val;
     this->rhs = sub;
     this->body = body;
+    this->hash = expr_hash(expr_let, val, sub->hash, body->hash);
+    this->height = 1 + std::max(sub->height, body->height);
+    this->slot = -1;
+}
+
+
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief destructor that hands the children to release_expr instead of freeing them recursively
+ */
+LetExpr::~LetExpr() {
+    release_expr(this->rhs);
+    release_expr(this->body);
 }
 
+#endif
+
 
 /**
  * \brief takes an expression and compares other expressions of the same type and determines if they are equal expressions
@@ -409,10 +623,13 @@ LetExpr::LetExpr(std::string val, PTR(Expr) sub, PTR(Expr) body) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool LetExpr::equals(PTR(Expr) e) {
-    PTR(LetExpr) let = CAST (LetExpr)(e);
-    if ( let == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    LetExpr *let = static_cast<LetExpr *>(&*e);
 
     return this->value == let->value && this->rhs->equals(let->rhs) && this->body->equals(let->body);
 }
@@ -424,13 +641,29 @@ bool LetExpr::equals(PTR(Expr) e) {
  * \return the result of the body expression
  */
 PTR(Val) LetExpr::interp(PTR(Env) env) {
+    return interp_value(env).to_val();
+}
+
+
+/**
+ * \brief Binds the value of the right hand side without boxing it and interprets the body
+ * \return the value of the body
+ */
+Value LetExpr::interp_value(PTR(Env) env) {
     if ( env == nullptr ) {
         env = Env::empty;
     }
 
-    PTR(Val) rhs_val = rhs->interp(env);
+    Value rhs_val = rhs->interp_value(env);
+
+    //inside a resolved function the variable has its own slot in the call's frame
+    if ( this->slot >= 0 ) {
+        env->set_slot(this->slot, rhs_val);
+        return body->interp_value(env);
+    }
+
     PTR(Env) new_env = NEW (ExtendedEnv) (this->value, rhs_val, env);
-    return body->interp(new_env);
+    return body->interp_value(new_env);
 }
 
 
@@ -455,7 +688,7 @@ bool LetExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire number expression object with the substitution
  */
-PTR(Expr) LetExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) LetExpr::subst(symbol_t s, PTR(Expr) e) {
     //check if the string given is equal to the string we already have in our object, if so subst the rhs
     if ( s == this->value ) {
         PTR(Expr) new_rhs = this->rhs->subst(s, e);
@@ -471,61 +704,10 @@ PTR(Expr) LetExpr::subst(std::string s, PTR(Expr) e) {
 }
 
 
-/**
- * \brief Function that prints the contents of the LetExpr object
- * \param ot, a an output stream
- */
-void LetExpr::print(std::ostream &ot) {
-    ot << "(_let ";
-    ot << this->value;
-    ot << "=";
-    this->rhs->print(ot);
-    ot << " _in ";
-    this->body->print(ot);
-    ot << ")";
-}
-
-
-/**
- * \brief Function that prints the contents of the LetExpr object in a prettier format
- * \param ot, a an output stream
- */
-void LetExpr::pretty_print(std::ostream &ot) {
-    std::streampos position = ot.tellp();
-    pretty_print_at(ot, prec_none, position, false);
-}
 
 
-/**
- * \brief Helper function that prints the contents of the LetExpr object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void LetExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
 
-    if ( needParentheses ) {
-        ot << "(";
-    }
 
-    std::streampos firstPosition = ot.tellp();
-
-    ot << "_let " << this->value << " = ";
-    this->rhs->pretty_print_at(ot, prec_none, pos, false);
-    ot << '\n';
-
-    std::streampos recordPosition = ot.tellp();
-    for ( int i = 0; i < firstPosition - pos; i++ ) {
-        ot << " ";
-    }
-
-    ot << "_in  ";
-    this->body->pretty_print_at(ot, prec_none, recordPosition, true);
-
-    if ( needParentheses ) {
-        ot << ")";
-    }
-
-}
 
 
 /**
@@ -533,7 +715,10 @@ void LetExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::st
  * \param a boolean
  */
 BoolExpr::BoolExpr(bool boolean) {
+    this->kind = expr_bool;
     this->boolean = boolean;
+    this->hash = expr_hash(expr_bool, boolean);
+    this->height = 1;
 }
 
 
@@ -543,10 +728,13 @@ BoolExpr::BoolExpr(bool boolean) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool BoolExpr::equals(PTR(Expr) e) {
-    PTR(BoolExpr) boolExpression = CAST (BoolExpr)(e);
-    if ( boolExpression == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    BoolExpr *boolExpression = static_cast<BoolExpr *>(&*e);
 
     return this->boolean == boolExpression->boolean;
 }
@@ -562,6 +750,15 @@ PTR(Val) BoolExpr::interp(PTR(Env) env) {
 }
 
 
+/**
+ * \brief Interprets the boolean as an immediate value
+ * \return the boolean
+ */
+Value BoolExpr::interp_value(PTR(Env) env) {
+    return Value::from_bool(this->boolean);
+}
+
+
 /**
  * \brief Checks if the BoolExpr expression has a variable object in it
  * It will never have a variable in it so just return false
@@ -578,44 +775,17 @@ bool BoolExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire boolean expression object with the substitution
  */
-PTR(Expr) BoolExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) BoolExpr::subst(symbol_t s, PTR(Expr) e) {
     //can just return the object
     return NEW(BoolExpr)(this->boolean);
 }
 
 
-/**
- * \brief Function that prints the contents of the BoolExpr object
- * \param ot, a an output stream
- */
-void BoolExpr::print(std::ostream &ot) {
 
-    if ( this->boolean ) {
-        ot << "_true";
-    } else {
-        ot << "_false";
-    }
-}
 
 
-/**
- * \brief Function that prints the contents of the BoolExpr object in a prettier format (not relevant to this subclass)
- * \param ot, a an output stream
- */
-void BoolExpr::pretty_print(std::ostream &ot) {
-    ot << this->boolean;
-}
 
 
-/**
- * \brief Helper function that prints the contents of the BoolExpr object in a prettier format (not relevant to this subclass)
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void BoolExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
-    ot << this->boolean;
-}
-
 
 /**
  * \brief Constructor that takes in two expressions and assigns them as the left hand side and the right hand side
@@ -623,10 +793,26 @@ void BoolExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::s
  * \param rhs, right hand side of the expression
  */
 EqExpr::EqExpr(PTR(Expr) lhs, PTR(Expr) rhs) {
+    this->kind = expr_eq;
     this->lhs = lhs;
     this->rhs = rhs;
+    this->hash = expr_hash(expr_eq, lhs->hash, rhs->hash);
+    this->height = 1 + std::max(lhs->height, rhs->height);
+}
+
+
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief destructor that hands the children to release_expr instead of freeing them recursively
+ */
+EqExpr::~EqExpr() {
+    release_expr(this->lhs);
+    release_expr(this->rhs);
 }
 
+#endif
+
 
 /**
  * \brief takes an expression and compares other expressions of the same type and determines if they are equal expressions
@@ -634,10 +820,13 @@ EqExpr::EqExpr(PTR(Expr) lhs, PTR(Expr) rhs) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool EqExpr::equals(PTR(Expr) e) {
-    PTR(EqExpr) eqExpression = CAST (EqExpr)(e);
-    if ( eqExpression == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    EqExpr *eqExpression = static_cast<EqExpr *>(&*e);
     return this->lhs->equals(eqExpression->lhs) && this->rhs->equals(eqExpression->rhs);
 }
 
@@ -648,17 +837,31 @@ bool EqExpr::equals(PTR(Expr) e) {
  * \return a BoolVal object that is either true or false depending on the result of the interp and equals operation
  */
 PTR(Val) EqExpr::interp(PTR(Env) env) {
+    return interp_value(env).to_val();
+}
+
+
+/**
+ * \brief Compares the immediate values of both sides, the left hand side is evaluated first
+ *
+ * \return an immediate boolean that is true when both sides are equal
+ */
+Value EqExpr::interp_value(PTR(Env) env) {
 
     if ( env == nullptr ) {
         env = Env::empty;
     }
 
-    //if the lhs is equal to the rhs then return a BoolVal object that is set to true
-    if ( this->lhs->interp(env)->equals(this->rhs->interp(env))) {
-        return NEW (BoolVal)(true);
-    } else {
-        return NEW (BoolVal)(false);
+    Value lhs_val = this->lhs->interp_value(env);
+    Value rhs_val = this->rhs->interp_value(env);
+
+    //the TypeChecker proved both sides are numbers or both are booleans
+    if ( this->lhs->type == type_int ) {
+        return Value::from_bool(lhs_val.as_int() == rhs_val.as_int());
+    } else if ( this->lhs->type == type_bool ) {
+        return Value::from_bool(lhs_val.as_bool() == rhs_val.as_bool());
     }
+    return Value::from_bool(lhs_val.equals(rhs_val));
 }
 
 
@@ -678,53 +881,15 @@ bool EqExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire boolean expression object with the substitution
  */
-PTR(Expr) EqExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) EqExpr::subst(symbol_t s, PTR(Expr) e) {
     return NEW (EqExpr)(this->lhs->subst(s, e), this->rhs->subst(s, e));
 }
 
 
-/**
- * \brief Function that prints the contents of the EqExpr object
- * \param ot, a an output stream
- */
-void EqExpr::print(std::ostream &ot) {
-    ot << "(";
-    this->lhs->print(ot);
-    ot << "==";
-    this->rhs->print(ot);
-    ot << ")";
-}
 
 
-/**
- * \brief Function that prints the contents of the EqExpr object in a prettier format
- * \param ot, a an output stream
- */
-void EqExpr::pretty_print(std::ostream &ot) {
-    std::streampos position = ot.tellp();
-    pretty_print_at(ot, prec_none, position, false);
-}
-
-
-/**
- * \brief Helper function that prints the contents of the EqExpr object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void EqExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
 
-    if ( precedence > prec_none ) {
-        ot << "(";
-    }
-
-    this->lhs->pretty_print_at(ot, static_cast<precedence_t>(prec_none + 1), pos, needParentheses);
-    ot << " == ";
-    this->rhs->pretty_print_at(ot, prec_none, pos, needParentheses);
 
-    if ( precedence > prec_none ) {
-        ot << ")";
-    }
-}
 
 
 /**
@@ -732,22 +897,42 @@ void EqExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::str
  * \param Three expression objects are passed in as parameters
  */
 IfExpr::IfExpr(PTR(Expr) ifExpr, PTR(Expr) thenExpr, PTR(Expr) elseExpr) {
+    this->kind = expr_if;
     this->ifExpr = ifExpr;
     this->thenExpr = thenExpr;
     this->elseExpr = elseExpr;
+    this->hash = expr_hash(expr_if, ifExpr->hash, thenExpr->hash, elseExpr->hash);
+    this->height = 1 + std::max({ifExpr->height, thenExpr->height, elseExpr->height});
 }
 
 
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief destructor that hands the children to release_expr instead of freeing them recursively
+ */
+IfExpr::~IfExpr() {
+    release_expr(this->ifExpr);
+    release_expr(this->thenExpr);
+    release_expr(this->elseExpr);
+}
+
+#endif
+
+
 /**
  * \brief takes an expression and compares other expressions of the same type and determines if they are equal expressions
  * \param e, an expression which can be either a Num, Add, Mult, Variable, LetExpr, BoolExpr, EqExpr, or IfExpr object
  * \return a boolean value based on if the object is equal to the other object
  */
 bool IfExpr::equals(PTR(Expr) e) {
-    PTR(IfExpr) let = CAST (IfExpr)(e);
-    if ( let == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    IfExpr *let = static_cast<IfExpr *>(&*e);
 
     return this->ifExpr->equals(let->ifExpr) && this->thenExpr->equals(let->thenExpr) &&
            this->elseExpr->equals(let->elseExpr);
@@ -759,28 +944,28 @@ bool IfExpr::equals(PTR(Expr) e) {
  * \return - returns a Val object
  */
 PTR(Val) IfExpr::interp(PTR(Env) env) {
+    return interp_value(env).to_val();
+}
+
+
+/**
+ * \brief Interprets the branch the condition picks without boxing its value
+ * \return - the value of that branch
+ */
+Value IfExpr::interp_value(PTR(Env) env) {
 
     if ( env == nullptr ) {
         env = Env::empty;
     }
 
-    //the first expression must evaluate to a boolean. If it's not a boolean than an exception needs to
-    //be raised.
-    if ( this->ifExpr->interp(env)->equals(NEW (BoolVal)(true)) || this->ifExpr->interp(env)->equals(NEW (BoolVal)(false))) {
-
-        //if the first expression evaluates to a boolean then we need to make it so that if its true we
-        //evaluate the then expression
-        if ( this->ifExpr->interp(env)->equals(NEW (BoolVal)(true))) {
-            return this->thenExpr->interp(env);
-        }
-            //else we need to evaluate the else expression
-        else {
-            return this->elseExpr->interp(env);
-        }
+    //the first expression must evaluate to a boolean, is_true() raises the exception when it is not, unless the
+    //TypeChecker proved it is one. The condition is only evaluated once.
+    Value condition = this->ifExpr->interp_value(env);
+    if ( this->ifExpr->type == type_bool ? condition.as_bool() : condition.is_true()) {
+        return this->thenExpr->interp_value(env);
+    } else {
+        return this->elseExpr->interp_value(env);
     }
-
-    //throw an exception because the ifExpr does not evaluate to a boolean
-    throw std::runtime_error("if statement doesn't evaluate to a boolean, must evaluate to a boolean");
 }
 
 
@@ -800,82 +985,45 @@ bool IfExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire number expression object with the substitution
  */
-PTR(Expr) IfExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) IfExpr::subst(symbol_t s, PTR(Expr) e) {
     return NEW (IfExpr)(this->ifExpr->subst(s, e), this->thenExpr->subst(s, e), this->elseExpr->subst(s, e));
 }
 
 
-/**
- * \brief Function that prints the contents of the IfExpr object
- * \param ot, a an output stream
- */
-void IfExpr::print(std::ostream &ot) {
-    ot << "(_if ";
-    this->ifExpr->print(ot);
-    ot << " _then ";
-    this->thenExpr->print(ot);
-    ot << " _else ";
-    this->elseExpr->print(ot);
-    ot << ")";
-}
 
 
-/**
- * \brief Function that prints the contents of the IfExpr object in a prettier format
- * \param ot, a an output stream
- */
-void IfExpr::pretty_print(std::ostream &ot) {
-    std::streampos position = ot.tellp();
-    pretty_print_at(ot, prec_none, position, false);
-}
-
-
-/**
- * \brief Helper function that prints the contents of the IfExpr object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void IfExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
-
-    if ( precedence > prec_none ) {
-        ot << "(";
-    }
-
-    std::streampos firstPosition = ot.tellp();
-    std::string kw_pos = std::string( firstPosition - pos, ' ' );
-
-    ot << "_if ";
-    this->ifExpr->pretty_print_at(ot, prec_none, pos, needParentheses);
-    ot << '\n';
-
-    pos = ot.tellp();
 
-    ot << kw_pos << "_then ";
-    this->thenExpr->pretty_print_at(ot, prec_none, pos, needParentheses);
-    ot << '\n';
 
-    pos = ot.tellp();
-
-    ot << kw_pos << "_else ";
-    this->elseExpr->pretty_print_at(ot, prec_none, pos, needParentheses);
-
-    if ( precedence > prec_none ) {
-        ot << ")";
-    }
-
-
-}
 
 
 /**
  * \brief A constructor for a FunExpr object
  * \param A string that is the formal argument to the function expression. An expression object that is the body of the function
  */
-FunExpr::FunExpr(std::string formal_arg, PTR (Expr) body) {
+FunExpr::FunExpr(symbol_t formal_arg, PTR (Expr) body) {
+    this->kind = expr_fun;
     this->formal_arg = formal_arg;
     this->body = body;
+    this->source = body;
+    this->hash = expr_hash(expr_fun, formal_arg, body->hash);
+    this->height = 1 + body->height;
+    this->frame_size = -1;
+    this->outer_depth = -1;
+}
+
+
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief destructor that hands the children to release_expr instead of freeing them recursively
+ */
+FunExpr::~FunExpr() {
+    release_expr(this->body);
+    release_expr(this->source);
 }
 
+#endif
+
 
 /**
  * \brief takes an expression and compares other expressions of the same type and determines if they are equal expressions
@@ -883,12 +1031,18 @@ FunExpr::FunExpr(std::string formal_arg, PTR (Expr) body) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool FunExpr::equals(PTR (Expr) e) {
-    PTR(FunExpr) func = CAST (FunExpr)(e);
-    if ( func == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    FunExpr *func = static_cast<FunExpr *>(&*e);
 
-    return this->formal_arg == func->formal_arg && this->body->equals(func->body);
+    //closures of functions whose bodies were rewritten to the same thing still print differently
+    bool unchanged = &*this->source == &*this->body && &*func->source == &*func->body;
+    return this->formal_arg == func->formal_arg && this->body->equals(func->body) &&
+           (unchanged || this->source->equals(func->source));
 }
 
 
@@ -900,90 +1054,80 @@ PTR(Val) FunExpr::interp(PTR(Env) env) {
     if ( env == nullptr ) {
         env = Env::empty;
     }
-    return NEW (FunVal)(this->formal_arg, this->body, env);
+    PTR(FunVal) fun = NEW (FunVal)(this->formal_arg, this->body, closure_env(env));
+    fun->source = this->source;
+    fun->frame_size = this->frame_size;
+    if ( this->frame_size >= 0 && jit_enabled()) {
+        if ( this->jit == nullptr ) {
+            this->jit = std::make_shared<JitFunction>(this->captures);
+        }
+        fun->jit = this->jit;
+    }
+    return fun;
+}
+
+
+/**
+ * \brief Makes the environment of a closure, holding only the variables the body uses
+ *
+ * A resolved body reads them from a ClosureEnv, in the order of the Resolver's capture list. A body that was not
+ * resolved looks its variables up by name, so they are copied into ExtendedEnvs with their names, and a variable
+ * that is not bound anywhere is left out so using it still raises the free variable error.
+ * \param env - the environment the _fun is evaluated in
+ * \return - the environment the closure keeps
+ */
+PTR(Env) FunExpr::closure_env(PTR(Env) env) {
+    if ( this->frame_size >= 0 ) {
+        return ClosureEnv::make(this->captures, this->outer_depth, env);
+    }
+
+    PTR(Env) captured = Env::empty;
+    for ( symbol_t name : free_variables()) {
+        Value val;
+        if ( env->find(name, val)) {
+            captured = NEW (ExtendedEnv)(name, val, captured);
+        }
+    }
+    return captured;
 }
 
 
 /**
  * \brief Checks if the FunExpr expression has a variable object in it
- * A function expression will always have a variable in it
- * \return returns true
+ * The formal argument is only a name, so it is the body that decides
+ * \return returns true or false
  */
 bool FunExpr::has_variable() {
-    return true;
+    return this->body->has_variable();
 }
 
 
 /**
  * \brief Substitutes a string with an expression
+ *
+ * Only the body that runs is substituted, the Optimizer only substitutes a variable with what it is bound to, so
+ * the function still prints the body as the program wrote it
  * \param s, a string that can be substituted with an expression
  * \param e, an expression that will be substituted with the string value
  * \return the entire number expression object with the substitution
  */
-PTR(Expr)FunExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr)FunExpr::subst(symbol_t s, PTR(Expr) e) {
+    PTR(FunExpr) fun;
     //check if the string given is equal to the string we already have in our object, if so subst the rhs
     if ( s == this->formal_arg ) {
-        return NEW(FunExpr)(this->formal_arg, this->body); //THIS;
+        fun = NEW(FunExpr)(this->formal_arg, this->body); //THIS;
     } else {
-        return NEW (FunExpr)(this->formal_arg, this->body->subst(s, e));
+        fun = NEW (FunExpr)(this->formal_arg, this->body->subst(s, e));
     }
+    fun->source = this->source;
+    return fun;
 }
 
 
-/**
- * \brief Function that prints the contents of the FunExpr object
- * \param ot, a an output stream
- */
-void FunExpr::print(std::ostream &ot) {
-    ot << "(_fun ";
-    ot << "(";
-    ot << this->formal_arg;
-    ot << ") ";
-    this->body->print(ot);
-    ot << ")";
-}
 
 
-/**
- * \brief Function that prints the contents of the FunExpr object in a prettier format
- * \param ot, a an output stream
- */
-void FunExpr::pretty_print(std::ostream &ot) {
-
-    std::streampos position = ot.tellp();
-    pretty_print_at(ot, prec_none, position, false);
-}
 
 
-/**
- * \brief Helper function that prints the contents of the FunExpr object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void FunExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
-
-    if ( precedence > prec_none ) {
-        ot << "(";
-    }
-
-    std::streampos first_position = ot.tellp();
-    std::string kw_pos = std::string( first_position - pos, ' ' );
-
-
-    ot << "_fun (" << this->formal_arg << ")";
-    ot << "\n";
-
-    pos = ot.tellp();
-    ot << kw_pos << "  ";
-
-    this->body->pretty_print_at(ot, prec_none, pos, needParentheses );
-
-
-    if ( precedence > prec_none ) {
-        ot << ")";
-    }
-
-}
 
 
 /**
@@ -991,10 +1135,26 @@ void FunExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::st
  * \param An expression object that is the formal argument to the function expression. An expression object which is the actual argument
  */
 CallExpr::CallExpr(PTR(Expr) to_be_called, PTR(Expr) actual_arg) {
+    this->kind = expr_call;
     this->to_be_called = to_be_called;
     this->actual_arg = actual_arg;
+    this->hash = expr_hash(expr_call, to_be_called->hash, actual_arg->hash);
+    this->height = 1 + std::max(to_be_called->height, actual_arg->height);
+}
+
+
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+
+/**
+ * \brief destructor that hands the children to release_expr instead of freeing them recursively
+ */
+CallExpr::~CallExpr() {
+    release_expr(this->to_be_called);
+    release_expr(this->actual_arg);
 }
 
+#endif
+
 
 /**
  * \brief takes an expression and compares other expressions of the same type and determines if they are equal expressions
@@ -1002,10 +1162,13 @@ CallExpr::CallExpr(PTR(Expr) to_be_called, PTR(Expr) actual_arg) {
  * \return a boolean value based on if the object is equal to the other object
  */
 bool CallExpr::equals(PTR(Expr) e) {
-    PTR(CallExpr) call = CAST (CallExpr)(e);
-    if ( call == nullptr ) {
+    if ( e == nullptr || e->hash != this->hash || e->kind != this->kind ) {
         return false;
     }
+    if ( &*e == this ) {
+        return true;
+    }
+    CallExpr *call = static_cast<CallExpr *>(&*e);
 
     return this->to_be_called->equals(call->to_be_called) && this->actual_arg->equals(call->actual_arg);
 }
@@ -1016,11 +1179,30 @@ bool CallExpr::equals(PTR(Expr) e) {
  * \return - returns a Val object
  */
 PTR(Val) CallExpr::interp(PTR(Env) env) {
+    return interp_value(env).to_val();
+}
+
+
+/**
+ * \brief Calls the function with the argument as an immediate value
+ * \return - the value the body returns, not boxed
+ */
+Value CallExpr::interp_value(PTR(Env) env) {
     if ( env == nullptr ) {
         env = Env::empty;
     }
 
-    return this->to_be_called->interp(env)->call(this->actual_arg->interp(env));
+    PTR(Val) to_be_called_val = this->to_be_called->interp(env);
+    Value actual_arg_val = this->actual_arg->interp_value(env);
+
+    //the TypeChecker proved it is a function, so the call goes straight to FunVal::call_value
+    FunVal *fun = this->to_be_called->type == type_fun ? static_cast<FunVal *>(&*to_be_called_val)
+                                                       : dynamic_cast<FunVal *>(&*to_be_called_val);
+    if ( fun != nullptr ) {
+        return fun->call_value(actual_arg_val);
+    }
+
+    return Value::from_val(to_be_called_val->call(actual_arg_val.to_val()));
 }
 
 
@@ -1040,48 +1222,15 @@ bool CallExpr::has_variable() {
  * \param e, an expression that will be substituted with the string value
  * \return the entire number expression object with the substitution
  */
-PTR(Expr) CallExpr::subst(std::string s, PTR(Expr) e) {
+PTR(Expr) CallExpr::subst(symbol_t s, PTR(Expr) e) {
     return NEW (CallExpr)(this->to_be_called->subst(s, e), this->actual_arg->subst(s, e));
 }
 
 
-/**
- * \brief Function that prints the contents of the FunExpr object
- * \param ot, a an output stream
- */
-void CallExpr::print(std::ostream &ot) {
-    this->to_be_called->print(ot);
-    //ot << "(";
-    ot << " ";
-    this->actual_arg->print(ot);
-    //ot << ")";
-}
-
-
-/**
- * \brief Function that prints the contents of the CallExpr object in a prettier format
- * \param ot, a an output stream
- */
-void CallExpr::pretty_print(std::ostream &ot) {
-
-    std::streampos position = ot.tellp();
-    pretty_print_at(ot, prec_none, position, false);
 
-}
 
 
-/**
- * \brief Helper function that prints the contents of the CallExpr object in a prettier format
- * \param ot, a an output stream
- * \param precedence, a precedence level which will determine when a parentheses will be added when printing
- */
-void CallExpr::pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) {
 
-    this->to_be_called->pretty_print_at(ot, prec_none, pos, needParentheses);
-    ot << "(";
-    this->actual_arg->pretty_print_at(ot, prec_none, pos, needParentheses);
-    ot << ")";
-}
 
 
 
@@ -16,12 +16,28 @@
 #include <stdexcept>
 #include <sstream>
 #include "pointer.h"
+#include "Symbol.h"
+#include "Env.h"
 #include <memory>
+#include <vector>
 
 class Val;
 
 class Env;
 
+class Expr;
+
+class JitFunction;
+
+//a long chain of nodes is freed with a worklist instead of one nested destructor call per node, only reference
+//counting frees nodes one at a time so only it needs the destructors
+#if USE_ARENA_POINTERS || USE_PLAIN_POINTERS || USE_GC_POINTERS
+# define EXPR_DESTRUCTOR(T)
+#else
+# define EXPR_DESTRUCTOR(T) ~T();
+#endif
+
+
 /**
  * \brief A new type that is used to determine which expressions have precedence over another
  */
@@ -34,39 +50,82 @@ typedef enum {
 } precedence_t;
 
 
+/**
+ * \brief A tag for each expression subclass, so evaluators and passes can switch on it instead of casting
+ */
+typedef enum {
+    expr_num = 0,
+    expr_add,
+    expr_mult,
+    expr_var,
+    expr_let,
+    expr_bool,
+    expr_eq,
+    expr_if,
+    expr_fun,
+    expr_call
+} expr_kind_t;
+
+
+/**
+ * \brief What the TypeChecker proved about the values of a node
+ */
+typedef enum {
+    type_unknown = 0, ///< not checked, or used at several types
+    type_int,         ///< always a NumVal
+    type_bool,        ///< always a BoolVal
+    type_fun          ///< always a FunVal
+} static_type_t;
+
+
+/**
+ * The optimizer, the resolver, the type checker and interp() recurse once per level of a tree, so the front ends
+ * evaluate a program taller than this with cek_interp as it was parsed, which takes no C++ stack
+ */
+static const int max_recursive_height = 2048;
+
+size_t expr_hash(expr_kind_t kind, size_t a, size_t b = 0, size_t c = 0);
+
+#if !USE_ARENA_POINTERS && !USE_PLAIN_POINTERS && !USE_GC_POINTERS
+void release_expr(PTR(Expr) &child);
+#endif
+
+
 /**
  * \brief Expression class that has many methods to alter, compare, and print the contents of the expression object
  */
 CLASS (Expr) {
 public:
+    expr_kind_t kind; ///< which subclass this object is, set by the constructor
+
+    size_t hash; ///< structural hash over the kind, fields and children, set by the constructor
+
+    int height; ///< nodes on the longest path from this one down to a leaf, set by the constructor
+
+    static_type_t type = type_unknown; ///< set by the TypeChecker, interp() leaves out the checks it makes unneeded
+
     virtual bool equals(PTR (Expr) e) = 0;
 
     virtual PTR(Val) interp(PTR(Env) env = nullptr) = 0;
 
-    virtual bool has_variable() = 0;
-
-    virtual PTR(Expr) subst(std::string s, PTR(Expr) e) = 0;
+    virtual Value interp_value(PTR(Env) env = nullptr);
 
-    virtual void print(std::ostream &ot) = 0;
+    virtual bool has_variable() = 0;
 
-    virtual void pretty_print(std::ostream &ot) = 0;
+    virtual PTR(Expr) subst(symbol_t s, PTR(Expr) e) = 0;
 
-    virtual void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses) = 0;
+    void print(std::ostream &ot);
 
+    void pretty_print(std::ostream &ot);
 
-    std::string to_string() {
-        std::stringstream st("");
-        this->print(st);
-        return st.str();
-    }
+    std::string to_string();
 
+    std::string to_string_pretty();
 
-    std::string to_string_pretty() {
-        std::stringstream st("");
-        this->pretty_print(st);
-        return st.str();
-    }
+    const std::vector<symbol_t> &free_variables();
 
+private:
+    std::unique_ptr<std::vector<symbol_t>> free_vars; ///< sorted, made by the first free_variables()
 };
 
 
@@ -82,15 +141,11 @@ public:
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR(Expr) subst(std::string s, PTR(Expr) e);
-
-    void print(std::ostream &ot);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR(Expr) subst(symbol_t s, PTR(Expr) e);
 };
 
 /**
@@ -102,19 +157,17 @@ public:
     PTR(Expr) rhs; ///< An expression that represents the right hand side of the expression
     AddExpr(PTR(Expr) lhs, PTR(Expr) rhs);
 
+    EXPR_DESTRUCTOR(AddExpr)
+
     bool equals(PTR(Expr) e);
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR(Expr) subst(std::string s, PTR(Expr) e);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void print(std::ostream &ot);
-
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR(Expr) subst(symbol_t s, PTR(Expr) e);
 };
 
 /**
@@ -126,19 +179,17 @@ public:
     PTR(Expr) rhs; ///< An expression that represents the right hand side of the expression
     MultExpr(PTR(Expr) lhs, PTR(Expr) rhs);
 
+    EXPR_DESTRUCTOR(MultExpr)
+
     bool equals(PTR(Expr) e);
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR(Expr) subst(std::string s, PTR(Expr) e);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void print(std::ostream &ot);
-
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR(Expr) subst(symbol_t s, PTR(Expr) e);
 };
 
 /**
@@ -146,22 +197,20 @@ public:
  */
 class VarExpr : public Expr {
 public:
-    std::string value; ///< string that is the value of the Variable object
-    VarExpr(std::string value);
+    symbol_t value; ///< the interned name of the Variable object
+    int depth; ///< frames between the use and the binding, set by the Resolver, -1 for a lookup by name
+    int slot; ///< slot of the binding in that frame, set by the Resolver
+    VarExpr(symbol_t value);
 
     bool equals(PTR (Expr) e);
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR(Expr) subst(std::string s, PTR(Expr) e);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void print(std::ostream &ot);
-
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR(Expr) subst(symbol_t s, PTR(Expr) e);
 };
 
 
@@ -170,24 +219,23 @@ public:
  */
 class LetExpr : public Expr {
 public:
-    std::string value; ///< string that is the value of the Variable
+    symbol_t value; ///< the interned name of the Variable
     PTR(Expr) rhs; ///< an expression that represents the expression to the right hand side of the equals sign
     PTR(Expr) body; ///< an expression that represents ...
-    LetExpr(std::string val, PTR(Expr) substitute, PTR(Expr) body);
+    int slot; ///< slot in the enclosing function's frame, set by the Resolver, -1 to extend the environment
+    LetExpr(symbol_t val, PTR(Expr) substitute, PTR(Expr) body);
+
+    EXPR_DESTRUCTOR(LetExpr)
 
     bool equals(PTR (Expr) e);
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR(Expr) subst(std::string s, PTR (Expr) e);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void print(std::ostream &ot);
-
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR(Expr) subst(symbol_t s, PTR (Expr) e);
 
 };
 
@@ -208,15 +256,11 @@ public:
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR (Expr) subst(std::string s, PTR (Expr) e);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void print(std::ostream &ot);
-
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR (Expr) subst(symbol_t s, PTR (Expr) e);
 
 };
 
@@ -233,19 +277,17 @@ public:
 
     EqExpr(PTR (Expr) lhs, PTR (Expr) rhs);
 
+    EXPR_DESTRUCTOR(EqExpr)
+
     bool equals(PTR (Expr) e);
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR (Expr) subst(std::string s, PTR (Expr) e);
-
-    void print(std::ostream &ot);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR (Expr) subst(symbol_t s, PTR (Expr) e);
 };
 
 
@@ -263,19 +305,17 @@ public:
 
     IfExpr(PTR (Expr) ifExpr, PTR (Expr) thenExpr, PTR (Expr) elseExpr);
 
+    EXPR_DESTRUCTOR(IfExpr)
+
     bool equals(PTR (Expr) e);
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR (Expr) subst(std::string, PTR (Expr) e);
-
-    void print(std::ostream &ot);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR (Expr) subst(symbol_t s, PTR (Expr) e);
 };
 
 
@@ -285,25 +325,33 @@ public:
 class FunExpr : public Expr {
 
 public:
-    std::string formal_arg;
+    symbol_t formal_arg; ///< the interned name of the argument
 
     PTR (Expr) body;
 
-    FunExpr(std::string variable, PTR (Expr) body);
+    PTR (Expr) source; ///< the body as written, which closures print and compare, passes that rewrite body keep it
 
-    bool equals(PTR (Expr) e);
+    int frame_size; ///< slots needed by a call, set by the Resolver, -1 when the body is not resolved
 
-    PTR(Val) interp(PTR(Env) env = nullptr);
+    std::vector<EnvAddress> captures; ///< set by the Resolver, the variables a closure copies, the body reads them at depth 1
 
-    bool has_variable();
+    int outer_depth; ///< set by the Resolver, levels from where the _fun is evaluated out to where the program started
 
-    PTR (Expr) subst(std::string, PTR (Expr) e);
+    std::shared_ptr<JitFunction> jit; ///< made on the first interp() with the JIT on, shared with every closure
 
-    void print(std::ostream &ot);
+    FunExpr(symbol_t variable, PTR (Expr) body);
 
-    void pretty_print(std::ostream &ot);
+    EXPR_DESTRUCTOR(FunExpr)
+
+    bool equals(PTR (Expr) e);
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR(Val) interp(PTR(Env) env = nullptr);
+
+    PTR(Env) closure_env(PTR(Env) env);
+
+    bool has_variable();
+
+    PTR (Expr) subst(symbol_t s, PTR (Expr) e);
 };
 
 
@@ -319,19 +367,17 @@ public:
 
     CallExpr(PTR (Expr) to_be_called, PTR (Expr) actual_arg);
 
+    EXPR_DESTRUCTOR(CallExpr)
+
     bool equals(PTR (Expr) e);
 
     PTR(Val) interp(PTR(Env) env = nullptr);
 
-    bool has_variable();
-
-    PTR (Expr) subst(std::string, PTR (Expr) e);
-
-    void print(std::ostream &ot);
+    Value interp_value(PTR(Env) env = nullptr);
 
-    void pretty_print(std::ostream &ot);
+    bool has_variable();
 
-    void pretty_print_at(std::ostream &ot, precedence_t precedence, std::streampos &pos, bool needParentheses);
+    PTR (Expr) subst(symbol_t s, PTR (Expr) e);
 };
 
 #endif //MSDSCRIPT_EXPR_H
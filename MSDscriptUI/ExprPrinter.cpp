@@ -0,0 +1,490 @@
+#include "ExprPrinter.h"
+#include <charconv>
+#include "FlatAst.h"
+
+/**
+ * \file ExprPrinter.cpp
+ * \brief contains the implementation of the iterative printer
+ */
+
+
+/**
+ * \brief Prints an expression with every operation parenthesized, the format of to_string
+ * @param e - the expression
+ * @return - the text
+ */
+std::string ExprPrinter::print(Expr *e) {
+    flat = nullptr;
+    return print_node(reinterpret_cast<uintptr_t>(e));
+}
+
+
+/**
+ * \brief Prints an expression over several lines with indentation, the format of to_string_pretty
+ * @param e - the expression
+ * @return - the text
+ */
+std::string ExprPrinter::pretty_print(Expr *e) {
+    flat = nullptr;
+    return pretty_print_node(reinterpret_cast<uintptr_t>(e));
+}
+
+
+/**
+ * \brief Prints a node of a flat program in the format of to_string
+ * @param program - the program
+ * @param node - the node
+ * @return - the text
+ */
+std::string ExprPrinter::print(const FlatAst &program, uint32_t node) {
+    flat = &program;
+    return print_node(node);
+}
+
+
+/**
+ * \brief Prints a node of a flat program in the format of to_string_pretty
+ * @param program - the program
+ * @param node - the node
+ * @return - the text
+ */
+std::string ExprPrinter::pretty_print(const FlatAst &program, uint32_t node) {
+    flat = &program;
+    return pretty_print_node(node);
+}
+
+
+/**
+ * \brief Prints a node with every operation parenthesized
+ * @param node - the node
+ * @return - the text
+ */
+std::string ExprPrinter::print_node(uintptr_t node) {
+    out.clear();
+    tasks.clear();
+    push_expr(node);
+
+    while ( !tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        if ( task.kind == task_expr ) {
+            print_expr(task.node);
+        } else {
+            out += task.text;
+        }
+    }
+
+    return std::move(out);
+}
+
+
+/**
+ * \brief Prints a node over several lines with indentation
+ * @param node - the node
+ * @return - the text
+ */
+std::string ExprPrinter::pretty_print_node(uintptr_t node) {
+    out.clear();
+    tasks.clear();
+    line_starts.assign(1, 0);
+    push_expr(node);
+
+    while ( !tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        switch ( task.kind ) {
+            case task_expr:
+                pretty_print_expr(task);
+                break;
+            case task_text:
+                out += task.text;
+                break;
+            case task_spaces:
+                out.append(task.count, ' ');
+                break;
+            case task_indent:
+                //an _if or _fun in the rhs can move the line start past the column, then there is no indentation
+                if ( task.count > line_starts[task.line] ) {
+                    out.append(task.count - line_starts[task.line], ' ');
+                }
+                break;
+            case task_mark:
+                line_starts[task.line] = out.size();
+                break;
+        }
+    }
+
+    return std::move(out);
+}
+
+
+/**
+ * \brief The kind of a node
+ * @param node - the node
+ * @return - its kind
+ */
+expr_kind_t ExprPrinter::kind(uintptr_t node) const {
+    if ( flat != nullptr ) {
+        return (expr_kind_t) flat->nodes[node].kind;
+    }
+    return reinterpret_cast<Expr *>(node)->kind;
+}
+
+
+/**
+ * \brief The value of a number or boolean node
+ * @param node - the node
+ * @return - the number, 1 for _true and 0 for _false
+ */
+int ExprPrinter::number(uintptr_t node) const {
+    if ( flat != nullptr ) {
+        return (int) flat->nodes[node].value;
+    }
+    Expr *e = reinterpret_cast<Expr *>(node);
+    if ( e->kind == expr_bool ) {
+        return static_cast<BoolExpr *>(e)->boolean ? 1 : 0;
+    }
+    return static_cast<NumExpr *>(e)->val;
+}
+
+
+/**
+ * \brief The name of a variable, _let or _fun node
+ * @param node - the node
+ * @return - the interned name
+ */
+symbol_t ExprPrinter::name(uintptr_t node) const {
+    if ( flat != nullptr ) {
+        return flat->nodes[node].value;
+    }
+    Expr *e = reinterpret_cast<Expr *>(node);
+    switch ( e->kind ) {
+        case expr_let:
+            return static_cast<LetExpr *>(e)->value;
+        case expr_fun:
+            return static_cast<FunExpr *>(e)->formal_arg;
+        default:
+            return static_cast<VarExpr *>(e)->value;
+    }
+}
+
+
+/**
+ * \brief A child of a node, in the order of the fields of its Expr class
+ * @param node - the node
+ * @param i - 0 for the first child, 1 for the second and 2 for the _else branch of an _if
+ * @return - the child
+ */
+uintptr_t ExprPrinter::child(uintptr_t node, int i) const {
+    if ( flat != nullptr ) {
+        const FlatNode &n = flat->nodes[node];
+        return i == 0 ? n.lhs : i == 1 ? n.rhs : n.value;
+    }
+
+    Expr *e = reinterpret_cast<Expr *>(node);
+    Expr *result = nullptr;
+    switch ( e->kind ) {
+        case expr_add:
+            result = &*(i == 0 ? static_cast<AddExpr *>(e)->lhs : static_cast<AddExpr *>(e)->rhs);
+            break;
+        case expr_mult:
+            result = &*(i == 0 ? static_cast<MultExpr *>(e)->lhs : static_cast<MultExpr *>(e)->rhs);
+            break;
+        case expr_eq:
+            result = &*(i == 0 ? static_cast<EqExpr *>(e)->lhs : static_cast<EqExpr *>(e)->rhs);
+            break;
+        case expr_let:
+            result = &*(i == 0 ? static_cast<LetExpr *>(e)->rhs : static_cast<LetExpr *>(e)->body);
+            break;
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            result = &*(i == 0 ? ifExpr->ifExpr : i == 1 ? ifExpr->thenExpr : ifExpr->elseExpr);
+            break;
+        }
+        case expr_fun:
+            result = &*static_cast<FunExpr *>(e)->body;
+            break;
+        case expr_call:
+            result = &*(i == 0 ? static_cast<CallExpr *>(e)->to_be_called : static_cast<CallExpr *>(e)->actual_arg);
+            break;
+        default:
+            break;
+    }
+    return reinterpret_cast<uintptr_t>(result);
+}
+
+
+/**
+ * \brief Prints the start of one node for print and pushes its children and the text between them
+ * @param e - the node
+ */
+void ExprPrinter::print_expr(uintptr_t e) {
+    switch ( kind(e)) {
+        case expr_num:
+            append_int(number(e));
+            break;
+
+        case expr_bool:
+            out += number(e) ? "_true" : "_false";
+            break;
+
+        case expr_var:
+            out += symbol_name(name(e));
+            break;
+
+        case expr_add:
+            out += "(";
+            push_text(")");
+            push_expr(child(e, 1));
+            push_text("+");
+            push_expr(child(e, 0));
+            break;
+
+        case expr_mult:
+            out += "(";
+            push_text(")");
+            push_expr(child(e, 1));
+            push_text("*");
+            push_expr(child(e, 0));
+            break;
+
+        case expr_eq:
+            out += "(";
+            push_text(")");
+            push_expr(child(e, 1));
+            push_text("==");
+            push_expr(child(e, 0));
+            break;
+
+        case expr_let:
+            out += "(_let ";
+            out += symbol_name(name(e));
+            out += "=";
+            push_text(")");
+            push_expr(child(e, 1));
+            push_text(" _in ");
+            push_expr(child(e, 0));
+            break;
+
+        case expr_if:
+            out += "(_if ";
+            push_text(")");
+            push_expr(child(e, 2));
+            push_text(" _else ");
+            push_expr(child(e, 1));
+            push_text(" _then ");
+            push_expr(child(e, 0));
+            break;
+
+        case expr_fun:
+            out += "(_fun (";
+            out += symbol_name(name(e));
+            out += ") ";
+            push_text(")");
+            push_expr(child(e, 0));
+            break;
+
+        case expr_call:
+            push_expr(child(e, 1));
+            push_text(" ");
+            push_expr(child(e, 0));
+            break;
+    }
+}
+
+
+/**
+ * \brief Prints the start of one node for pretty_print and pushes the rest of its work
+ *
+ * Infix operators only get parentheses when the surrounding precedence binds tighter. A _let gets them when the
+ * flag passed down asks for them, which the left side of + and * and the body of a _let do.
+ * @param task - the node with the precedence, line and parentheses flag it is printed at
+ */
+void ExprPrinter::pretty_print_expr(const Task &task) {
+    uintptr_t e = task.node;
+    size_t line = task.line;
+
+    switch ( kind(e)) {
+        case expr_num:
+            append_int(number(e));
+            break;
+
+        case expr_bool:
+            out += number(e) ? "1" : "0";
+            break;
+
+        case expr_var:
+            out += symbol_name(name(e));
+            break;
+
+        case expr_add:
+        case expr_mult: {
+            bool add = kind(e) == expr_add;
+            precedence_t precedence = add ? prec_add : prec_mult;
+
+            bool open = task.precedence > precedence;
+            if ( open ) {
+                out += "(";
+                push_text(")");
+            }
+            push_expr(child(e, 1), precedence, line, false);
+            push_text(add ? " + " : " * ");
+            push_expr(child(e, 0), static_cast<precedence_t>(precedence + 1), line, true);
+            break;
+        }
+
+        case expr_eq: {
+            bool open = task.precedence > prec_none;
+            if ( open ) {
+                out += "(";
+                push_text(")");
+            }
+            push_expr(child(e, 1), prec_none, line, task.parentheses);
+            push_text(" == ");
+            push_expr(child(e, 0), static_cast<precedence_t>(prec_none + 1), line, task.parentheses);
+            break;
+        }
+
+        case expr_let: {
+            if ( task.parentheses ) {
+                out += "(";
+                push_text(")");
+            }
+
+            //_in lines up with _let, the body is measured from the line _in is on
+            size_t first = out.size();
+            size_t body_line = line_starts.size();
+            line_starts.push_back(0);
+
+            out += "_let ";
+            out += symbol_name(name(e));
+            out += " = ";
+
+            push_expr(child(e, 1), prec_none, body_line, true);
+            push_text("_in  ");
+            push(task_indent, first, line);
+            push(task_mark, 0, body_line);
+            push_text("\n");
+            push_expr(child(e, 0), prec_none, line, false);
+            break;
+        }
+
+        case expr_if: {
+            bool open = task.precedence > prec_none;
+            if ( open ) {
+                out += "(";
+                push_text(")");
+            }
+
+            size_t column = out.size() - line_starts[line];
+            out += "_if ";
+
+            push_expr(child(e, 2), prec_none, line, task.parentheses);
+            push_text("_else ");
+            push(task_spaces, column, line);
+            push(task_mark, 0, line);
+            push_text("\n");
+            push_expr(child(e, 1), prec_none, line, task.parentheses);
+            push_text("_then ");
+            push(task_spaces, column, line);
+            push(task_mark, 0, line);
+            push_text("\n");
+            push_expr(child(e, 0), prec_none, line, task.parentheses);
+            break;
+        }
+
+        case expr_fun: {
+            bool open = task.precedence > prec_none;
+            if ( open ) {
+                out += "(";
+                push_text(")");
+            }
+
+            size_t column = out.size() - line_starts[line];
+            out += "_fun (";
+            out += symbol_name(name(e));
+            out += ")\n";
+            line_starts[line] = out.size();
+            out.append(column + 2, ' ');
+
+            push_expr(child(e, 0), prec_none, line, task.parentheses);
+            break;
+        }
+
+        case expr_call:
+            push_text(")");
+            push_expr(child(e, 1), prec_none, line, task.parentheses);
+            push_text("(");
+            push_expr(child(e, 0), prec_none, line, task.parentheses);
+            break;
+    }
+}
+
+
+/**
+ * \brief Schedules an expression to be printed
+ * @param e - the expression
+ * @param precedence - the precedence it is printed at, only used by pretty_print
+ * @param line - the line start its indentation is measured from, only used by pretty_print
+ * @param parentheses - whether a _let printed there needs parentheses, only used by pretty_print
+ */
+void ExprPrinter::push_expr(uintptr_t e, precedence_t precedence, size_t line, bool parentheses) {
+    Task task;
+    task.kind = task_expr;
+    task.node = e;
+    task.text = nullptr;
+    task.count = 0;
+    task.line = line;
+    task.precedence = precedence;
+    task.parentheses = parentheses;
+    tasks.push_back(task);
+}
+
+
+/**
+ * \brief Schedules a piece of fixed text
+ * @param text - the text, which has to outlive the printer
+ */
+void ExprPrinter::push_text(const char *text) {
+    Task task;
+    task.kind = task_text;
+    task.node = 0;
+    task.text = text;
+    task.count = 0;
+    task.line = 0;
+    task.precedence = prec_none;
+    task.parentheses = false;
+    tasks.push_back(task);
+}
+
+
+/**
+ * \brief Schedules spaces or a line start update
+ * @param kind - task_spaces, task_indent or task_mark
+ * @param count - the spaces, or the column start for task_indent
+ * @param line - the line start that is used or updated
+ */
+void ExprPrinter::push(task_kind_t kind, size_t count, size_t line) {
+    Task task;
+    task.kind = kind;
+    task.node = 0;
+    task.text = nullptr;
+    task.count = count;
+    task.line = line;
+    task.precedence = prec_none;
+    task.parentheses = false;
+    tasks.push_back(task);
+}
+
+
+/**
+ * \brief Appends a number without making a temporary string
+ * @param n - the number
+ */
+void ExprPrinter::append_int(int n) {
+    char digits[16];
+    char *end = std::to_chars(digits, digits + sizeof(digits), n).ptr;
+    out.append(digits, end);
+}
@@ -0,0 +1,92 @@
+#ifndef MSDSCRIPT_EXPRPRINTER_H
+#define MSDSCRIPT_EXPRPRINTER_H
+
+/**
+ * \file ExprPrinter.h
+ * \brief iterative printer for expressions
+ *
+ * Writes the print and pretty print formats into one growable buffer with an explicit stack, so the time is
+ * linear in the size of the output and a deep tree cannot overflow the C stack
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Expr.h"
+
+class FlatAst;
+
+/**
+ * \brief Prints expressions without recursion
+ *
+ * Work that has to happen after a child is printed, such as a closing parenthesis or the indentation of an _in,
+ * is pushed on the stack below the child. Indentation is the distance from the start of the line the expression
+ * started on, and those line starts are offsets into the buffer, so no stream position is ever asked for.
+ *
+ * A FlatAst is printed by the same code, nodes are then indices into its array instead of pointers.
+ */
+class ExprPrinter {
+public:
+    std::string print(Expr *e);
+
+    std::string pretty_print(Expr *e);
+
+    std::string print(const FlatAst &program, uint32_t node);
+
+    std::string pretty_print(const FlatAst &program, uint32_t node);
+
+private:
+    /**
+     * \brief The kinds of work left on the stack
+     */
+    typedef enum {
+        task_expr = 0,  ///< print expr
+        task_text,      ///< append text
+        task_spaces,    ///< append count spaces
+        task_indent,    ///< append spaces up to count, measured from the start of line
+        task_mark       ///< set line to the end of the buffer
+    } task_kind_t;
+
+    struct Task {
+        task_kind_t kind;
+        uintptr_t node; ///< the expression of a task_expr, an Expr pointer or an index into flat
+        const char *text; ///< the text of a task_text
+        size_t count; ///< spaces for task_spaces, the column start for task_indent
+        size_t line; ///< index into line_starts
+        precedence_t precedence; ///< the precedence a pretty printed expression is printed at
+        bool parentheses; ///< whether a _let printed here needs parentheses, passed down like the precedence
+    };
+
+    std::string out; ///< the output so far
+    std::vector<Task> tasks; ///< work left, the next task last
+    std::vector<size_t> line_starts; ///< line starts that indentation is measured from
+    const FlatAst *flat; ///< the program nodes are indices into, nullptr when they are Expr pointers
+
+    std::string print_node(uintptr_t node);
+
+    std::string pretty_print_node(uintptr_t node);
+
+    expr_kind_t kind(uintptr_t node) const;
+
+    int number(uintptr_t node) const;
+
+    symbol_t name(uintptr_t node) const;
+
+    uintptr_t child(uintptr_t node, int i) const;
+
+    void print_expr(uintptr_t e);
+
+    void pretty_print_expr(const Task &task);
+
+    void push_expr(uintptr_t e, precedence_t precedence = prec_none, size_t line = 0, bool parentheses = false);
+
+    void push_text(const char *text);
+
+    void push(task_kind_t kind, size_t count, size_t line);
+
+    void append_int(int n);
+};
+
+
+#endif //MSDSCRIPT_EXPRPRINTER_H
@@ -0,0 +1,278 @@
+#include "ExprTable.h"
+#include "Expr.h"
+#include <stdexcept>
+
+/**
+ * \file ExprTable.cpp
+ * \brief contains the implementation of the hash-consing factory
+ */
+
+
+static thread_local ExprTable *current_table = nullptr;
+
+
+/**
+ * \brief Returns the node in the table that matches, creating and remembering a new one if there is none
+ * @param hash - the structural hash the new node would have
+ * @param match - tells if an existing node with that hash is the one asked for
+ * @param make - creates the node when no match is found
+ * @return - the canonical node
+ */
+template<typename Match, typename Make>
+PTR(Expr) ExprTable::find_or_add(size_t hash, Match match, Make make) {
+    auto range = nodes.equal_range(hash);
+    for ( auto it = range.first; it != range.second; ++it ) {
+        if ( match(&*it->second)) {
+            return it->second;
+        }
+    }
+
+    PTR(Expr) e = make();
+    nodes.emplace(hash, e);
+    return e;
+}
+
+
+/**
+ * \brief Returns the canonical number expression
+ * @param val - the number
+ * @return - the shared NumExpr
+ */
+PTR(Expr) ExprTable::num(int val) {
+    return find_or_add(expr_hash(expr_num, (unsigned) val), [&](Expr *e) {
+        return e->kind == expr_num && static_cast<NumExpr *>(e)->val == val;
+    }, [&]() -> PTR(Expr) { return NEW (NumExpr)(val); });
+}
+
+
+/**
+ * \brief Returns the canonical boolean expression
+ * @param val - the boolean
+ * @return - the shared BoolExpr
+ */
+PTR(Expr) ExprTable::boolean(bool val) {
+    return find_or_add(expr_hash(expr_bool, val), [&](Expr *e) {
+        return e->kind == expr_bool && static_cast<BoolExpr *>(e)->boolean == val;
+    }, [&]() -> PTR(Expr) { return NEW (BoolExpr)(val); });
+}
+
+
+/**
+ * \brief Returns the canonical variable expression
+ * @param name - the interned name
+ * @return - the shared VarExpr
+ */
+PTR(Expr) ExprTable::var(symbol_t name) {
+    return find_or_add(expr_hash(expr_var, name), [&](Expr *e) {
+        return e->kind == expr_var && static_cast<VarExpr *>(e)->value == name;
+    }, [&]() -> PTR(Expr) { return NEW (VarExpr)(name); });
+}
+
+
+/**
+ * \brief Returns the canonical addition of two canonical expressions
+ * @param lhs - left hand side
+ * @param rhs - right hand side
+ * @return - the shared AddExpr
+ */
+PTR(Expr) ExprTable::add(PTR(Expr) lhs, PTR(Expr) rhs) {
+    return find_or_add(expr_hash(expr_add, lhs->hash, rhs->hash), [&](Expr *e) {
+        return e->kind == expr_add && static_cast<AddExpr *>(e)->lhs == lhs && static_cast<AddExpr *>(e)->rhs == rhs;
+    }, [&]() -> PTR(Expr) { return NEW (AddExpr)(lhs, rhs); });
+}
+
+
+/**
+ * \brief Returns the canonical multiplication of two canonical expressions
+ * @param lhs - left hand side
+ * @param rhs - right hand side
+ * @return - the shared MultExpr
+ */
+PTR(Expr) ExprTable::mult(PTR(Expr) lhs, PTR(Expr) rhs) {
+    return find_or_add(expr_hash(expr_mult, lhs->hash, rhs->hash), [&](Expr *e) {
+        return e->kind == expr_mult && static_cast<MultExpr *>(e)->lhs == lhs &&
+               static_cast<MultExpr *>(e)->rhs == rhs;
+    }, [&]() -> PTR(Expr) { return NEW (MultExpr)(lhs, rhs); });
+}
+
+
+/**
+ * \brief Returns the canonical comparison of two canonical expressions
+ * @param lhs - left hand side
+ * @param rhs - right hand side
+ * @return - the shared EqExpr
+ */
+PTR(Expr) ExprTable::eq(PTR(Expr) lhs, PTR(Expr) rhs) {
+    return find_or_add(expr_hash(expr_eq, lhs->hash, rhs->hash), [&](Expr *e) {
+        return e->kind == expr_eq && static_cast<EqExpr *>(e)->lhs == lhs && static_cast<EqExpr *>(e)->rhs == rhs;
+    }, [&]() -> PTR(Expr) { return NEW (EqExpr)(lhs, rhs); });
+}
+
+
+/**
+ * \brief Returns the canonical _let
+ * @param name - the interned name of the variable
+ * @param rhs - the canonical value bound to it
+ * @param body - the canonical body
+ * @return - the shared LetExpr
+ */
+PTR(Expr) ExprTable::let(symbol_t name, PTR(Expr) rhs, PTR(Expr) body) {
+    return find_or_add(expr_hash(expr_let, name, rhs->hash, body->hash), [&](Expr *e) {
+        if ( e->kind != expr_let ) {
+            return false;
+        }
+        LetExpr *let = static_cast<LetExpr *>(e);
+        return let->value == name && let->rhs == rhs && let->body == body;
+    }, [&]() -> PTR(Expr) { return NEW (LetExpr)(name, rhs, body); });
+}
+
+
+/**
+ * \brief Returns the canonical _if
+ * @param condition - the canonical condition
+ * @param then_expr - the canonical _then branch
+ * @param else_expr - the canonical _else branch
+ * @return - the shared IfExpr
+ */
+PTR(Expr) ExprTable::if_expr(PTR(Expr) condition, PTR(Expr) then_expr, PTR(Expr) else_expr) {
+    return find_or_add(expr_hash(expr_if, condition->hash, then_expr->hash, else_expr->hash), [&](Expr *e) {
+        if ( e->kind != expr_if ) {
+            return false;
+        }
+        IfExpr *ifExpr = static_cast<IfExpr *>(e);
+        return ifExpr->ifExpr == condition && ifExpr->thenExpr == then_expr &&
+               ifExpr->elseExpr == else_expr;
+    }, [&]() -> PTR(Expr) { return NEW (IfExpr)(condition, then_expr, else_expr); });
+}
+
+
+/**
+ * \brief Returns the canonical _fun
+ * @param formal_arg - the interned name of the argument
+ * @param body - the canonical body
+ * @return - the shared FunExpr
+ */
+PTR(Expr) ExprTable::fun(symbol_t formal_arg, PTR(Expr) body) {
+    return find_or_add(expr_hash(expr_fun, formal_arg, body->hash), [&](Expr *e) {
+        if ( e->kind != expr_fun ) {
+            return false;
+        }
+        FunExpr *fun = static_cast<FunExpr *>(e);
+        return fun->formal_arg == formal_arg && fun->body == body;
+    }, [&]() -> PTR(Expr) { return NEW (FunExpr)(formal_arg, body); });
+}
+
+
+/**
+ * \brief Returns the canonical call
+ * @param to_be_called - the canonical function expression
+ * @param actual_arg - the canonical argument
+ * @return - the shared CallExpr
+ */
+PTR(Expr) ExprTable::call(PTR(Expr) to_be_called, PTR(Expr) actual_arg) {
+    return find_or_add(expr_hash(expr_call, to_be_called->hash, actual_arg->hash), [&](Expr *e) {
+        if ( e->kind != expr_call ) {
+            return false;
+        }
+        CallExpr *call = static_cast<CallExpr *>(e);
+        return call->to_be_called == to_be_called && call->actual_arg == actual_arg;
+    }, [&]() -> PTR(Expr) { return NEW (CallExpr)(to_be_called, actual_arg); });
+}
+
+
+/**
+ * \brief Hash-conses a tree that was built some other way
+ * @param e - any expression
+ * @return - the canonical node for the same structure
+ */
+PTR(Expr) ExprTable::canonical(PTR(Expr) e) {
+    switch ( e->kind ) {
+        case expr_num:
+            return num(static_cast<NumExpr *>(&*e)->val);
+        case expr_bool:
+            return boolean(static_cast<BoolExpr *>(&*e)->boolean);
+        case expr_var:
+            return var(static_cast<VarExpr *>(&*e)->value);
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(&*e);
+            PTR(Expr) lhs = canonical(add->lhs);
+            return this->add(lhs, canonical(add->rhs));
+        }
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(&*e);
+            PTR(Expr) lhs = canonical(mult->lhs);
+            return this->mult(lhs, canonical(mult->rhs));
+        }
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(&*e);
+            PTR(Expr) lhs = canonical(eq->lhs);
+            return this->eq(lhs, canonical(eq->rhs));
+        }
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(&*e);
+            PTR(Expr) rhs = canonical(let->rhs);
+            return this->let(let->value, rhs, canonical(let->body));
+        }
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(&*e);
+            PTR(Expr) condition = canonical(ifExpr->ifExpr);
+            PTR(Expr) then_expr = canonical(ifExpr->thenExpr);
+            return if_expr(condition, then_expr, canonical(ifExpr->elseExpr));
+        }
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(&*e);
+            return this->fun(fun->formal_arg, canonical(fun->body));
+        }
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(&*e);
+            PTR(Expr) to_be_called = canonical(call->to_be_called);
+            return this->call(to_be_called, canonical(call->actual_arg));
+        }
+    }
+    throw std::runtime_error("cannot hash-cons expression: " + e->to_string());
+}
+
+
+/**
+ * \brief Number of distinct nodes made so far
+ * @return - the node count
+ */
+size_t ExprTable::size() {
+    return nodes.size();
+}
+
+
+/**
+ * \brief Returns the table opened by the innermost ExprTableScope on this thread
+ * @return - the table, or nullptr outside of any scope
+ */
+ExprTable *ExprTable::current() {
+    return current_table;
+}
+
+
+/**
+ * \brief Makes a fresh table current until the end of the scope
+ */
+ExprTableScope::ExprTableScope() {
+    this->previous = current_table;
+    current_table = &own;
+}
+
+
+/**
+ * \brief Makes an existing table current until the end of the scope, nodes stay in the table afterwards
+ * @param table - the table to use
+ */
+ExprTableScope::ExprTableScope(ExprTable &table) {
+    this->previous = current_table;
+    current_table = &table;
+}
+
+
+/**
+ * \brief Restores the previous table
+ */
+ExprTableScope::~ExprTableScope() {
+    current_table = previous;
+}
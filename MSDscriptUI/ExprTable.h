@@ -0,0 +1,87 @@
+#ifndef MSDSCRIPT_EXPRTABLE_H
+#define MSDSCRIPT_EXPRTABLE_H
+
+/**
+ * \file ExprTable.h
+ * \brief hash-consing factory for expressions
+ *
+ * Contains the declarations for a table that hands out one canonical node per distinct subtree, so repeated
+ * subtrees are stored once and compare equal by pointer
+ */
+
+#include <cstddef>
+#include <unordered_map>
+#include "pointer.h"
+#include "Symbol.h"
+
+class Expr;
+
+/**
+ * \brief Creates expressions, reusing an existing node whenever an identical one was already made
+ *
+ * Children passed to the factory methods are expected to come from the same table, so two nodes are identical
+ * when their kind and fields match and their children are the same pointers. Canonical nodes are shared, never
+ * modify them; passes like the Resolver and the Optimizer already build fresh trees.
+ *
+ * The table keeps every node it made alive, so in the arena pointer mode it must not outlive the arena.
+ */
+class ExprTable {
+public:
+    PTR(Expr) num(int val);
+
+    PTR(Expr) boolean(bool val);
+
+    PTR(Expr) var(symbol_t name);
+
+    PTR(Expr) add(PTR(Expr) lhs, PTR(Expr) rhs);
+
+    PTR(Expr) mult(PTR(Expr) lhs, PTR(Expr) rhs);
+
+    PTR(Expr) eq(PTR(Expr) lhs, PTR(Expr) rhs);
+
+    PTR(Expr) let(symbol_t name, PTR(Expr) rhs, PTR(Expr) body);
+
+    PTR(Expr) if_expr(PTR(Expr) condition, PTR(Expr) then_expr, PTR(Expr) else_expr);
+
+    PTR(Expr) fun(symbol_t formal_arg, PTR(Expr) body);
+
+    PTR(Expr) call(PTR(Expr) to_be_called, PTR(Expr) actual_arg);
+
+    PTR(Expr) canonical(PTR(Expr) e);
+
+    size_t size();
+
+    static ExprTable *current();
+
+private:
+    std::unordered_multimap<size_t, PTR(Expr)> nodes; ///< canonical nodes by structural hash
+
+    template<typename Match, typename Make>
+    PTR(Expr) find_or_add(size_t hash, Match match, Make make);
+};
+
+
+/**
+ * \brief Makes a table the current one for this thread until the scope ends
+ *
+ * parse_str opens one of these, so every parsed program is hash-consed
+ */
+class ExprTableScope {
+public:
+    ExprTableScope();
+
+    explicit ExprTableScope(ExprTable &table);
+
+    ~ExprTableScope();
+
+    ExprTableScope(const ExprTableScope &) = delete;
+
+    ExprTableScope &operator=(const ExprTableScope &) = delete;
+
+private:
+    ExprTable own; ///< used when no table was passed in
+    ExprTable *previous; ///< the table that was current before
+};
+
+
+#endif //MSDSCRIPT_EXPRTABLE_H
@@ -0,0 +1,563 @@
+#include "FlatAst.h"
+#include <stdexcept>
+#include "Env.h"
+#include "ExprPrinter.h"
+#include "Cancel.h"
+
+/**
+ * \file FlatAst.cpp
+ * \brief contains the implementation of the array representation of a program
+ */
+
+
+/**
+ * \brief Constructor for a program without nodes
+ */
+FlatAst::FlatAst() {
+    this->root = no_node;
+}
+
+
+/**
+ * \brief Adds a number node
+ * @param n - the number
+ * @return - the index of the node
+ */
+uint32_t FlatAst::num(int n) {
+    return push(expr_num, no_node, no_node, (uint32_t) n);
+}
+
+
+/**
+ * \brief Adds a boolean node
+ * @param b - the boolean
+ * @return - the index of the node
+ */
+uint32_t FlatAst::boolean(bool b) {
+    return push(expr_bool, no_node, no_node, b ? 1 : 0);
+}
+
+
+/**
+ * \brief Adds a variable node, it is looked up by name until resolve() runs
+ * @param name - the variable
+ * @return - the index of the node
+ */
+uint32_t FlatAst::var(symbol_t name) {
+    return push(expr_var, no_node, no_node, name);
+}
+
+
+/**
+ * \brief Adds an addition node
+ * @param lhs - the left operand
+ * @param rhs - the right operand
+ * @return - the index of the node
+ */
+uint32_t FlatAst::add(uint32_t lhs, uint32_t rhs) {
+    return push(expr_add, lhs, rhs, 0);
+}
+
+
+/**
+ * \brief Adds a multiplication node
+ * @param lhs - the left operand
+ * @param rhs - the right operand
+ * @return - the index of the node
+ */
+uint32_t FlatAst::mult(uint32_t lhs, uint32_t rhs) {
+    return push(expr_mult, lhs, rhs, 0);
+}
+
+
+/**
+ * \brief Adds a comparison node
+ * @param lhs - the left operand
+ * @param rhs - the right operand
+ * @return - the index of the node
+ */
+uint32_t FlatAst::eq(uint32_t lhs, uint32_t rhs) {
+    return push(expr_eq, lhs, rhs, 0);
+}
+
+
+/**
+ * \brief Adds a _let node
+ * @param name - the variable it binds
+ * @param rhs - the value of the variable
+ * @param body - where the variable is in scope
+ * @return - the index of the node
+ */
+uint32_t FlatAst::let(symbol_t name, uint32_t rhs, uint32_t body) {
+    return push(expr_let, rhs, body, name);
+}
+
+
+/**
+ * \brief Adds an _if node
+ * @param condition - the condition
+ * @param then_expr - the _then branch
+ * @param else_expr - the _else branch
+ * @return - the index of the node
+ */
+uint32_t FlatAst::if_expr(uint32_t condition, uint32_t then_expr, uint32_t else_expr) {
+    return push(expr_if, condition, then_expr, else_expr);
+}
+
+
+/**
+ * \brief Adds a _fun node
+ * @param formal_arg - the argument
+ * @param body - the body
+ * @return - the index of the node
+ */
+uint32_t FlatAst::fun(symbol_t formal_arg, uint32_t body) {
+    return push(expr_fun, body, no_node, formal_arg);
+}
+
+
+/**
+ * \brief Adds a call node
+ * @param to_be_called - the function
+ * @param actual_arg - the argument
+ * @return - the index of the node
+ */
+uint32_t FlatAst::call(uint32_t to_be_called, uint32_t actual_arg) {
+    return push(expr_call, to_be_called, actual_arg, 0);
+}
+
+
+/**
+ * \brief Copies an expression tree into the array
+ * @param e - the expression
+ * @return - the index of the node the expression became
+ */
+uint32_t FlatAst::add_expr(PTR(Expr) e) {
+    switch ( e->kind ) {
+        case expr_num:
+            return num(static_cast<NumExpr *>(&*e)->val);
+
+        case expr_bool:
+            return boolean(static_cast<BoolExpr *>(&*e)->boolean);
+
+        case expr_var:
+            return var(static_cast<VarExpr *>(&*e)->value);
+
+        case expr_add: {
+            AddExpr *add_node = static_cast<AddExpr *>(&*e);
+            uint32_t lhs = add_expr(add_node->lhs);
+            return add(lhs, add_expr(add_node->rhs));
+        }
+
+        case expr_mult: {
+            MultExpr *mult_node = static_cast<MultExpr *>(&*e);
+            uint32_t lhs = add_expr(mult_node->lhs);
+            return mult(lhs, add_expr(mult_node->rhs));
+        }
+
+        case expr_eq: {
+            EqExpr *eq_node = static_cast<EqExpr *>(&*e);
+            uint32_t lhs = add_expr(eq_node->lhs);
+            return eq(lhs, add_expr(eq_node->rhs));
+        }
+
+        case expr_let: {
+            LetExpr *let_node = static_cast<LetExpr *>(&*e);
+            uint32_t rhs = add_expr(let_node->rhs);
+            return let(let_node->value, rhs, add_expr(let_node->body));
+        }
+
+        case expr_if: {
+            IfExpr *if_node = static_cast<IfExpr *>(&*e);
+            uint32_t condition = add_expr(if_node->ifExpr);
+            uint32_t then_expr = add_expr(if_node->thenExpr);
+            return if_expr(condition, then_expr, add_expr(if_node->elseExpr));
+        }
+
+        case expr_fun: {
+            FunExpr *fun_node = static_cast<FunExpr *>(&*e);
+            uint32_t body = add_expr(fun_node->body);
+            if ( fun_node->source == fun_node->body ) {
+                return fun(fun_node->formal_arg, body);
+            }
+            uint32_t source = add_expr(fun_node->source);
+            uint32_t node = fun(fun_node->formal_arg, body);
+            nodes[node].rhs = source;
+            return node;
+        }
+
+        case expr_call: {
+            CallExpr *call_node = static_cast<CallExpr *>(&*e);
+            uint32_t to_be_called = add_expr(call_node->to_be_called);
+            return call(to_be_called, add_expr(call_node->actual_arg));
+        }
+    }
+    throw std::runtime_error("unknown expression kind");
+}
+
+
+/**
+ * \brief Works out how far every bound variable is from its binding, free variables are left to be looked up by name
+ */
+void FlatAst::resolve() {
+    if ( root == no_node ) {
+        return;
+    }
+    std::vector<symbol_t> scope;
+    resolve_node(root, scope);
+}
+
+
+/**
+ * \brief Interprets the program
+ * @param env - the environment free variables are looked up in, nullptr for the empty one
+ * @return - the value of the program
+ */
+PTR(Val) FlatAst::interp(PTR(Env) env) const {
+    if ( root == no_node ) {
+        throw std::runtime_error("empty program");
+    }
+    if ( env == nullptr ) {
+        env = Env::empty;
+    }
+    return eval(root, env).to_val();
+}
+
+
+/**
+ * \brief Interprets one node
+ * @param node - the node
+ * @param env - one binding for every _let and call around the node, innermost first
+ * @return - the value of the node
+ */
+Value FlatAst::eval(uint32_t node, PTR(Env) const &env) const {
+    const FlatNode &n = nodes[node];
+
+    switch ( n.kind ) {
+        case expr_num:
+            return Value::from_int((int) n.value);
+
+        case expr_bool:
+            return Value::from_bool(n.value != 0);
+
+        case expr_var:
+            if ( n.lhs != no_node ) {
+                return env->lookup_at((int) n.lhs, 0);
+            }
+            return Value::from_val(env->lookup(n.value));
+
+        case expr_add: {
+            Value lhs = eval(n.lhs, env);
+            return add_values(lhs, eval(n.rhs, env));
+        }
+
+        case expr_mult: {
+            Value lhs = eval(n.lhs, env);
+            return mult_values(lhs, eval(n.rhs, env));
+        }
+
+        case expr_eq: {
+            Value lhs = eval(n.lhs, env);
+            return Value::from_bool(lhs.equals(eval(n.rhs, env)));
+        }
+
+        case expr_let: {
+            Value rhs = eval(n.lhs, env);
+            return eval(n.rhs, NEW (ExtendedEnv)(n.value, rhs, env));
+        }
+
+        case expr_if:
+            if ( eval(n.lhs, env).is_true()) {
+                return eval(n.rhs, env);
+            }
+            return eval(n.value, env);
+
+        case expr_fun:
+            return Value::from_val(NEW (FlatFunVal)(this, node, env));
+
+        case expr_call: {
+            Value to_be_called = eval(n.lhs, env);
+            Value actual_arg = eval(n.rhs, env);
+
+            //a closure of this program is called without going through a Val
+            if ( to_be_called.tag == tag_object ) {
+                FlatFunVal *fun = dynamic_cast<FlatFunVal *>(&*to_be_called.object);
+                if ( fun != nullptr && fun->program == this ) {
+                    check_cancelled();
+                    const FlatNode &f = nodes[fun->node];
+                    return eval(f.lhs, NEW (ExtendedEnv)(f.value, actual_arg, fun->env));
+                }
+            }
+            return Value::from_val(to_be_called.to_val()->call(actual_arg.to_val()));
+        }
+    }
+    throw std::runtime_error("unknown expression kind");
+}
+
+
+/**
+ * \brief Turns a node back into an expression tree
+ * @param node - the node
+ * @return - an unresolved expression equal to the node
+ */
+PTR(Expr) FlatAst::to_expr(uint32_t node) const {
+    const FlatNode &n = nodes[node];
+
+    switch ( n.kind ) {
+        case expr_num:
+            return NEW (NumExpr)((int) n.value);
+        case expr_bool:
+            return NEW (BoolExpr)(n.value != 0);
+        case expr_var:
+            return NEW (VarExpr)(n.value);
+        case expr_add:
+            return NEW (AddExpr)(to_expr(n.lhs), to_expr(n.rhs));
+        case expr_mult:
+            return NEW (MultExpr)(to_expr(n.lhs), to_expr(n.rhs));
+        case expr_eq:
+            return NEW (EqExpr)(to_expr(n.lhs), to_expr(n.rhs));
+        case expr_let:
+            return NEW (LetExpr)(n.value, to_expr(n.lhs), to_expr(n.rhs));
+        case expr_if:
+            return NEW (IfExpr)(to_expr(n.lhs), to_expr(n.rhs), to_expr(n.value));
+        case expr_fun: {
+            PTR(FunExpr) fun_node = NEW (FunExpr)(n.value, to_expr(n.lhs));
+            if ( n.rhs != no_node ) {
+                fun_node->source = to_expr(n.rhs);
+            }
+            return fun_node;
+        }
+        case expr_call:
+            return NEW (CallExpr)(to_expr(n.lhs), to_expr(n.rhs));
+    }
+    throw std::runtime_error("unknown expression kind");
+}
+
+
+/**
+ * \brief Compares two nodes structurally, the way Expr::equals does
+ * @param node - a node of this program
+ * @param other - another program, or this one
+ * @param other_node - a node of other
+ * @return - true when the nodes are the same expression
+ */
+bool FlatAst::equals(uint32_t node, const FlatAst &other, uint32_t other_node) const {
+    const FlatNode &a = nodes[node];
+    const FlatNode &b = other.nodes[other_node];
+    if ( a.kind != b.kind ) {
+        return false;
+    }
+
+    switch ( a.kind ) {
+        case expr_num:
+        case expr_bool:
+        case expr_var:
+            return a.value == b.value;
+        case expr_let:
+            return a.value == b.value && equals(a.lhs, other, b.lhs) && equals(a.rhs, other, b.rhs);
+        case expr_if:
+            return equals(a.lhs, other, b.lhs) && equals(a.rhs, other, b.rhs) && equals(a.value, other, b.value);
+        case expr_fun:
+            return a.value == b.value && equals(a.lhs, other, b.lhs);
+        default:
+            return equals(a.lhs, other, b.lhs) && equals(a.rhs, other, b.rhs);
+    }
+}
+
+
+/**
+ * \brief Prints a node in the format of Expr::to_string
+ * @param node - the node
+ * @return - the printed node
+ */
+std::string FlatAst::to_string(uint32_t node) const {
+    ExprPrinter printer;
+    return printer.print(*this, node);
+}
+
+
+/**
+ * \brief Prints the program in the format of Expr::to_string
+ * @return - the printed program
+ */
+std::string FlatAst::to_string() const {
+    return to_string(root);
+}
+
+
+/**
+ * \brief Prints the program in the format of Expr::to_string_pretty
+ * @return - the pretty printed program
+ */
+std::string FlatAst::to_string_pretty() const {
+    ExprPrinter printer;
+    return printer.pretty_print(*this, root);
+}
+
+
+/**
+ * \brief Appends a node to the array
+ * @param kind - what the node is
+ * @param lhs - its first field
+ * @param rhs - its second field
+ * @param value - its third field
+ * @return - the index of the node
+ */
+uint32_t FlatAst::push(expr_kind_t kind, uint32_t lhs, uint32_t rhs, uint32_t value) {
+    if ( nodes.size() >= no_node ) {
+        throw std::runtime_error("program too large");
+    }
+    nodes.push_back({(uint32_t) kind, lhs, rhs, value});
+    return (uint32_t) (nodes.size() - 1);
+}
+
+
+/**
+ * \brief Resolves the variables under a node
+ * @param node - the node
+ * @param scope - the names bound around the node, innermost last
+ */
+void FlatAst::resolve_node(uint32_t node, std::vector<symbol_t> &scope) {
+    FlatNode &n = nodes[node];
+
+    switch ( n.kind ) {
+        case expr_num:
+        case expr_bool:
+            return;
+
+        case expr_var:
+            n.lhs = no_node;
+            for ( size_t i = scope.size(); i > 0; i-- ) {
+                if ( scope[i - 1] == n.value ) {
+                    n.lhs = (uint32_t) (scope.size() - i);
+                    break;
+                }
+            }
+            return;
+
+        case expr_let:
+            resolve_node(n.lhs, scope);
+            scope.push_back(n.value);
+            resolve_node(n.rhs, scope);
+            scope.pop_back();
+            return;
+
+        case expr_fun:
+            scope.push_back(n.value);
+            resolve_node(n.lhs, scope);
+            scope.pop_back();
+            return;
+
+        case expr_if:
+            resolve_node(n.lhs, scope);
+            resolve_node(n.rhs, scope);
+            resolve_node(n.value, scope);
+            return;
+
+        default:
+            resolve_node(n.lhs, scope);
+            resolve_node(n.rhs, scope);
+            return;
+    }
+}
+
+
+/**
+ * \brief Constructor for a closure
+ * @param program - the program the _fun node is in
+ * @param node - the _fun node
+ * @param env - the environment the _fun was evaluated in
+ */
+FlatFunVal::FlatFunVal(const FlatAst *program, uint32_t node, PTR(Env) env) {
+    this->program = program;
+    this->node = node;
+    this->env = env;
+}
+
+
+/**
+ * \brief Compares two closures by their _fun nodes, the way FunVal::equals does
+ * @param e - the other value
+ * @return - true when e is a closure of the same function
+ */
+bool FlatFunVal::equals(PTR(Val) e) {
+    PTR(FlatFunVal) other = CAST (FlatFunVal)(e);
+    if ( other == nullptr ) {
+        return false;
+    }
+    return program->equals(node, *other->program, other->node);
+}
+
+
+/**
+ * \brief Prints the closure the way FunVal::print does
+ * @param ot - the stream
+ */
+void FlatFunVal::print(std::ostream &ot) {
+    const FlatNode &n = program->nodes[node];
+    ot << "(_fun (" << symbol_name(n.value) << ") " << program->to_string(n.lhs) << ")";
+}
+
+
+/**
+ * \brief Functions cannot be added
+ * @param other_val - the other operand
+ * @return - throws a runtime error
+ */
+PTR(Val) FlatFunVal::add_to(PTR(Val) other_val) {
+    throw std::runtime_error("cannot add function together");
+}
+
+
+/**
+ * \brief Functions cannot be multiplied
+ * @param other_val - the other operand
+ * @return - throws a runtime error
+ */
+PTR(Val) FlatFunVal::mult_with(PTR(Val) other_val) {
+    throw std::runtime_error("cannot multiply functions together");
+}
+
+
+/**
+ * \brief Calls the closure
+ * @param actual_arg - the argument
+ * @return - the value of the body
+ */
+PTR(Val) FlatFunVal::call(PTR(Val) actual_arg) {
+    check_cancelled();
+
+    const FlatNode &n = program->nodes[node];
+    return program->eval(n.lhs, NEW (ExtendedEnv)(n.value, actual_arg, env)).to_val();
+}
+
+
+/**
+ * \brief Converts the closure into a FunExpr
+ * @return - the _fun expression
+ */
+PTR(Expr) FlatFunVal::to_expr() {
+    return program->to_expr(node);
+}
+
+
+/**
+ * \brief Functions are not booleans
+ * @return - throws a runtime error
+ */
+bool FlatFunVal::is_true() {
+    throw std::runtime_error("FunVal is not of type boolean");
+}
+
+
+#if USE_GC_POINTERS
+
+/**
+ * \brief Marks the environment the closure was made in, the program is not collected
+ * @param heap - the heap being collected
+ */
+void FlatFunVal::trace(GcHeap &heap) {
+    heap.mark(this->env);
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef MSDSCRIPT_FLATAST_H
+#define MSDSCRIPT_FLATAST_H
+
+/**
+ * \file FlatAst.h
+ * \brief array representation of a program
+ *
+ * Keeps all the nodes of one program in a single array of small fixed size records that refer to their children by
+ * index, instead of one heap object per node with a vtable and reference counted children. The parser can build it
+ * directly, and it is evaluated and printed with a switch over the node kinds.
+ */
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "pointer.h"
+#include "Symbol.h"
+#include "Value.h"
+#include "Expr.h"
+#include "Val.h"
+
+/**
+ * \brief One node of a FlatAst, 16 bytes
+ *
+ * What the fields hold depends on the kind
+ * - _let: lhs is the rhs, rhs the body, value the name
+ * - _if: lhs is the condition, rhs the _then branch, value the _else branch
+ * - _fun: lhs is the body, value the argument name, rhs the FunExpr::source add_expr was given when a pass
+ *   rewrote the body and no_node otherwise
+ * - call: lhs is the function, rhs the argument
+ * - variable: lhs is the number of bindings between the use and its binding, no_node when free, value the name
+ * - number and boolean: value is the number, or 1 and 0
+ */
+struct FlatNode {
+    uint32_t kind; ///< an expr_kind_t
+    uint32_t lhs;
+    uint32_t rhs;
+    uint32_t value;
+};
+
+
+/**
+ * \brief A program stored as one array of nodes, children always come before their parents
+ *
+ * The node building methods have the names ExprTable uses, so the parser builds either form with the same code.
+ * Variables are looked up by their distance to their binding once resolve() has run, every _let and every call
+ * adds one binding, and free variables are looked up by name in the environment interp() is given.
+ *
+ * Values and errors match Expr::interp. Closures are FlatFunVals that refer back into the array, so the program has
+ * to outlive the values it made.
+ */
+class FlatAst {
+public:
+    typedef uint32_t node_t; ///< the index of a node
+
+    static const uint32_t no_node = UINT32_MAX;
+
+    std::vector<FlatNode> nodes;
+
+    uint32_t root; ///< the whole program, no_node while empty
+
+    FlatAst();
+
+    uint32_t num(int n);
+
+    uint32_t boolean(bool b);
+
+    uint32_t var(symbol_t name);
+
+    uint32_t add(uint32_t lhs, uint32_t rhs);
+
+    uint32_t mult(uint32_t lhs, uint32_t rhs);
+
+    uint32_t eq(uint32_t lhs, uint32_t rhs);
+
+    uint32_t let(symbol_t name, uint32_t rhs, uint32_t body);
+
+    uint32_t if_expr(uint32_t condition, uint32_t then_expr, uint32_t else_expr);
+
+    uint32_t fun(symbol_t formal_arg, uint32_t body);
+
+    uint32_t call(uint32_t to_be_called, uint32_t actual_arg);
+
+    uint32_t add_expr(PTR(Expr) e);
+
+    void resolve();
+
+    PTR(Val) interp(PTR(Env) env = nullptr) const;
+
+    Value eval(uint32_t node, PTR(Env) const &env) const;
+
+    PTR(Expr) to_expr(uint32_t node) const;
+
+    bool equals(uint32_t node, const FlatAst &other, uint32_t other_node) const;
+
+    std::string to_string(uint32_t node) const;
+
+    std::string to_string() const;
+
+    std::string to_string_pretty() const;
+
+private:
+    uint32_t push(expr_kind_t kind, uint32_t lhs, uint32_t rhs, uint32_t value);
+
+    void resolve_node(uint32_t node, std::vector<symbol_t> &scope);
+};
+
+
+/**
+ * \brief A closure made by FlatAst::eval, a _fun node of its program and the environment it was made in
+ */
+class FlatFunVal : public Val {
+public:
+    const FlatAst *program;
+
+    uint32_t node; ///< the _fun node
+
+    PTR(Env) env;
+
+    FlatFunVal(const FlatAst *program, uint32_t node, PTR(Env) env);
+
+    bool equals(PTR(Val) e);
+
+    void print(std::ostream &ot);
+
+    PTR(Val) add_to(PTR(Val) other_val);
+
+    PTR(Val) mult_with(PTR(Val) other_val);
+
+    PTR(Val) call(PTR(Val) actual_arg);
+
+    PTR (Expr) to_expr();
+
+    bool is_true();
+
+#if USE_GC_POINTERS
+    void trace(GcHeap &heap);
+#endif
+};
+
+
+#endif //MSDSCRIPT_FLATAST_H
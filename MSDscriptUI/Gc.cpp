@@ -0,0 +1,194 @@
+#include "Gc.h"
+#include "pointer.h"
+#include "Value.h"
+#include "Val.h"
+
+/**
+ * \file Gc.cpp
+ * \brief contains the implementation of the mark-sweep collector used by the gc pointer mode
+ */
+
+
+/**
+ * \brief Constructor, the object belongs to no heap until GcHeap::adopt takes it
+ */
+GcObject::GcObject() {
+    this->gc_next = nullptr;
+    this->gc_heap = nullptr;
+    this->gc_size = 0;
+    this->gc_marked = false;
+}
+
+
+GcObject::~GcObject() = default;
+
+
+/**
+ * \brief Marks the collected objects this object points to, nothing for an object without any
+ * @param heap - the heap being collected
+ */
+void GcObject::trace(GcHeap &heap) {
+}
+
+
+/**
+ * \brief Registers the root set with the heap of this thread
+ */
+GcRoots::GcRoots() {
+    this->heap = &GcHeap::current();
+    this->prev = nullptr;
+    this->next = heap->roots;
+    if ( next != nullptr ) {
+        next->prev = this;
+    }
+    heap->roots = this;
+}
+
+
+/**
+ * \brief Takes the root set out of its heap, what only it kept alive goes at the next collection
+ */
+GcRoots::~GcRoots() {
+    if ( prev != nullptr ) {
+        prev->next = next;
+    } else {
+        heap->roots = next;
+    }
+    if ( next != nullptr ) {
+        next->prev = prev;
+    }
+}
+
+
+/**
+ * \brief Constructor for a heap without objects
+ */
+GcHeap::GcHeap() {
+    this->objects = nullptr;
+    this->count = 0;
+    this->bytes = 0;
+    this->allocated = 0;
+    this->threshold = min_threshold;
+    this->roots = nullptr;
+}
+
+
+/**
+ * \brief Destructor, deletes every object of the heap whether it is reachable or not
+ */
+GcHeap::~GcHeap() {
+    while ( objects != nullptr ) {
+        GcObject *object = objects;
+        objects = object->gc_next;
+        delete object;
+    }
+}
+
+
+/**
+ * \brief The heap NEW(T) gives the objects of this thread to
+ * @return - the heap of the calling thread, made on first use and freed when the thread ends
+ */
+GcHeap &GcHeap::current() {
+    static thread_local GcHeap heap;
+    return heap;
+}
+
+
+/**
+ * \brief Makes the heap the owner of a newly constructed object
+ * @param object - the object, which must have been made with new
+ * @param size - its size in bytes
+ */
+void GcHeap::adopt(GcObject *object, size_t size) {
+    object->gc_heap = this;
+    object->gc_size = (uint32_t) size;
+    object->gc_next = objects;
+    objects = object;
+    count++;
+    bytes += size;
+    allocated += size;
+}
+
+
+/**
+ * \brief Marks an object as reachable, its children are marked later from the work list
+ * @param object - the object, may be nullptr or belong to no heap or another heap
+ */
+void GcHeap::mark(GcObject *object) {
+    if ( object == nullptr || object->gc_heap != this || object->gc_marked ) {
+        return;
+    }
+    object->gc_marked = true;
+    work.push_back(object);
+}
+
+
+/**
+ * \brief Marks the object a value holds, if it holds one
+ * @param value - the value
+ */
+void GcHeap::mark(const Value &value) {
+#if USE_GC_POINTERS
+    if ( value.tag == tag_object ) {
+        mark(value.object);
+    }
+#endif
+}
+
+
+/**
+ * \brief Frees every object the roots do not reach
+ *
+ * Objects are marked from a work list, so a long environment chain takes no C++ stack. The next collection happens
+ * once as many bytes were allocated as are live now, and at least min_threshold.
+ * @return - the number of objects freed
+ */
+size_t GcHeap::collect() {
+    for ( GcRoots *root = roots; root != nullptr; root = root->next ) {
+        root->trace_roots(*this);
+    }
+    while ( !work.empty()) {
+        GcObject *object = work.back();
+        work.pop_back();
+        object->trace(*this);
+    }
+
+    size_t freed = 0;
+    GcObject **link = &objects;
+    while ( *link != nullptr ) {
+        GcObject *object = *link;
+        if ( object->gc_marked ) {
+            object->gc_marked = false;
+            link = &object->gc_next;
+        } else {
+            *link = object->gc_next;
+            count--;
+            bytes -= object->gc_size;
+            delete object;
+            freed++;
+        }
+    }
+
+    allocated = 0;
+    threshold = bytes > min_threshold ? bytes : min_threshold;
+    return freed;
+}
+
+
+/**
+ * \brief Number of objects the heap owns, reachable or not
+ * @return - the object count
+ */
+size_t GcHeap::live_objects() const {
+    return count;
+}
+
+
+/**
+ * \brief Bytes of the objects the heap owns, reachable or not
+ * @return - the byte count
+ */
+size_t GcHeap::live_bytes() const {
+    return bytes;
+}
@@ -0,0 +1,171 @@
+#ifndef MSDSCRIPT_GC_H
+#define MSDSCRIPT_GC_H
+
+/**
+ * \file Gc.h
+ * \brief mark-sweep collector used by the gc pointer mode
+ *
+ * When USE_GC_POINTERS is set in pointer.h, every Val and Env is a GcObject owned by the heap of the thread that
+ * made it, and pointers to them are plain pointers that are copied without any counting. Expressions and everything
+ * else NEW(T) makes go to the current Arena, as in the arena pointer mode.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Arena.h"
+
+class GcHeap;
+
+class Value;
+
+
+/**
+ * \brief Base class of the objects a GcHeap owns
+ *
+ * A subclass that points to other collected objects overrides trace() and marks every one of them, that is what
+ * makes the collector precise.
+ */
+class GcObject {
+public:
+    GcObject();
+
+    virtual ~GcObject();
+
+    virtual void trace(GcHeap &heap);
+
+private:
+    GcObject *gc_next; ///< the next object of the same heap
+    GcHeap *gc_heap; ///< the heap that owns the object, nullptr for objects that are never collected
+    uint32_t gc_size; ///< sizeof the object, for the heap's byte count
+    bool gc_marked; ///< reached during the current collection
+
+    friend class GcHeap;
+};
+
+
+/**
+ * \brief Something that holds collected objects the heap cannot find on its own, such as an interpreter stack
+ *
+ * It is registered with the heap of the thread that constructs it for as long as it exists, and has to be destroyed
+ * on that thread.
+ */
+class GcRoots {
+public:
+    GcRoots();
+
+    virtual ~GcRoots();
+
+    GcRoots(const GcRoots &) = delete;
+
+    GcRoots &operator=(const GcRoots &) = delete;
+
+    virtual void trace_roots(GcHeap &heap) = 0;
+
+private:
+    GcHeap *heap; ///< the heap it is registered with
+    GcRoots *prev; ///< the previous root set of the heap
+    GcRoots *next; ///< the next root set of the heap
+
+    friend class GcHeap;
+};
+
+
+/**
+ * \brief The objects of one thread and the collector that frees them
+ *
+ * Collecting marks everything reachable from the registered roots and deletes the rest. It only happens at a
+ * safepoint, where the thread holds no pointer that the roots do not lead to: the CEK machine and the VM offer one
+ * at every call, since their whole state is on their own stacks, and a driver can offer one between programs. The
+ * tree walking interp() keeps its pointers on the C++ stack, so nothing is collected while it runs.
+ *
+ * Objects of another heap, and objects that no heap owns such as Env::empty, are never marked or freed. A thread may
+ * use them as long as they stay alive, but must not make them point to its own objects.
+ */
+class GcHeap {
+public:
+    GcHeap();
+
+    ~GcHeap();
+
+    GcHeap(const GcHeap &) = delete;
+
+    GcHeap &operator=(const GcHeap &) = delete;
+
+    static GcHeap &current();
+
+    void adopt(GcObject *object, size_t size);
+
+    void mark(GcObject *object);
+
+    void mark(const Value &value);
+
+    size_t collect();
+
+    /**
+     * \brief Collects when enough was allocated since the last collection, the caller guarantees the roots are complete
+     */
+    void safepoint() {
+        if ( allocated >= threshold ) {
+            collect();
+        }
+    }
+
+    size_t live_objects() const;
+
+    size_t live_bytes() const;
+
+private:
+    static const size_t min_threshold = 1 << 20; ///< bytes allocated before the first collection
+
+    GcObject *objects; ///< every object of the heap, newest first
+    size_t count; ///< objects in the list
+    size_t bytes; ///< bytes of the objects in the list
+    size_t allocated; ///< bytes allocated since the last collection
+    size_t threshold; ///< allocated bytes that make the next safepoint collect
+    GcRoots *roots; ///< the registered root sets
+    std::vector<GcObject *> work; ///< marked objects whose children are not marked yet
+
+    friend class GcRoots;
+};
+
+
+/**
+ * \brief Keeps one object and everything it reaches alive while the handle exists
+ */
+template<class T>
+class GcRoot : public GcRoots {
+public:
+    T *object;
+
+    explicit GcRoot(T *object = nullptr) : object(object) {}
+
+    void trace_roots(GcHeap &heap) {
+        heap.mark(object);
+    }
+};
+
+
+/**
+ * \brief Constructs a T, the NEW(T) of the gc pointer mode
+ *
+ * A GcObject is owned by the heap of this thread, anything else is placed in the current arena.
+ * @param args - the constructor arguments
+ * @return - a pointer to the new object
+ */
+template<class T, class... Args>
+T *gc_new(Args &&... args) {
+    if constexpr ( std::is_base_of<GcObject, T>::value ) {
+        T *object = new T(std::forward<Args>(args)...);
+        GcHeap::current().adopt(object, sizeof(T));
+        return object;
+    } else {
+        return arena_new<T>(std::forward<Args>(args)...);
+    }
+}
+
+
+#endif //MSDSCRIPT_GC_H
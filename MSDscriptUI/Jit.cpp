@@ -0,0 +1,814 @@
+#include "Jit.h"
+#include <atomic>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include "Cancel.h"
+#include "Expr.h"
+#include "Val.h"
+#include "Env.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_AVAILABLE 1
+#include <sys/mman.h>
+#include <pthread.h>
+#else
+#define JIT_AVAILABLE 0
+#endif
+
+/**
+ * \file Jit.cpp
+ * \brief contains the template compiler and the entry into native code
+ *
+ * Native code follows the System V calling convention, int64_t code(int64_t arg, const int64_t *captures).
+ * Integers are computed in 32 bits so they wrap like interp(), booleans are 0 or 1. The argument, the captures
+ * pointer and the _let variables live in the stack frame, expressions are evaluated into eax with intermediate
+ * results pushed on the machine stack.
+ *
+ * The captures array is followed by a stack limit and a flag. A call that would start below the limit sets the flag
+ * and returns, and every call site returns as soon as it sees the flag, so a runaway recursion unwinds to
+ * JitFunction::call, which raises the error check_cancelled would. The limit is the one of the current CancelScope,
+ * or outside of any scope the bottom of the stack of the thread. A recursive function is not run natively when
+ * neither is known.
+ */
+
+
+static std::atomic<bool> enabled(false); ///< whether FunExpr::interp hands out JitFunctions
+
+static const size_t max_captures = 8; ///< most captured variables a compiled function may read
+
+static const int32_t limit_offset = 8 * max_captures; ///< where the stack limit follows the captures
+
+static const int32_t overflow_offset = limit_offset + 8; ///< where the flag set when the limit is reached follows
+
+static const int max_body_size = 4096; ///< largest body, in nodes, that is compiled
+
+static const size_t stack_margin = 64 * 1024; ///< stack kept free below the limit outside of a CancelScope
+
+
+/**
+ * \brief Turns the JIT on or off for closures made from now on
+ * @param on - true to count calls and compile hot functions
+ */
+void set_jit_enabled(bool on) {
+    enabled = on;
+}
+
+
+/**
+ * \brief Checks whether the JIT is on
+ * @return - true when FunExpr::interp should attach a JitFunction to its closures
+ */
+bool jit_enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * \brief Reads an integer or a boolean out of a value
+ * @param value - the value, an immediate or a NumVal or BoolVal
+ * @param tag - the kind that is expected, tag_int or tag_bool
+ * @param out - set to the number, or to 0 or 1 for a boolean
+ * @return - false when the value is of another kind
+ */
+static bool unbox(const Value &value, value_tag_t tag, int64_t &out) {
+    if ( value.tag == tag ) {
+        out = tag == tag_int ? value.num : value.boolean;
+        return true;
+    }
+
+    if ( value.tag == tag_object ) {
+        if ( tag == tag_int ) {
+            NumVal *num = dynamic_cast<NumVal *>(&*value.object);
+            if ( num != nullptr ) {
+                out = num->val;
+                return true;
+            }
+        } else if ( tag == tag_bool ) {
+            BoolVal *boolean = dynamic_cast<BoolVal *>(&*value.object);
+            if ( boolean != nullptr ) {
+                out = boolean->boolean;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * \brief The lowest stack address a native call may start at
+ * @return - the limit of the current CancelScope, or a margin above the bottom of the stack of the thread, nullptr
+ * when neither is known
+ */
+static const char *native_stack_limit() {
+    const char *limit = current_stack_limit();
+    if ( limit != nullptr ) {
+        return limit;
+    }
+
+#if JIT_AVAILABLE && defined(__linux__)
+    //the bounds of a thread never change, so they are looked up once
+    static thread_local const char *thread_limit = nullptr;
+    if ( thread_limit == nullptr ) {
+        pthread_attr_t attr;
+        if ( pthread_getattr_np(pthread_self(), &attr) == 0 ) {
+            void *low;
+            size_t size;
+            if ( pthread_attr_getstack(&attr, &low, &size) == 0 && size > 2 * stack_margin ) {
+                thread_limit = static_cast<const char *>(low) + stack_margin;
+            }
+            pthread_attr_destroy(&attr);
+        }
+    }
+    return thread_limit;
+#else
+    return nullptr;
+#endif
+}
+
+
+/**
+ * \brief Finds the capture that holds the argument of the enclosing function
+ * @param sources - the capture list of the _fun
+ * @return - its slot in the ClosureEnv, -1 when the body does not use the argument
+ */
+static int outer_argument(const std::vector<EnvAddress> &sources) {
+    for ( size_t i = 0; i < sources.size(); i++ ) {
+        if ( sources[i].depth == 0 && sources[i].slot == 0 ) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * \brief Finds the function f of f(f)(x) and checks that it returns the closure being called
+ *
+ * Then f(f) in the body evaluates to a closure with the same body, the same f and the environment of f, so f(f)(x)
+ * can call the native code directly.
+ * @param fun - a closure whose body uses f(f)(x), with f the argument of the enclosing function
+ * @param sources - the capture list of the _fun fun was made from
+ * @return - f, or nullptr when f is not a FunVal whose body is the _fun fun was made from
+ */
+static FunVal *self_function(FunVal *fun, const std::vector<EnvAddress> &sources) {
+    int slot = outer_argument(sources);
+    if ( slot < 0 ) {
+        return nullptr;
+    }
+
+    Value outer = fun->env->lookup_at(0, slot);
+    if ( outer.tag != tag_object ) {
+        return nullptr;
+    }
+
+    FunVal *outer_fun = dynamic_cast<FunVal *>(&*outer.object);
+    if ( outer_fun == nullptr || outer_fun->body->kind != expr_fun ||
+         static_cast<FunExpr *>(&*outer_fun->body)->body != fun->body ) {
+        return nullptr;
+    }
+    return outer_fun;
+}
+
+
+/**
+ * \brief Checks whether an expression is the self application f(f), with f the argument of the enclosing function
+ * @param e - the expression
+ * @param sources - the capture list of the _fun whose body e is in
+ * @return - true for the pattern, whether f really returns the function is checked by self_function
+ */
+static bool is_self_application(Expr *e, const std::vector<EnvAddress> &sources) {
+    if ( e->kind != expr_call ) {
+        return false;
+    }
+
+    CallExpr *call = static_cast<CallExpr *>(e);
+    if ( call->to_be_called->kind != expr_var || call->actual_arg->kind != expr_var ) {
+        return false;
+    }
+
+    VarExpr *callee = static_cast<VarExpr *>(&*call->to_be_called);
+    VarExpr *arg = static_cast<VarExpr *>(&*call->actual_arg);
+    int slot = outer_argument(sources);
+    return slot >= 0 && callee->depth == 1 && callee->slot == slot && arg->depth == 1 && arg->slot == slot;
+}
+
+
+/**
+ * \brief Checks the kinds in one function body and translates it into x86-64 code
+ */
+class JitCompiler {
+public:
+    JitCompiler(JitFunction &jit, FunVal *fun);
+
+    bool compile(std::vector<uint8_t> &bytes);
+
+private:
+    JitFunction &jit; ///< receives the captures and kinds
+    FunVal *fun; ///< the closure that made the function hot, captured variables are read from its environment
+    value_tag_t assumed_result; ///< what f(f)(x) is taken to return while the kinds are checked
+    int nodes; ///< nodes checked so far
+    int calls; ///< self calls checked so far
+    std::unordered_map<Expr *, value_tag_t> tags; ///< the kind of every node of the body
+    std::unordered_set<Expr *> calling; ///< the nodes of the body with a self call in them
+    std::vector<value_tag_t> local_tags; ///< the kind of every _let slot, tag_object when not yet bound
+    std::vector<bool> self_locals; ///< the _let slots bound to f(f), which common subexpression elimination makes
+    std::vector<uint8_t> code; ///< the instructions emitted so far
+    std::vector<size_t> unwinds; ///< the jumps to the epilogue emitted after calls, patched at the end
+
+    value_tag_t check(Expr *e);
+
+    bool is_self_call(CallExpr *call);
+
+    int capture_index(VarExpr *var);
+
+    void emit(Expr *e);
+
+    void emit_bytes(std::initializer_list<uint8_t> bytes);
+
+    void emit_int32(int32_t n);
+
+    void patch_int32(size_t at, int32_t n);
+
+    int frame_offset(int slot);
+};
+
+
+/**
+ * \brief Constructor for the compiler of one function
+ * @param jit - the state to fill in
+ * @param fun - the closure that made the function hot
+ */
+JitCompiler::JitCompiler(JitFunction &jit, FunVal *fun) : jit(jit) {
+    this->fun = fun;
+    this->assumed_result = tag_int;
+    this->nodes = 0;
+    this->calls = 0;
+}
+
+
+/**
+ * \brief Checks the body and emits the code
+ *
+ * The kind f(f)(x) returns is not known up front, the body is checked once assuming an integer and once assuming a
+ * boolean, and the assumption that holds is kept.
+ * @param bytes - set to the machine code
+ * @return - false when the body does not fit the subset, the state of jit is then undefined
+ */
+bool JitCompiler::compile(std::vector<uint8_t> &bytes) {
+    bool checked = false;
+
+    for ( value_tag_t assumption : {tag_int, tag_bool} ) {
+        assumed_result = assumption;
+        nodes = 0;
+        calls = 0;
+        tags.clear();
+        calling.clear();
+        local_tags.assign(fun->frame_size, tag_object);
+        local_tags[0] = jit.arg_tag;
+        self_locals.assign(fun->frame_size, false);
+        jit.captures.clear();
+        jit.self_recursive = false;
+
+        try {
+            if ( check(&*fun->body) == assumption ) {
+                checked = true;
+                break;
+            }
+        } catch ( const std::runtime_error & ) {
+            //try the other assumption
+        }
+    }
+
+    if ( !checked ) {
+        return false;
+    }
+
+    if ( jit.self_recursive ) {
+        if ( self_function(fun, jit.sources) == nullptr ) {
+            return false;
+        }
+
+        //a self call runs with the captures of this closure, every call checks that f(f) would see the same ones,
+        //which rules out the _let variables of the frame f is called in since they are computed again
+        for ( const JitFunction::Capture &capture : jit.captures ) {
+            if ( jit.sources[capture.slot].depth < 1 ) {
+                return false;
+            }
+        }
+    }
+
+    int frame = 16 + 8 * (fun->frame_size - 1);
+    frame = (frame + 15) & ~15;
+
+    emit_bytes({0x55});                     // push rbp
+    emit_bytes({0x48, 0x89, 0xE5});         // mov rbp, rsp
+    emit_bytes({0x48, 0x81, 0xEC});         // sub rsp, frame
+    emit_int32(frame);
+    emit_bytes({0x48, 0x89, 0x7D, 0xF8});   // mov [rbp-8], rdi
+    emit_bytes({0x48, 0x89, 0x75, 0xF0});   // mov [rbp-16], rsi
+    emit_bytes({0x48, 0x8B, 0x8E});         // mov rcx, [rsi+limit_offset]
+    emit_int32(limit_offset);
+    emit_bytes({0x48, 0x39, 0xCC});         // cmp rsp, rcx
+    emit_bytes({0x0F, 0x82});               // jb overflow
+    size_t to_overflow = code.size();
+    emit_int32(0);
+
+    unwinds.clear();
+    emit(&*fun->body);
+
+    for ( size_t unwind : unwinds ) {
+        patch_int32(unwind, (int32_t) (code.size() - (unwind + 4)));
+    }
+    emit_bytes({0xC9});                     // leave
+    emit_bytes({0xC3});                     // ret
+
+    patch_int32(to_overflow, (int32_t) (code.size() - (to_overflow + 4)));
+    emit_bytes({0x48, 0xC7, 0x86});         // mov qword [rsi+overflow_offset], 1
+    emit_int32(overflow_offset);
+    emit_int32(1);
+    emit_bytes({0xC9});                     // leave
+    emit_bytes({0xC3});                     // ret
+
+    jit.result_tag = assumed_result;
+    bytes = std::move(code);
+    return true;
+}
+
+
+/**
+ * \brief Checks whether a call is f(f)(x), written out or through a _let bound to f(f)
+ * @param call - the call
+ * @return - true when the call can become a native call of the code itself
+ */
+bool JitCompiler::is_self_call(CallExpr *call) {
+    Expr *callee = &*call->to_be_called;
+    if ( callee->kind == expr_var ) {
+        VarExpr *var = static_cast<VarExpr *>(callee);
+        return var->depth == 0 && self_locals.at(var->slot);
+    }
+    return is_self_application(callee, jit.sources);
+}
+
+
+/**
+ * \brief Works out the kind of value an expression evaluates to
+ * @param e - a node of the body
+ * @return - tag_int or tag_bool, throws when the node is outside the subset or would raise an error
+ */
+value_tag_t JitCompiler::check(Expr *e) {
+    if ( ++nodes > max_body_size ) {
+        throw std::runtime_error("body too large");
+    }
+
+    value_tag_t tag;
+    int calls_before = calls;
+
+    switch ( e->kind ) {
+        case expr_num:
+            tag = tag_int;
+            break;
+
+        case expr_bool:
+            tag = tag_bool;
+            break;
+
+        case expr_var: {
+            VarExpr *var = static_cast<VarExpr *>(e);
+            if ( var->depth < 0 ) {
+                throw std::runtime_error("free variable");
+            } else if ( var->depth == 0 ) {
+                //a function does not fit in a slot, a self local can only be called
+                if ( self_locals.at(var->slot)) {
+                    throw std::runtime_error("self application used as a value");
+                }
+                tag = local_tags.at(var->slot);
+                if ( tag == tag_object ) {
+                    throw std::runtime_error("unbound slot");
+                }
+            } else {
+                tag = jit.captures[capture_index(var)].tag;
+            }
+            break;
+        }
+
+        case expr_add:
+        case expr_mult: {
+            bool add = e->kind == expr_add;
+            Expr *lhs = add ? &*static_cast<AddExpr *>(e)->lhs : &*static_cast<MultExpr *>(e)->lhs;
+            Expr *rhs = add ? &*static_cast<AddExpr *>(e)->rhs : &*static_cast<MultExpr *>(e)->rhs;
+            if ( check(lhs) != tag_int || check(rhs) != tag_int ) {
+                throw std::runtime_error("arithmetic on a boolean");
+            }
+            tag = tag_int;
+            break;
+        }
+
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(e);
+            check(&*eq->lhs);
+            check(&*eq->rhs);
+            tag = tag_bool;
+            break;
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            if ( check(&*ifExpr->ifExpr) != tag_bool ) {
+                throw std::runtime_error("condition is not a boolean");
+            }
+            tag = check(&*ifExpr->thenExpr);
+            if ( check(&*ifExpr->elseExpr) != tag ) {
+                throw std::runtime_error("branches of different kinds");
+            }
+            break;
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(e);
+            if ( let->slot <= 0 ) {
+                throw std::runtime_error("_let outside of a frame");
+            }
+            if ( is_self_application(&*let->rhs, jit.sources)) {
+                //only ever called, so it needs no value in the frame
+                self_locals.at(let->slot) = true;
+            } else {
+                local_tags.at(let->slot) = check(&*let->rhs);
+            }
+            tag = check(&*let->body);
+            break;
+        }
+
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(e);
+            if ( !is_self_call(call) || check(&*call->actual_arg) != jit.arg_tag ) {
+                throw std::runtime_error("call is not a self call");
+            }
+            jit.self_recursive = true;
+            calls++;
+            tag = assumed_result;
+            break;
+        }
+
+        default:
+            throw std::runtime_error("expression outside of the subset");
+    }
+
+    tags[e] = tag;
+    if ( calls != calls_before ) {
+        calling.insert(e);
+    }
+    return tag;
+}
+
+
+/**
+ * \brief Finds or adds the capture for a variable of an enclosing function
+ * @param var - a variable with a depth of at least 1
+ * @return - its index in the captures passed to the code, throws when it is not an integer or boolean
+ */
+int JitCompiler::capture_index(VarExpr *var) {
+    for ( size_t i = 0; i < jit.captures.size(); i++ ) {
+        if ( jit.captures[i].depth == var->depth && jit.captures[i].slot == var->slot ) {
+            return (int) i;
+        }
+    }
+
+    if ( jit.captures.size() == max_captures ) {
+        throw std::runtime_error("too many captures");
+    }
+
+    Value value = fun->env->lookup_at(var->depth - 1, var->slot);
+    int64_t unused;
+    value_tag_t tag;
+    if ( unbox(value, tag_int, unused)) {
+        tag = tag_int;
+    } else if ( unbox(value, tag_bool, unused)) {
+        tag = tag_bool;
+    } else {
+        throw std::runtime_error("captured variable is not an integer or boolean");
+    }
+
+    jit.captures.push_back({var->depth, var->slot, tag});
+    return (int) jit.captures.size() - 1;
+}
+
+
+/**
+ * \brief Emits the template for a node, the value ends up in eax
+ * @param e - a node that passed check
+ */
+void JitCompiler::emit(Expr *e) {
+    switch ( e->kind ) {
+        case expr_num:
+            emit_bytes({0xB8});                         // mov eax, val
+            emit_int32(static_cast<NumExpr *>(e)->val);
+            break;
+
+        case expr_bool:
+            emit_bytes({0xB8});                         // mov eax, 0 or 1
+            emit_int32(static_cast<BoolExpr *>(e)->boolean ? 1 : 0);
+            break;
+
+        case expr_var: {
+            VarExpr *var = static_cast<VarExpr *>(e);
+            if ( var->depth == 0 ) {
+                emit_bytes({0x48, 0x8B, 0x85});         // mov rax, [rbp+offset]
+                emit_int32(frame_offset(var->slot));
+            } else {
+                emit_bytes({0x48, 0x8B, 0x4D, 0xF0});   // mov rcx, [rbp-16]
+                emit_bytes({0x48, 0x8B, 0x81});         // mov rax, [rcx+8*index]
+                emit_int32(8 * capture_index(var));
+            }
+            break;
+        }
+
+        case expr_add:
+        case expr_mult: {
+            bool add = e->kind == expr_add;
+            emit(add ? &*static_cast<AddExpr *>(e)->lhs : &*static_cast<MultExpr *>(e)->lhs);
+            emit_bytes({0x50});                         // push rax
+            emit(add ? &*static_cast<AddExpr *>(e)->rhs : &*static_cast<MultExpr *>(e)->rhs);
+            emit_bytes({0x59});                         // pop rcx
+            if ( add ) {
+                emit_bytes({0x01, 0xC8});               // add eax, ecx
+            } else {
+                emit_bytes({0x0F, 0xAF, 0xC1});         // imul eax, ecx
+            }
+            break;
+        }
+
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(e);
+            if ( tags[&*eq->lhs] != tags[&*eq->rhs] ) {
+                //an integer never equals a boolean, but a side with a self call in it still runs, the recursion
+                //may be too deep and has to unwind
+                if ( calling.count(&*eq->lhs) != 0 || calling.count(&*eq->rhs) != 0 ) {
+                    emit(&*eq->lhs);
+                    emit_bytes({0x50});                 // push rax
+                    emit(&*eq->rhs);
+                    emit_bytes({0x59});                 // pop rcx
+                }
+                emit_bytes({0xB8});                     // mov eax, 0
+                emit_int32(0);
+                break;
+            }
+            emit(&*eq->lhs);
+            emit_bytes({0x50});                         // push rax
+            emit(&*eq->rhs);
+            emit_bytes({0x59});                         // pop rcx
+            emit_bytes({0x39, 0xC1});                   // cmp ecx, eax
+            emit_bytes({0x0F, 0x94, 0xC0});             // sete al
+            emit_bytes({0x0F, 0xB6, 0xC0});             // movzx eax, al
+            break;
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            emit(&*ifExpr->ifExpr);
+            emit_bytes({0x85, 0xC0});                   // test eax, eax
+            emit_bytes({0x0F, 0x84});                   // jz else
+            size_t to_else = code.size();
+            emit_int32(0);
+
+            emit(&*ifExpr->thenExpr);
+            emit_bytes({0xE9});                         // jmp end
+            size_t to_end = code.size();
+            emit_int32(0);
+
+            patch_int32(to_else, (int32_t) (code.size() - (to_else + 4)));
+            emit(&*ifExpr->elseExpr);
+            patch_int32(to_end, (int32_t) (code.size() - (to_end + 4)));
+            break;
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(e);
+            if ( !self_locals[let->slot] ) {
+                emit(&*let->rhs);
+                emit_bytes({0x48, 0x89, 0x85});         // mov [rbp+offset], rax
+                emit_int32(frame_offset(let->slot));
+            }
+            emit(&*let->body);
+            break;
+        }
+
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(e);
+            emit(&*call->actual_arg);
+            emit_bytes({0x48, 0x89, 0xC7});             // mov rdi, rax
+            emit_bytes({0x48, 0x8B, 0x75, 0xF0});       // mov rsi, [rbp-16]
+            emit_bytes({0xE8});                         // call the start of the code
+            emit_int32(-(int32_t) (code.size() + 4));
+            emit_bytes({0x48, 0x8B, 0x4D, 0xF0});       // mov rcx, [rbp-16]
+            emit_bytes({0x48, 0x83, 0xB9});             // cmp qword [rcx+overflow_offset], 0
+            emit_int32(overflow_offset);
+            emit_bytes({0x00});
+            emit_bytes({0x0F, 0x85});                   // jne epilogue
+            unwinds.push_back(code.size());
+            emit_int32(0);
+            break;
+        }
+
+        default:
+            throw std::runtime_error("expression outside of the subset");
+    }
+}
+
+
+/**
+ * \brief Appends instruction bytes
+ * @param bytes - the bytes
+ */
+void JitCompiler::emit_bytes(std::initializer_list<uint8_t> bytes) {
+    code.insert(code.end(), bytes);
+}
+
+
+/**
+ * \brief Appends a little endian 32-bit immediate or displacement
+ * @param n - the value
+ */
+void JitCompiler::emit_int32(int32_t n) {
+    uint8_t bytes[4];
+    std::memcpy(bytes, &n, 4);
+    code.insert(code.end(), bytes, bytes + 4);
+}
+
+
+/**
+ * \brief Overwrites a 32-bit value emitted earlier, used for forward jumps
+ * @param at - where the value starts
+ * @param n - the value
+ */
+void JitCompiler::patch_int32(size_t at, int32_t n) {
+    std::memcpy(&code[at], &n, 4);
+}
+
+
+/**
+ * \brief Returns where a slot of the call's frame lives, the captures pointer sits between slot 0 and slot 1
+ * @param slot - the slot
+ * @return - the offset from rbp
+ */
+int JitCompiler::frame_offset(int slot) {
+    return slot == 0 ? -8 : -16 - 8 * slot;
+}
+
+
+/**
+ * \brief Constructor for a function that has not been called yet
+ * @param sources - the capture list of the _fun
+ */
+JitFunction::JitFunction(const std::vector<EnvAddress> &sources) {
+    this->sources = sources;
+    this->calls = 0;
+    this->failed = false;
+    this->code = nullptr;
+    this->code_size = 0;
+    this->arg_tag = tag_int;
+    this->result_tag = tag_int;
+    this->self_recursive = false;
+}
+
+
+/**
+ * \brief Destructor, unmaps the native code
+ */
+JitFunction::~JitFunction() {
+#if JIT_AVAILABLE
+    if ( this->code != nullptr ) {
+        munmap(this->code, this->code_size);
+    }
+#endif
+}
+
+
+/**
+ * \brief Compiles the body of a hot function into an executable mapping
+ * @param fun - the closure whose call made the function hot
+ * @param arg - the argument of that call, the code is made for its kind
+ */
+void JitFunction::compile(FunVal *fun, const Value &arg) {
+    failed = true;
+
+#if JIT_AVAILABLE
+    int64_t unused;
+    if ( fun->frame_size < 1 ) {
+        return;
+    } else if ( unbox(arg, tag_int, unused)) {
+        arg_tag = tag_int;
+    } else if ( unbox(arg, tag_bool, unused)) {
+        arg_tag = tag_bool;
+    } else {
+        return;
+    }
+
+    JitCompiler compiler(*this, fun);
+    std::vector<uint8_t> bytes;
+    try {
+        if ( !compiler.compile(bytes)) {
+            return;
+        }
+    } catch ( const std::exception & ) {
+        return;
+    }
+
+    //written while writable, then switched to executable so the mapping is never both
+    void *mapped = mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if ( mapped == MAP_FAILED ) {
+        return;
+    }
+    std::memcpy(mapped, bytes.data(), bytes.size());
+    if ( mprotect(mapped, bytes.size(), PROT_READ | PROT_EXEC) != 0 ) {
+        munmap(mapped, bytes.size());
+        return;
+    }
+
+    code = mapped;
+    code_size = bytes.size();
+    failed = false;
+#endif
+}
+
+
+/**
+ * \brief Counts a call and runs it natively when the function is compiled and the call fits the code
+ * @param fun - the closure being called
+ * @param arg_value - the argument
+ * @param result - set to the result when the call ran natively
+ * @return - false when the call has to be evaluated by interp()
+ */
+bool JitFunction::call(FunVal *fun, const Value &arg_value, Value &result) {
+
+    if ( code == nullptr ) {
+        if ( failed || ++calls < threshold ) {
+            return false;
+        }
+        compile(fun, arg_value);
+        if ( code == nullptr ) {
+            return false;
+        }
+    }
+
+    int64_t arg;
+    if ( !unbox(arg_value, arg_tag, arg)) {
+        return false;
+    }
+
+    //only a recursive function goes deeper than this call, it needs a limit to stop at
+    const char *limit = native_stack_limit();
+    if ( limit == nullptr && self_recursive ) {
+        return false;
+    }
+
+    //the captures, then the stack limit and the overflow flag, see the top of this file
+    int64_t values[max_captures + 2];
+    values[max_captures] = (int64_t) (intptr_t) limit;
+    values[max_captures + 1] = 0;
+    for ( size_t i = 0; i < captures.size(); i++ ) {
+        Value captured = fun->env->lookup_at(captures[i].depth - 1, captures[i].slot);
+        if ( !unbox(captured, captures[i].tag, values[i])) {
+            return false;
+        }
+    }
+
+    if ( self_recursive ) {
+        FunVal *self = self_function(fun, sources);
+        if ( self == nullptr ) {
+            return false;
+        }
+
+        //f(f) copies these captures out of the ClosureEnv of f, where the capture list says they came from
+        try {
+            for ( size_t i = 0; i < captures.size(); i++ ) {
+                int64_t seen;
+                const EnvAddress &source = sources[captures[i].slot];
+                Value captured = self->env->lookup_at(source.depth - 1, source.slot);
+                if ( !unbox(captured, captures[i].tag, seen) || seen != values[i] ) {
+                    return false;
+                }
+            }
+        } catch ( const std::runtime_error & ) {
+            //f was made in a shallower environment than the closure that received it
+            return false;
+        }
+    }
+
+    typedef int64_t (*entry_t)(int64_t, const int64_t *);
+    int64_t native = reinterpret_cast<entry_t>(code)(arg, values);
+    if ( values[max_captures + 1] != 0 ) {
+        throw std::runtime_error("recursion too deep");
+    }
+
+    if ( result_tag == tag_int ) {
+        result = Value::from_int((int) native);
+    } else {
+        result = Value::from_bool((native & 1) != 0);
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+#ifndef MSDSCRIPT_JIT_H
+#define MSDSCRIPT_JIT_H
+
+/**
+ * \file Jit.h
+ * \brief native code for hot functions
+ *
+ * When the JIT is enabled, every resolved _fun counts the calls made through FunVal::call. Once a function is hot
+ * its body is translated, one fixed instruction template per node, into x86-64 code in an executable mapping.
+ * Only bodies that are entirely integers and booleans are compiled, anything else keeps running in interp().
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "pointer.h"
+#include "Value.h"
+#include "Env.h"
+
+class Val;
+
+class FunVal;
+
+
+void set_jit_enabled(bool enabled);
+
+bool jit_enabled();
+
+
+/**
+ * \brief The call count and native code of one _fun expression, shared by every closure made from it
+ *
+ * The code is specialized for the kind of argument of the call that made the function hot. It can use
+ * - numbers, booleans, +, *, ==, _if and _let
+ * - the argument and the _let variables of the body
+ * - integers and booleans captured from enclosing functions, read on every call
+ * - calls of the form f(f)(x) where f is the argument of the enclosing function and that function returns this
+ *   one, the self application MSDscript uses for recursion, which become native calls. f(f) may also be bound by a
+ *   _let first, as common subexpression elimination does when it appears twice. A recursive function can only
+ *   capture variables that f(f) sees with the same values
+ *
+ * A call whose argument or captured variables do not have the kinds the code was made for is evaluated by
+ * interp() as usual. A body that does not fit is never looked at again.
+ */
+class JitFunction {
+public:
+    static const int threshold = 16; ///< calls before the body is compiled
+
+    explicit JitFunction(const std::vector<EnvAddress> &sources);
+
+    ~JitFunction();
+
+    JitFunction(const JitFunction &) = delete;
+
+    JitFunction &operator=(const JitFunction &) = delete;
+
+    bool call(FunVal *fun, const Value &actual_arg, Value &result);
+
+private:
+    /**
+     * \brief A variable of an enclosing function that the code reads
+     */
+    struct Capture {
+        int depth; ///< frames up from the body, at least 1
+        int slot; ///< slot in that frame
+        value_tag_t tag; ///< tag_int or tag_bool
+    };
+
+    int calls; ///< calls counted so far
+    bool failed; ///< the body cannot be compiled
+    void *code; ///< the native code, nullptr until compiled
+    size_t code_size; ///< bytes mapped for the code
+    value_tag_t arg_tag; ///< the kind of argument the code takes
+    value_tag_t result_tag; ///< the kind of value the code returns
+    std::vector<Capture> captures; ///< passed to the code in this order
+    std::vector<EnvAddress> sources; ///< the capture list of the _fun, where its ClosureEnv slots were copied from
+    bool self_recursive; ///< the code calls itself for f(f)(x)
+
+    void compile(FunVal *fun, const Value &arg);
+
+    friend class JitCompiler;
+};
+
+
+#endif //MSDSCRIPT_JIT_H
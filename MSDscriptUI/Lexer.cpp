@@ -0,0 +1,229 @@
+#include "Lexer.h"
+#include <cctype>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * \file Lexer.cpp
+ * \brief contains the implementation of the tokenizer
+ */
+
+
+/**
+ * \brief Maps the word after an underscore to its keyword token
+ * @param word - the letters after the underscore
+ * @return - the keyword token, tok_error if the word is not a keyword
+ */
+static token_kind_t keyword_kind(std::string_view word) {
+    if ( word == "let" ) {
+        return tok_let;
+    } else if ( word == "in" ) {
+        return tok_in;
+    } else if ( word == "if" ) {
+        return tok_if;
+    } else if ( word == "then" ) {
+        return tok_then;
+    } else if ( word == "else" ) {
+        return tok_else;
+    } else if ( word == "true" ) {
+        return tok_true;
+    } else if ( word == "false" ) {
+        return tok_false;
+    } else if ( word == "fun" ) {
+        return tok_fun;
+    }
+    return tok_error;
+}
+
+
+/**
+ * \brief Splits source text into tokens in one pass over the buffer
+ *
+ * Lexing stops at the first character that cannot start a token and records a tok_error there, the parser only
+ * fails if it actually needs that token. The result always ends with tok_end.
+ * @param source - the program text
+ * @return - the tokens
+ */
+std::vector<Token> tokenize(std::string_view source) {
+    std::vector<Token> tokens;
+    tokens.reserve(source.size() / 3 + 1);
+
+    //names already interned by this call, so a repeated name takes no lock and no allocation
+    std::unordered_map<std::string_view, symbol_t> names;
+
+    const char *p = source.data();
+    const char *end = p + source.size();
+
+    while ( true ) {
+        bool after_space = false;
+        while ( p < end && isspace((unsigned char) *p)) {
+            after_space = true;
+            p++;
+        }
+
+        Token token;
+        token.after_space = after_space;
+        token.num = 0;
+
+        if ( p == end ) {
+            token.kind = tok_end;
+            tokens.push_back(token);
+            return tokens;
+        }
+
+        char c = *p;
+
+        if ( isdigit((unsigned char) c) || (c == '-' && p + 1 < end && isdigit((unsigned char) p[1]))) {
+            bool negative = c == '-';
+            if ( negative ) {
+                p++;
+            }
+            //wraps around on overflow, like the arithmetic
+            unsigned n = 0;
+            while ( p < end && isdigit((unsigned char) *p)) {
+                n = n * 10 + (unsigned) (*p - '0');
+                p++;
+            }
+            token.kind = tok_num;
+            token.num = (int) (negative ? 0u - n : n);
+
+        } else if ( isalpha((unsigned char) c)) {
+            const char *start = p;
+            while ( p < end && isalpha((unsigned char) *p)) {
+                p++;
+            }
+            if ( p < end && (*p == '_' || *p == '-')) {
+                token.kind = tok_error;
+            } else {
+                std::string_view name(start, p - start);
+                auto found = names.find(name);
+                if ( found == names.end()) {
+                    found = names.emplace(name, intern(std::string(name))).first;
+                }
+                token.kind = tok_var;
+                token.name = found->second;
+            }
+
+        } else if ( c == '_' ) {
+            const char *start = ++p;
+            while ( p < end && isalpha((unsigned char) *p)) {
+                p++;
+            }
+            token.kind = keyword_kind(std::string_view(start, p - start));
+
+        } else if ( c == '=' ) {
+            p++;
+            if ( p < end && *p == '=' ) {
+                p++;
+                token.kind = tok_eqeq;
+            } else {
+                token.kind = tok_equals;
+            }
+
+        } else {
+            p++;
+            switch ( c ) {
+                case '+':
+                    token.kind = tok_plus;
+                    break;
+                case '*':
+                    token.kind = tok_star;
+                    break;
+                case '(':
+                    token.kind = tok_lparen;
+                    break;
+                case ')':
+                    token.kind = tok_rparen;
+                    break;
+                default:
+                    token.kind = tok_error;
+                    break;
+            }
+        }
+
+        tokens.push_back(token);
+
+        if ( token.kind == tok_error ) {
+            token.kind = tok_end;
+            tokens.push_back(token);
+            return tokens;
+        }
+    }
+}
+
+
+/**
+ * \brief Opens a file and maps it into memory
+ * @param path - the file to open
+ */
+MappedFile::MappedFile(const std::string &path) {
+    this->data = nullptr;
+    this->size = 0;
+
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if ( fd < 0 ) {
+        throw std::runtime_error("cannot open " + path);
+    }
+
+    struct stat info;
+    bool empty = false;
+    if ( fstat(fd, &info) == 0 ) {
+        empty = info.st_size == 0;
+        if ( !empty ) {
+            void *mapped = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if ( mapped != MAP_FAILED ) {
+                this->data = (const char *) mapped;
+                this->size = (size_t) info.st_size;
+            }
+        }
+    }
+    close(fd);
+
+    if ( this->data != nullptr || empty ) {
+        return;
+    }
+#endif
+
+    //no mmap on this platform, or the file could not be mapped
+    std::ifstream file(path, std::ios::binary);
+    if ( !file ) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    this->contents = buffer.str();
+}
+
+
+/**
+ * \brief Unmaps the file
+ */
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if ( this->data != nullptr ) {
+        munmap((void *) this->data, this->size);
+    }
+#endif
+}
+
+
+/**
+ * \brief Returns the contents of the file
+ * @return - a view that is valid while this object lives
+ */
+std::string_view MappedFile::view() const {
+    if ( this->data != nullptr ) {
+        return std::string_view(this->data, this->size);
+    }
+    return this->contents;
+}
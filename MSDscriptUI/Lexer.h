@@ -0,0 +1,80 @@
+#ifndef MSDSCRIPT_LEXER_H
+#define MSDSCRIPT_LEXER_H
+
+/**
+ * \file Lexer.h
+ * \brief tokenizer for MSDscript source
+ *
+ * Contains the declarations for the token type, the function that splits a contiguous buffer into tokens and a
+ * memory-mapped file the buffer can come from
+ */
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Symbol.h"
+
+/**
+ * \brief The kinds of tokens
+ */
+typedef enum {
+    tok_num = 0, ///< a number, possibly negative
+    tok_var,     ///< a variable name
+    tok_let,     ///< _let
+    tok_in,      ///< _in
+    tok_if,      ///< _if
+    tok_then,    ///< _then
+    tok_else,    ///< _else
+    tok_true,    ///< _true
+    tok_false,   ///< _false
+    tok_fun,     ///< _fun
+    tok_plus,    ///< +
+    tok_star,    ///< *
+    tok_eqeq,    ///< ==
+    tok_equals,  ///< a single =
+    tok_lparen,  ///< (
+    tok_rparen,  ///< )
+    tok_error,   ///< input that is not a token, the parser reports it if it gets this far
+    tok_end      ///< end of the input
+} token_kind_t;
+
+
+/**
+ * \brief One token
+ */
+struct Token {
+    token_kind_t kind;
+    bool after_space; ///< whitespace came right before, a call needs its ( directly after the function
+    union {
+        int num; ///< value of a tok_num
+        symbol_t name; ///< interned name of a tok_var
+    };
+};
+
+
+std::vector<Token> tokenize(std::string_view source);
+
+
+/**
+ * \brief A read-only view of a whole file, memory-mapped where the platform allows it
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    std::string_view view() const;
+
+private:
+    const char *data; ///< first byte of the file
+    size_t size; ///< length of the file
+    std::string contents; ///< the file read into memory when it cannot be mapped
+};
+
+
+#endif //MSDSCRIPT_LEXER_H
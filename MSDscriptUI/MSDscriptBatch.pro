@@ -0,0 +1,20 @@
+# Headless batch evaluator, build with qmake MSDscriptBatch.pro && make
+
+include(MSDscriptCore.pri)
+
+TARGET = msdscript-batch
+
+SOURCES += \
+    Batch.cpp \
+    batch_main.cpp
+
+HEADERS += \
+    Batch.h
+
+CONFIG += console thread
+CONFIG -= qt app_bundle
+
+# make check runs the regression tests in tests/ against the binary
+check.commands = sh $$PWD/tests/run_tests.sh $$OUT_PWD/$$TARGET
+check.depends = $(TARGET)
+QMAKE_EXTRA_TARGETS += check
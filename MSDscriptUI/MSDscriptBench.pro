@@ -0,0 +1,13 @@
+# Benchmarks, build with qmake MSDscriptBench.pro && make
+# Add "DEFINES+=USE_ARENA_POINTERS=1", "DEFINES+=USE_PLAIN_POINTERS=1" or "DEFINES+=USE_GC_POINTERS=1" to the qmake call
+# for the other pointer modes
+
+include(MSDscriptCore.pri)
+
+TARGET = msdscript-bench
+
+SOURCES += \
+    bench_main.cpp
+
+CONFIG += console thread
+CONFIG -= qt app_bundle
@@ -0,0 +1,62 @@
+# The interpreter itself, shared by the Qt front end and the headless targets
+
+SOURCES += \
+    $$PWD/Env.cpp \
+    $$PWD/Val.cpp \
+    $$PWD/parse.cpp \
+    $$PWD/Expr.cpp \
+    $$PWD/Bytecode.cpp \
+    $$PWD/Arena.cpp \
+    $$PWD/Value.cpp \
+    $$PWD/Resolver.cpp \
+    $$PWD/Symbol.cpp \
+    $$PWD/CEK.cpp \
+    $$PWD/Optimizer.cpp \
+    $$PWD/ExprTable.cpp \
+    $$PWD/CSE.cpp \
+    $$PWD/Lexer.cpp \
+    $$PWD/AllocStats.cpp \
+    $$PWD/ExprPrinter.cpp \
+    $$PWD/Jit.cpp \
+    $$PWD/EvalCache.cpp \
+    $$PWD/Cancel.cpp \
+    $$PWD/Scheduler.cpp \
+    $$PWD/TypeChecker.cpp \
+    $$PWD/FlatAst.cpp \
+    $$PWD/Gc.cpp \
+    $$PWD/AstCache.cpp \
+    $$PWD/Prelude.cpp
+
+HEADERS += \
+    $$PWD/Env.h \
+    $$PWD/Val.h \
+    $$PWD/parse.hpp \
+    $$PWD/Expr.h \
+    $$PWD/pointer.h \
+    $$PWD/Bytecode.h \
+    $$PWD/Arena.h \
+    $$PWD/Value.h \
+    $$PWD/Resolver.h \
+    $$PWD/Symbol.h \
+    $$PWD/CEK.h \
+    $$PWD/Optimizer.h \
+    $$PWD/ExprTable.h \
+    $$PWD/CSE.h \
+    $$PWD/Lexer.h \
+    $$PWD/AllocStats.h \
+    $$PWD/ExprPrinter.h \
+    $$PWD/Jit.h \
+    $$PWD/EvalCache.h \
+    $$PWD/Cancel.h \
+    $$PWD/Scheduler.h \
+    $$PWD/TypeChecker.h \
+    $$PWD/FlatAst.h \
+    $$PWD/Gc.h \
+    $$PWD/AstCache.h \
+    $$PWD/Prelude.h
+
+INCLUDEPATH += $$PWD
+
+# qmake "DEFINES+=USE_ALLOC_STATS=1" prints object counts after every evaluation
+
+CONFIG += c++17
@@ -1,17 +1,12 @@
+include(MSDscriptCore.pri)
+
 SOURCES += \
     main.cpp \
     msdscriptwidget.cpp \
-    Env.cpp \
-    Val.cpp \
-    parse.cpp \
-    Expr.cpp
+    evalworker.cpp
 
 HEADERS += \
     msdscriptwidget.h \
-    Env.h \
-    Val.h \
-    parse.hpp \
-    Expr.h \
-    pointer.h
+    evalworker.h
 
 QT += widgets
@@ -0,0 +1,400 @@
+#include "Optimizer.h"
+#include "Expr.h"
+#include "CSE.h"
+#include <vector>
+
+/**
+ * \file Optimizer.cpp
+ * \brief contains the implementation of the expression simplifier
+ */
+
+
+/**
+ * \brief Checks if an expression is a number or boolean literal
+ * @param e - the expression
+ * @return - true for a NumExpr or BoolExpr
+ */
+static bool is_literal(Expr *e) {
+    return e->kind == expr_num || e->kind == expr_bool;
+}
+
+
+/**
+ * \brief Checks if evaluating an expression always succeeds, so it can be dropped when its value is unused
+ * @param e - the expression
+ * @return - true when the expression can neither raise an error nor loop
+ */
+static bool cannot_fail(Expr *e) {
+    switch ( e->kind ) {
+        case expr_num:
+        case expr_bool:
+        case expr_fun:
+            return true;
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(e);
+            return cannot_fail(&*eq->lhs) && cannot_fail(&*eq->rhs);
+        }
+        default:
+            //a variable may be unbound, arithmetic may see a boolean and a call may not return
+            return false;
+    }
+}
+
+
+/**
+ * \brief Checks if a variable is used in an expression without being rebound first
+ * @param name - the variable
+ * @param e - the expression
+ * @return - true if the variable occurs free
+ */
+static bool occurs_free(symbol_t name, Expr *e) {
+    switch ( e->kind ) {
+        case expr_num:
+        case expr_bool:
+            return false;
+        case expr_var:
+            return static_cast<VarExpr *>(e)->value == name;
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(e);
+            return occurs_free(name, &*add->lhs) || occurs_free(name, &*add->rhs);
+        }
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(e);
+            return occurs_free(name, &*mult->lhs) || occurs_free(name, &*mult->rhs);
+        }
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(e);
+            return occurs_free(name, &*eq->lhs) || occurs_free(name, &*eq->rhs);
+        }
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            return occurs_free(name, &*ifExpr->ifExpr) || occurs_free(name, &*ifExpr->thenExpr) ||
+                   occurs_free(name, &*ifExpr->elseExpr);
+        }
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(e);
+            return occurs_free(name, &*let->rhs) || (let->value != name && occurs_free(name, &*let->body));
+        }
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(e);
+            return fun->formal_arg != name && occurs_free(name, &*fun->body);
+        }
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(e);
+            return occurs_free(name, &*call->to_be_called) || occurs_free(name, &*call->actual_arg);
+        }
+    }
+    return false;
+}
+
+
+/**
+ * \brief Checks that every free use of a variable is the function position of a call
+ * @param name - the variable
+ * @param e - the expression
+ * @return - true if the variable is never passed around as a value
+ */
+static bool only_called(symbol_t name, Expr *e) {
+    switch ( e->kind ) {
+        case expr_num:
+        case expr_bool:
+            return true;
+        case expr_var:
+            return static_cast<VarExpr *>(e)->value != name;
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(e);
+            return only_called(name, &*add->lhs) && only_called(name, &*add->rhs);
+        }
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(e);
+            return only_called(name, &*mult->lhs) && only_called(name, &*mult->rhs);
+        }
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(e);
+            return only_called(name, &*eq->lhs) && only_called(name, &*eq->rhs);
+        }
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            return only_called(name, &*ifExpr->ifExpr) && only_called(name, &*ifExpr->thenExpr) &&
+                   only_called(name, &*ifExpr->elseExpr);
+        }
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(e);
+            return only_called(name, &*let->rhs) && (let->value == name || only_called(name, &*let->body));
+        }
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(e);
+            return fun->formal_arg == name || only_called(name, &*fun->body);
+        }
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(e);
+            bool callee_ok = call->to_be_called->kind == expr_var || only_called(name, &*call->to_be_called);
+            return callee_ok && only_called(name, &*call->actual_arg);
+        }
+    }
+    return false;
+}
+
+
+/**
+ * \brief Checks that an expression has no free variables
+ * @param e - the expression
+ * @param bound - the variables bound around e, restored before returning
+ * @return - true if every variable in e is bound in e or in bound
+ */
+static bool is_closed(Expr *e, std::vector<symbol_t> &bound) {
+    switch ( e->kind ) {
+        case expr_num:
+        case expr_bool:
+            return true;
+        case expr_var: {
+            symbol_t name = static_cast<VarExpr *>(e)->value;
+            for ( symbol_t b : bound ) {
+                if ( b == name ) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(e);
+            return is_closed(&*add->lhs, bound) && is_closed(&*add->rhs, bound);
+        }
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(e);
+            return is_closed(&*mult->lhs, bound) && is_closed(&*mult->rhs, bound);
+        }
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(e);
+            return is_closed(&*eq->lhs, bound) && is_closed(&*eq->rhs, bound);
+        }
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            return is_closed(&*ifExpr->ifExpr, bound) && is_closed(&*ifExpr->thenExpr, bound) &&
+                   is_closed(&*ifExpr->elseExpr, bound);
+        }
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(e);
+            if ( !is_closed(&*let->rhs, bound)) {
+                return false;
+            }
+            bound.push_back(let->value);
+            bool closed = is_closed(&*let->body, bound);
+            bound.pop_back();
+            return closed;
+        }
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(e);
+            bound.push_back(fun->formal_arg);
+            bool closed = is_closed(&*fun->body, bound);
+            bound.pop_back();
+            return closed;
+        }
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(e);
+            return is_closed(&*call->to_be_called, bound) && is_closed(&*call->actual_arg, bound);
+        }
+    }
+    return false;
+}
+
+
+/**
+ * \brief Counts the nodes of an expression, stopping early once the count passes a limit
+ * @param e - the expression
+ * @param limit - the count that is already too big
+ * @return - the number of nodes, or something above limit
+ */
+static int expr_size(Expr *e, int limit) {
+    if ( limit <= 0 ) {
+        return 1;
+    }
+
+    switch ( e->kind ) {
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(e);
+            int lhs = expr_size(&*add->lhs, limit - 1);
+            return 1 + lhs + expr_size(&*add->rhs, limit - 1 - lhs);
+        }
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(e);
+            int lhs = expr_size(&*mult->lhs, limit - 1);
+            return 1 + lhs + expr_size(&*mult->rhs, limit - 1 - lhs);
+        }
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(e);
+            int lhs = expr_size(&*eq->lhs, limit - 1);
+            return 1 + lhs + expr_size(&*eq->rhs, limit - 1 - lhs);
+        }
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(e);
+            int cond = expr_size(&*ifExpr->ifExpr, limit - 1);
+            int then = expr_size(&*ifExpr->thenExpr, limit - 1 - cond);
+            return 1 + cond + then + expr_size(&*ifExpr->elseExpr, limit - 1 - cond - then);
+        }
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(e);
+            int rhs = expr_size(&*let->rhs, limit - 1);
+            return 1 + rhs + expr_size(&*let->body, limit - 1 - rhs);
+        }
+        case expr_fun:
+            return 1 + expr_size(&*static_cast<FunExpr *>(e)->body, limit - 1);
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(e);
+            int callee = expr_size(&*call->to_be_called, limit - 1);
+            return 1 + callee + expr_size(&*call->actual_arg, limit - 1 - callee);
+        }
+        default:
+            return 1;
+    }
+}
+
+
+/**
+ * \brief Creates an optimizer
+ * @param inline_size - largest function body, in nodes, that is copied into its callers
+ * @param inline_budget - most functions inlined by one call to optimize
+ */
+Optimizer::Optimizer(int inline_size, int inline_budget) {
+    this->inline_size = inline_size;
+    this->inline_budget = inline_budget;
+    this->inlines_left = inline_budget;
+}
+
+
+/**
+ * \brief Optimizes a whole program
+ * @param e - the program
+ * @return - a simplified program with the same value and the same errors
+ */
+PTR(Expr) Optimizer::optimize(PTR(Expr) e) {
+    inlines_left = inline_budget;
+    CSE cse;
+    return cse.eliminate(optimize_expr(e));
+}
+
+
+/**
+ * \brief Simplifies the children of an expression, then the expression itself
+ * @param e - the expression to simplify
+ * @return - the simplified expression, which may share unchanged leaves with e
+ */
+PTR(Expr) Optimizer::optimize_expr(PTR(Expr) e) {
+
+    switch ( e->kind ) {
+
+        case expr_num:
+        case expr_bool:
+        case expr_var:
+            return e;
+
+        case expr_add: {
+            AddExpr *add = static_cast<AddExpr *>(&*e);
+            PTR(Expr) lhs = optimize_expr(add->lhs);
+            PTR(Expr) rhs = optimize_expr(add->rhs);
+            if ( lhs->kind == expr_num && rhs->kind == expr_num ) {
+                //wraps around like NumVal::add_to
+                return NEW (NumExpr)((int) ((unsigned) static_cast<NumExpr *>(&*lhs)->val +
+                                            (unsigned) static_cast<NumExpr *>(&*rhs)->val));
+            }
+            return NEW (AddExpr)(lhs, rhs);
+        }
+
+        case expr_mult: {
+            MultExpr *mult = static_cast<MultExpr *>(&*e);
+            PTR(Expr) lhs = optimize_expr(mult->lhs);
+            PTR(Expr) rhs = optimize_expr(mult->rhs);
+            if ( lhs->kind == expr_num && rhs->kind == expr_num ) {
+                //wraps around like NumVal::mult_with
+                return NEW (NumExpr)((int) ((unsigned) static_cast<NumExpr *>(&*lhs)->val *
+                                            (unsigned) static_cast<NumExpr *>(&*rhs)->val));
+            }
+            return NEW (MultExpr)(lhs, rhs);
+        }
+
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(&*e);
+            PTR(Expr) lhs = optimize_expr(eq->lhs);
+            PTR(Expr) rhs = optimize_expr(eq->rhs);
+            if ( is_literal(&*lhs) && is_literal(&*rhs)) {
+                //a number never equals a boolean, the same as Val::equals
+                return NEW (BoolExpr)(lhs->equals(rhs));
+            }
+            return NEW (EqExpr)(lhs, rhs);
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(&*e);
+            PTR(Expr) condition = optimize_expr(ifExpr->ifExpr);
+            if ( condition->kind == expr_bool ) {
+                return optimize_expr(static_cast<BoolExpr *>(&*condition)->boolean ? ifExpr->thenExpr
+                                                                                     : ifExpr->elseExpr);
+            }
+            PTR(Expr) then_expr = optimize_expr(ifExpr->thenExpr);
+            return NEW (IfExpr)(condition, then_expr, optimize_expr(ifExpr->elseExpr));
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(&*e);
+            PTR(Expr) rhs = optimize_expr(let->rhs);
+            return optimize_let(let->value, rhs, optimize_expr(let->body));
+        }
+
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(&*e);
+            //closures still print the body as it was written
+            PTR(FunExpr) result = NEW (FunExpr)(fun->formal_arg, optimize_expr(fun->body));
+            result->source = fun->source;
+            return result;
+        }
+
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(&*e);
+            PTR(Expr) to_be_called = optimize_expr(call->to_be_called);
+            PTR(Expr) actual_arg = optimize_expr(call->actual_arg);
+            if ( to_be_called->kind == expr_fun ) {
+                //(_fun (x) body)(arg) evaluates arg, then body with x bound to it, which is exactly a _let
+                FunExpr *fun = static_cast<FunExpr *>(&*to_be_called);
+                return optimize_let(fun->formal_arg, actual_arg, fun->body);
+            }
+            return NEW (CallExpr)(to_be_called, actual_arg);
+        }
+    }
+
+    return e;
+}
+
+
+/**
+ * \brief Simplifies a _let whose rhs and body are already simplified
+ * @param name - the variable bound by the _let
+ * @param rhs - the simplified rhs
+ * @param body - the simplified body
+ * @return - the simplified _let, or just its body when the binding could be removed
+ */
+PTR(Expr) Optimizer::optimize_let(symbol_t name, PTR(Expr) rhs, PTR(Expr) body) {
+
+    if ( !occurs_free(name, &*body)) {
+        if ( cannot_fail(&*rhs)) {
+            return body;
+        }
+        return NEW (LetExpr)(name, rhs, body);
+    }
+
+    //a literal has no free variables, so subst cannot capture anything
+    if ( is_literal(&*rhs)) {
+        return optimize_expr(body->subst(name, rhs));
+    }
+
+    //a closed function can be copied to every call without changing what its variables refer to
+    if ( rhs->kind == expr_fun && inlines_left > 0 && only_called(name, &*body) &&
+         expr_size(&*rhs, inline_size + 1) <= inline_size + 1 ) {
+        std::vector<symbol_t> bound;
+        if ( is_closed(&*rhs, bound)) {
+            inlines_left--;
+            return optimize_expr(body->subst(name, rhs));
+        }
+    }
+
+    return NEW (LetExpr)(name, rhs, body);
+}
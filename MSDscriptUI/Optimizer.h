@@ -0,0 +1,51 @@
+#ifndef MSDSCRIPT_OPTIMIZER_H
+#define MSDSCRIPT_OPTIMIZER_H
+
+/**
+ * \file Optimizer.h
+ * \brief expression simplifier
+ *
+ * Rewrites an expression into a smaller one with the same value, so a program that is evaluated many times only
+ * pays for constant work once
+ */
+
+#include "pointer.h"
+#include "Symbol.h"
+
+class Expr;
+
+/**
+ * \brief Simplifies expressions before they are resolved and evaluated
+ *
+ * The optimizer works bottom up and
+ * - folds _add, _mult and == on literals and picks the branch of an _if with a literal condition
+ * - turns a call to a literal _fun into a _let, which is the same thing without the closure
+ * - substitutes literals bound by a _let into the body
+ * - inlines small closed functions bound by a _let when the variable is only ever called
+ * - drops a _let whose variable is unused when evaluating its rhs cannot fail
+ * - finally binds subexpressions that are evaluated more than once to a single _let, see CSE
+ *
+ * Anything that would raise an error at run time, like 1 + _true, is left alone so the error still happens.
+ * Inlining is limited by a budget so a self applying function cannot make the optimizer loop forever.
+ * Every rewritten _fun keeps the body it was written with as its FunExpr::source, so closures print and compare the
+ * same as without the optimizer.
+ * The result is a fresh tree with no Resolver annotations, resolve it afterwards.
+ */
+class Optimizer {
+public:
+    Optimizer(int inline_size = 16, int inline_budget = 64);
+
+    PTR(Expr) optimize(PTR(Expr) e);
+
+private:
+    int inline_size; ///< largest function body, in nodes, that is copied into its callers
+    int inline_budget; ///< most functions inlined by one call to optimize
+    int inlines_left; ///< what is left of the budget
+
+    PTR(Expr) optimize_expr(PTR(Expr) e);
+
+    PTR(Expr) optimize_let(symbol_t name, PTR(Expr) rhs, PTR(Expr) body);
+};
+
+
+#endif //MSDSCRIPT_OPTIMIZER_H
@@ -0,0 +1,437 @@
+#include "Prelude.h"
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Arena.h"
+#include "AstCache.h"
+#include "Env.h"
+#include "Expr.h"
+#include "FlatAst.h"
+#include "Jit.h"
+#include "Lexer.h"
+#include "Optimizer.h"
+#include "parse.hpp"
+#include "Resolver.h"
+#include "Val.h"
+
+/**
+ * \file Prelude.cpp
+ * \brief contains the implementation of evaluating, saving and restoring a prelude
+ *
+ * A snapshot is, in the byte order of the machine that wrote it
+ * - the SnapshotHeader
+ * - the name table and the nodes, in the layout of AstCache.cpp, the root of every tree is the _fun of a closure,
+ *   with the body it was written with as its rhs when the optimizer changed the body
+ * - record_count SnapshotRecords, each one only refers to records before it
+ */
+
+
+/**
+ * \brief The start of a snapshot
+ */
+struct SnapshotHeader {
+    uint32_t magic; ///< "MSDP" in the byte order of the writer
+    uint32_t version; ///< prelude_format_version of the writer
+    uint32_t ast_version; ///< ast_format_version of the writer, which the nodes follow
+    uint32_t record_count;
+    uint64_t source_hash; ///< source_hash of the prelude text
+    uint64_t source_size; ///< length of that text
+    uint64_t body_hash; ///< source_hash of everything after the header
+    uint32_t env; ///< the record of the whole prelude
+    uint32_t reserved; ///< zero
+};
+
+
+/**
+ * \brief The kinds of SnapshotRecord
+ */
+typedef enum {
+    record_binding = 0, ///< an ExtendedEnv
+    record_closure = 1  ///< a FunVal
+} record_kind_t;
+
+
+/**
+ * \brief One environment or closure of a snapshot
+ */
+struct SnapshotRecord {
+    uint32_t kind; ///< a record_kind_t
+    uint32_t name; ///< binding: the index of the name, closure: the node of the _fun
+    uint32_t rest; ///< binding: the environment it extends, closure: its environment, no_record for Env::empty
+    uint32_t tag; ///< binding: the value_tag_t of the value
+    uint32_t value; ///< binding: the number, the boolean, or the record of the closure
+};
+
+static_assert(sizeof(SnapshotHeader) == 48, "the header is part of the format");
+static_assert(sizeof(SnapshotRecord) == 20, "the records are part of the format");
+
+static const uint32_t snapshot_magic = 0x5044534d;
+
+static const uint32_t no_record = UINT32_MAX;
+
+
+/**
+ * \brief Encodes the environments and closures a prelude made
+ *
+ * Environments and closures that several others share are encoded once. Unresolved evaluation only makes
+ * ExtendedEnvs and closures whose bodies are not resolved, anything else cannot be saved.
+ */
+class PreludeWriter {
+public:
+    std::string write(PTR(Env) env, uint64_t hash, size_t size);
+
+private:
+    FlatAst code; ///< the _fun of every closure
+    std::vector<SnapshotRecord> records;
+    std::unordered_map<Env *, uint32_t> env_records; ///< the record of every environment encoded so far
+    std::unordered_map<Val *, uint32_t> closure_records; ///< the record of every closure encoded so far
+    std::map<std::tuple<Expr *, Expr *, symbol_t>, uint32_t> funs; ///< the node of every body, source and argument
+
+    uint32_t add_env(PTR(Env) env);
+
+    uint32_t add_closure(PTR(Val) val);
+};
+
+
+/**
+ * \brief Encodes an environment with everything it reaches
+ * @param env - the environment of the whole prelude
+ * @param hash - the hash of the prelude text
+ * @param size - the length of the prelude text
+ * @return - the snapshot
+ */
+std::string PreludeWriter::write(PTR(Env) env, uint64_t hash, size_t size) {
+    SnapshotHeader header;
+    header.magic = snapshot_magic;
+    header.version = prelude_format_version;
+    header.ast_version = ast_format_version;
+    header.env = add_env(env);
+    header.record_count = (uint32_t) records.size();
+    header.source_hash = hash;
+    header.source_size = size;
+    header.body_hash = 0;
+    header.reserved = 0;
+
+    NameTable names;
+    std::string nodes;
+    encode_nodes(code.nodes, names, nodes);
+    for ( SnapshotRecord &record : records ) {
+        if ( record.kind == record_binding ) {
+            record.name = names.index(record.name);
+        }
+    }
+
+    std::string image(reinterpret_cast<const char *>(&header), sizeof(header));
+    names.encode(image);
+    image.append(nodes);
+    image.append(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SnapshotRecord));
+
+    header.body_hash = source_hash(std::string_view(image).substr(sizeof(header)));
+    std::memcpy(&image[0], &header, sizeof(header));
+    return image;
+}
+
+
+/**
+ * \brief Adds the records of an environment, after the records of everything it reaches
+ *
+ * The chain of bindings is followed with a loop, so a long prelude takes no C++ stack. The names are symbols until
+ * write() turns them into indexes.
+ * @param env - the environment
+ * @return - its record, no_record for Env::empty
+ */
+uint32_t PreludeWriter::add_env(PTR(Env) env) {
+    std::vector<ExtendedEnv *> chain;
+    uint32_t rest = no_record;
+    for ( Env *e = env == nullptr ? nullptr : &*env; e != nullptr && e != &*Env::empty; ) {
+        auto found = env_records.find(e);
+        if ( found != env_records.end()) {
+            rest = found->second;
+            break;
+        }
+        ExtendedEnv *binding = dynamic_cast<ExtendedEnv *>(e);
+        if ( binding == nullptr ) {
+            throw std::runtime_error("the prelude made an environment a snapshot cannot hold");
+        }
+        chain.push_back(binding);
+        e = &*binding->rest;
+    }
+
+    //the outermost binding first, so every record comes after the one it extends
+    for ( size_t i = chain.size(); i-- > 0; ) {
+        ExtendedEnv *binding = chain[i];
+        SnapshotRecord record = {record_binding, binding->name, rest, tag_int, 0};
+        Value val = binding->val;
+        if ( val.tag == tag_object ) {
+            if ( NumVal *num = dynamic_cast<NumVal *>(&*val.object)) {
+                val = Value::from_int(num->val);
+            } else if ( BoolVal *boolean = dynamic_cast<BoolVal *>(&*val.object)) {
+                val = Value::from_bool(boolean->boolean);
+            }
+        }
+        switch ( val.tag ) {
+            case tag_int:
+                record.value = (uint32_t) val.num;
+                break;
+            case tag_bool:
+                record.tag = tag_bool;
+                record.value = val.boolean ? 1 : 0;
+                break;
+            case tag_object:
+                record.tag = tag_object;
+                record.value = add_closure(val.object);
+                break;
+        }
+        rest = (uint32_t) records.size();
+        records.push_back(record);
+        env_records[binding] = rest;
+    }
+    return rest;
+}
+
+
+/**
+ * \brief Adds the record of a closure, after the records of its environment
+ * @param val - the closure
+ * @return - its record
+ */
+uint32_t PreludeWriter::add_closure(PTR(Val) val) {
+    auto found = closure_records.find(&*val);
+    if ( found != closure_records.end()) {
+        return found->second;
+    }
+    FunVal *fun = dynamic_cast<FunVal *>(&*val);
+    if ( fun == nullptr || fun->frame_size >= 0 ) {
+        throw std::runtime_error("the prelude made a value a snapshot cannot hold");
+    }
+
+    SnapshotRecord record = {record_closure, 0, add_env(fun->env), tag_object, 0};
+    auto key = std::make_tuple(&*fun->body, &*fun->source, fun->formal_arg);
+    auto node = funs.find(key);
+    if ( node == funs.end()) {
+        PTR(FunExpr) closure_fun = NEW (FunExpr)(fun->formal_arg, fun->body);
+        closure_fun->source = fun->source;
+        node = funs.emplace(key, code.add_expr(closure_fun)).first;
+    }
+    record.name = node->second;
+
+    uint32_t index = (uint32_t) records.size();
+    records.push_back(record);
+    closure_records[&*val] = index;
+    return index;
+}
+
+
+/**
+ * \brief Builds the code of a snapshot, the resolved _fun of every closure
+ * @param image - the snapshot, usually a mapped file
+ * @param hash - the hash of the prelude text it has to come from
+ * @param size - the length of that text
+ * @param names - set to the names of the snapshot, by their index
+ * @param code - set to one entry per node, the resolved _fun for the nodes closures use and nullptr for the others
+ * @return - false when the snapshot is damaged or was made from another text or format
+ */
+static bool decode_code(std::string_view image, uint64_t hash, size_t size, std::vector<symbol_t> &names,
+                        std::vector<PTR(Expr)> &code) {
+    SnapshotHeader header;
+    if ( image.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, image.data(), sizeof(header));
+    image.remove_prefix(sizeof(header));
+    if ( header.magic != snapshot_magic || header.version != prelude_format_version ||
+         header.ast_version != ast_format_version || header.source_hash != hash || header.source_size != size ||
+         header.body_hash != source_hash(image)) {
+        return false;
+    }
+
+    NameTable table;
+    if ( !table.decode(image) || !decode_nodes(image, table, code) ||
+         image.size() != (uint64_t) header.record_count * sizeof(SnapshotRecord)) {
+        return false;
+    }
+    names = table.names;
+    for ( PTR(Expr) &fun : code ) {
+        if ( fun != nullptr ) {
+            if ( fun->kind != expr_fun ) {
+                return false;
+            }
+            Resolver resolver;
+            fun = resolver.resolve(fun);
+        }
+    }
+    return true;
+}
+
+
+/**
+ * \brief Makes the environments and closures of a snapshot
+ * @param image - the snapshot, which decode_code accepted
+ * @param names - the names decode_code read from it
+ * @param code - the code decode_code made of it
+ * @return - the environment of the whole prelude, nullptr when a record is damaged
+ */
+static PTR(Env) decode_env(std::string_view image, const std::vector<symbol_t> &names,
+                           const std::vector<PTR(Expr)> &code) {
+    SnapshotHeader header;
+    std::memcpy(&header, image.data(), sizeof(header));
+    std::string_view records = image.substr(image.size() - (size_t) header.record_count * sizeof(SnapshotRecord));
+    if ( header.env != no_record && header.env >= header.record_count ) {
+        return nullptr;
+    }
+
+    std::vector<PTR(Env)> envs(header.record_count, nullptr);
+    std::vector<PTR(Val)> closures(header.record_count, nullptr);
+
+    for ( uint32_t i = 0; i < header.record_count; i++ ) {
+        SnapshotRecord record;
+        std::memcpy(&record, records.data() + (size_t) i * sizeof(record), sizeof(record));
+
+        PTR(Env) rest = Env::empty;
+        if ( record.rest != no_record ) {
+            if ( record.rest >= i || envs[record.rest] == nullptr ) {
+                return nullptr;
+            }
+            rest = envs[record.rest];
+        }
+
+        if ( record.kind == record_binding ) {
+            Value val;
+            if ( record.name >= names.size()) {
+                return nullptr;
+            } else if ( record.tag == tag_int ) {
+                val = Value::from_int((int) record.value);
+            } else if ( record.tag == tag_bool ) {
+                val = Value::from_bool(record.value != 0);
+            } else if ( record.tag == tag_object && record.value < i && closures[record.value] != nullptr ) {
+                val = Value::from_val(closures[record.value]);
+            } else {
+                return nullptr;
+            }
+            envs[i] = NEW (ExtendedEnv)(names[record.name], val, rest);
+
+        } else if ( record.kind == record_closure && record.name < code.size() && code[record.name] != nullptr ) {
+            //a _fun resolved on its own captures nothing, the closure keeps the environment it is given
+            closures[i] = code[record.name]->interp(rest);
+
+        } else {
+            return nullptr;
+        }
+    }
+
+    if ( header.env == no_record ) {
+        return Env::empty;
+    }
+    return envs[header.env];
+}
+
+
+/**
+ * \brief Evaluates the bindings of a prelude
+ * @param text - the prelude
+ * @return - the environment of all its bindings, the last one innermost
+ */
+static PTR(Env) evaluate(std::string_view text) {
+    PTR(Expr) e = parse_str(text);
+    Optimizer optimizer;
+    PTR(Env) env = Env::empty;
+    while ( e->kind == expr_let ) {
+        LetExpr *let = static_cast<LetExpr *>(&*e);
+        env = NEW (ExtendedEnv)(let->value, optimizer.optimize(let->rhs)->interp(env), env);
+        e = let->body;
+    }
+    return env;
+}
+
+
+/**
+ * \brief Constructor, loads the snapshot of the prelude or evaluates it
+ * @param text - the prelude
+ * @param snapshot_path - the snapshot file, none when empty
+ */
+Prelude::Prelude(std::string_view text, const std::string &snapshot_path) {
+    uint64_t hash = source_hash(text);
+    this->text_hash = hash;
+    this->text_size = text.size();
+    this->from_file = false;
+
+    //the code is kept for restore(), in the arena of the prelude
+    ArenaScope code_scope(code_arena, false);
+
+    if ( !snapshot_path.empty()) {
+        try {
+            MappedFile file(snapshot_path);
+            if ( decode_code(file.view(), hash, text.size(), names, code)) {
+                ArenaScope scope;
+                this->from_file = decode_env(file.view(), names, code) != nullptr;
+            }
+            if ( from_file ) {
+                this->snapshot = std::string(file.view());
+            }
+        } catch ( const std::runtime_error & ) {
+            //no snapshot yet
+        }
+    }
+
+    if ( !from_file ) {
+        {
+            //only needed until the snapshot is made
+            ArenaScope scope;
+            PreludeWriter writer;
+            this->snapshot = writer.write(evaluate(text), hash, text.size());
+        }
+        if ( !snapshot_path.empty()) {
+            write_whole_file(snapshot_path, snapshot);
+        }
+        decode_code(snapshot, hash, text.size(), names, code);
+    }
+}
+
+
+/**
+ * \brief Makes the environment of the prelude, for interp() to start programs in
+ *
+ * Only the environments and closures are made, the code they run is shared by every call. With the JIT on, the
+ * call builds its own copy of the code as well, since the JIT keeps call counts in it.
+ *
+ * Everything it allocates belongs to the calling thread, in the current arena when there is one. In the gc pointer
+ * mode the caller keeps the environment alive with a GcRoot.
+ * @return - the environment, free variables of a program are looked up in it by name
+ */
+PTR(Env) Prelude::restore() const {
+    PTR(Env) env;
+    if ( jit_enabled()) {
+        std::vector<symbol_t> own_names;
+        std::vector<PTR(Expr)> own_code;
+        decode_code(snapshot, text_hash, text_size, own_names, own_code);
+        env = decode_env(snapshot, own_names, own_code);
+    } else {
+        env = decode_env(snapshot, names, code);
+    }
+    if ( env == nullptr ) {
+        throw std::runtime_error("damaged prelude snapshot");
+    }
+    return env;
+}
+
+
+/**
+ * \brief Whether the snapshot was loaded from the snapshot file
+ * @return - false when the prelude was evaluated
+ */
+bool Prelude::loaded() const {
+    return from_file;
+}
+
+
+/**
+ * \brief Size of the snapshot
+ * @return - its length in bytes, the same as the snapshot file's
+ */
+size_t Prelude::size() const {
+    return snapshot.size();
+}
@@ -0,0 +1,63 @@
+#ifndef MSDSCRIPT_PRELUDE_H
+#define MSDSCRIPT_PRELUDE_H
+
+/**
+ * \file Prelude.h
+ * \brief a library of _let bound definitions, evaluated once and restored as the environment programs start in
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "pointer.h"
+#include "Arena.h"
+#include "Symbol.h"
+
+class Env;
+
+class Expr;
+
+static const uint32_t prelude_format_version = 2; ///< changes whenever the layout of a snapshot changes
+
+
+/**
+ * \brief The environment a chain of _let bindings evaluates to, kept as a snapshot that is cheap to restore
+ *
+ * A prelude is written the way it would be put in front of a program, _let f = ... _in _let g = ... _in, followed
+ * by any expression, which is ignored. The right hand side of every binding is optimized and evaluated in the
+ * environment of the bindings before it, without resolving, so every closure keeps its free variables by name.
+ *
+ * The snapshot holds the environments and closures that evaluation made, with the _fun of every closure as encoded
+ * nodes, see AstCache.h. The constructor builds the code of the closures once, resolving each _fun on its own, so a
+ * closure reads its argument and its _lets from slots and the names of the prelude by name. restore() then only
+ * remakes the environments and closures, without lexing, parsing or evaluating anything.
+ *
+ * When a snapshot file is given, a snapshot of the same prelude text is loaded from it, and otherwise the prelude is
+ * evaluated and the file written, under a temporary name that is renamed like the files of an AstCache.
+ *
+ * The snapshot and the code built from it never change after the constructor, so threads can share a Prelude. The
+ * environment restore() makes belongs to the calling thread, like everything else it allocates.
+ */
+class Prelude {
+public:
+    explicit Prelude(std::string_view text, const std::string &snapshot_path = "");
+
+    PTR(Env) restore() const;
+
+    bool loaded() const;
+
+    size_t size() const;
+
+private:
+    std::string snapshot; ///< the encoded environment
+    uint64_t text_hash; ///< source_hash of the prelude text
+    size_t text_size; ///< length of the prelude text
+    bool from_file; ///< whether the snapshot came from the snapshot file
+    Arena code_arena; ///< holds the code in the arena and gc pointer modes
+    std::vector<symbol_t> names; ///< the names of the snapshot, by their index
+    std::vector<PTR(Expr)> code; ///< the resolved _fun of every node a closure runs, nullptr for the other nodes
+};
+
+
+#endif //MSDSCRIPT_PRELUDE_H
@@ -0,0 +1,148 @@
+#include "Resolver.h"
+#include "Expr.h"
+#include <stdexcept>
+
+/**
+ * \file Resolver.cpp
+ * \brief contains the implementation of the lexical addressing pass
+ */
+
+
+/**
+ * \brief Resolves a whole program
+ * @param e - the program
+ * @return - an annotated copy of the program
+ */
+PTR(Expr) Resolver::resolve(PTR(Expr) e) {
+    frames.clear();
+    return resolve_expr(e);
+}
+
+
+/**
+ * \brief Copies an expression, annotating variables, _let slots and function frame sizes on the way
+ * @param e - the expression to resolve
+ * @return - the annotated copy
+ */
+PTR(Expr) Resolver::resolve_expr(PTR(Expr) e) {
+
+    if ( PTR(NumExpr) num = CAST (NumExpr)(e)) {
+        return NEW (NumExpr)(num->val);
+
+    } else if ( PTR(BoolExpr) boolean = CAST (BoolExpr)(e)) {
+        return NEW (BoolExpr)(boolean->boolean);
+
+    } else if ( PTR(AddExpr) add = CAST (AddExpr)(e)) {
+        PTR(Expr) lhs = resolve_expr(add->lhs);
+        return NEW (AddExpr)(lhs, resolve_expr(add->rhs));
+
+    } else if ( PTR(MultExpr) mult = CAST (MultExpr)(e)) {
+        PTR(Expr) lhs = resolve_expr(mult->lhs);
+        return NEW (MultExpr)(lhs, resolve_expr(mult->rhs));
+
+    } else if ( PTR(EqExpr) eq = CAST (EqExpr)(e)) {
+        PTR(Expr) lhs = resolve_expr(eq->lhs);
+        return NEW (EqExpr)(lhs, resolve_expr(eq->rhs));
+
+    } else if ( PTR(VarExpr) var = CAST (VarExpr)(e)) {
+        PTR(VarExpr) resolved = NEW (VarExpr)(var->value);
+
+        EnvAddress found;
+        if ( address(var->value, frames.size(), found)) {
+            resolved->depth = found.depth;
+            resolved->slot = found.slot;
+        }
+        return resolved;
+
+    } else if ( PTR(LetExpr) let = CAST (LetExpr)(e)) {
+        PTR(Expr) rhs = resolve_expr(let->rhs);
+        PTR(Expr) body;
+        int slot = -1;
+
+        if ( !frames.empty() && frames.back().is_function ) {
+            Frame &frame = frames.back();
+            slot = frame.size++;
+            frame.bindings.push_back({let->value, slot});
+            body = resolve_expr(let->body);
+            frames.back().bindings.pop_back();
+        } else {
+            frames.push_back({false, {{let->value, 0}}, 1});
+            body = resolve_expr(let->body);
+            frames.pop_back();
+        }
+
+        PTR(LetExpr) resolved = NEW (LetExpr)(let->value, rhs, body);
+        resolved->slot = slot;
+        return resolved;
+
+    } else if ( PTR(IfExpr) ifExpr = CAST (IfExpr)(e)) {
+        PTR(Expr) condition = resolve_expr(ifExpr->ifExpr);
+        PTR(Expr) thenExpr = resolve_expr(ifExpr->thenExpr);
+        return NEW (IfExpr)(condition, thenExpr, resolve_expr(ifExpr->elseExpr));
+
+    } else if ( PTR(FunExpr) fun = CAST (FunExpr)(e)) {
+        //inside a function only its FrameEnv is in the way, at the top level one ExtendedEnv per _let
+        int outer_depth = !frames.empty() && frames.back().is_function ? 1 : (int) frames.size();
+
+        frames.push_back({true, {{fun->formal_arg, 0}}, 1});
+        PTR(FunExpr) resolved = NEW (FunExpr)(fun->formal_arg, resolve_expr(fun->body));
+        resolved->source = fun->source;
+        resolved->frame_size = frames.back().size;
+        resolved->captures = std::move(frames.back().captures);
+        resolved->outer_depth = outer_depth;
+        frames.pop_back();
+        return resolved;
+
+    } else if ( PTR(CallExpr) call = CAST (CallExpr)(e)) {
+        PTR(Expr) to_be_called = resolve_expr(call->to_be_called);
+        return NEW (CallExpr)(to_be_called, resolve_expr(call->actual_arg));
+
+    } else {
+        throw std::runtime_error("cannot resolve expression: " + e->to_string());
+    }
+}
+
+
+/**
+ * \brief Finds where a variable is, capturing it into every function it has to be passed through
+ * @param name - the variable
+ * @param visible - how many frames, from the outermost, are in scope where the variable is read
+ * @param found - set to the depth and slot of the variable
+ * @return - false when the variable is free
+ */
+bool Resolver::address(symbol_t name, size_t visible, EnvAddress &found) {
+    int depth = 0;
+
+    for ( size_t i = visible; i > 0; i-- ) {
+        Frame &frame = frames[i - 1];
+
+        for ( size_t j = frame.bindings.size(); j > 0; j-- ) {
+            if ( frame.bindings[j - 1].name == name ) {
+                found = {depth, frame.bindings[j - 1].slot};
+                return true;
+            }
+        }
+
+        if ( frame.is_function ) {
+            //the body cannot see past its ClosureEnv, so the variable has to be one of the captures
+            for ( size_t k = 0; k < frame.captured.size(); k++ ) {
+                if ( frame.captured[k] == name ) {
+                    found = {depth + 1, (int) k};
+                    return true;
+                }
+            }
+
+            EnvAddress source;
+            if ( !address(name, i - 1, source)) {
+                return false;
+            }
+            frame.captured.push_back(name);
+            frame.captures.push_back(source);
+            found = {depth + 1, (int) frame.captures.size() - 1};
+            return true;
+        }
+
+        depth++;
+    }
+    return false;
+}
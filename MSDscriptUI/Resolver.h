@@ -0,0 +1,62 @@
+#ifndef MSDSCRIPT_RESOLVER_H
+#define MSDSCRIPT_RESOLVER_H
+
+/**
+ * \file Resolver.h
+ * \brief lexical addressing pass
+ *
+ * Annotates every bound VarExpr with the (depth, slot) of its binding so interp() and the VM can read variables
+ * from indexed frames instead of comparing names
+ */
+
+#include <string>
+#include <vector>
+#include "pointer.h"
+#include "Symbol.h"
+#include "Env.h"
+
+class Expr;
+
+/**
+ * \brief Computes the lexical address of every variable in an expression
+ *
+ * Each call to a resolved function gets one FrameEnv, slot 0 holds the formal argument and every _let in the
+ * body (but not in nested functions) gets the next slot. A _let outside of any function still extends the
+ * environment with an ExtendedEnv, which counts as a frame with a single slot. Free variables are left
+ * unannotated and are looked up by name.
+ *
+ * A variable a function uses from outside its own frame is captured. The closure copies it into a ClosureEnv when
+ * the _fun is evaluated, and the body reads it at depth 1, slot the index in the function's capture list. The
+ * capture list records where the variable is in the environment the _fun is evaluated in, which may be a capture
+ * of the enclosing function in turn.
+ *
+ * The resolver returns a fresh tree, so subtrees shared between expressions are never annotated twice.
+ * Annotations are lost by subst, so resolve last, right before evaluating.
+ */
+class Resolver {
+public:
+    PTR(Expr) resolve(PTR(Expr) e);
+
+private:
+    struct Binding {
+        symbol_t name;
+        int slot;
+    };
+
+    struct Frame {
+        bool is_function = false; ///< a call frame, false for the single binding of a top level _let
+        std::vector<Binding> bindings = {}; ///< the bindings in scope, innermost last
+        int size = 0; ///< number of slots handed out so far
+        std::vector<symbol_t> captured = {}; ///< names of the variables a call frame's function captures
+        std::vector<EnvAddress> captures = {}; ///< where they are when the _fun is evaluated, in the same order
+    };
+
+    std::vector<Frame> frames; ///< frames visible at the current point, innermost last
+
+    PTR(Expr) resolve_expr(PTR(Expr) e);
+
+    bool address(symbol_t name, size_t visible, EnvAddress &found);
+};
+
+
+#endif //MSDSCRIPT_RESOLVER_H
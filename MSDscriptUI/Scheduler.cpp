@@ -0,0 +1,220 @@
+#include "Scheduler.h"
+#include <algorithm>
+#include <stdexcept>
+#include "Expr.h"
+#include "Val.h"
+#include "Env.h"
+#include "Cancel.h"
+
+/**
+ * \file Scheduler.cpp
+ * \brief contains the implementation of the round robin scheduler
+ */
+
+
+/**
+ * \brief Constructor for a scheduler without tasks
+ * @param quantum - steps a task makes per turn, at least 1
+ */
+Scheduler::Scheduler(size_t quantum) {
+    this->quantum = quantum == 0 ? 1 : quantum;
+    this->live = 0;
+}
+
+
+/**
+ * \brief Adds an evaluation at the back of the queue, nothing of it runs until its first turn
+ * @param e - the expression, resolved or not
+ * @param env - the environment free variables are looked up in
+ * @param max_steps - steps after which the task is cancelled, 0 for no limit
+ * @return - the id of the task
+ */
+size_t Scheduler::spawn(PTR(Expr) e, PTR(Env) env, size_t max_steps) {
+    Task task;
+    task.machine.reset(new CEKMachine());
+    task.machine->start(e, env);
+    task.status = task_ready;
+    task.max_steps = max_steps;
+    task.steps = 0;
+    task.result = nullptr;
+
+    tasks.push_back(std::move(task));
+    ready.push_back(tasks.size() - 1);
+    live++;
+    return tasks.size() - 1;
+}
+
+
+/**
+ * \brief Gives the next ready task one turn
+ *
+ * An error ends the task that raised it. When the evaluation is cancelled through a CancelScope of this thread, the
+ * running task is cancelled and EvalCancelled is passed on, the other tasks can still be run later.
+ * @return - false when there was no task left to run
+ */
+bool Scheduler::step() {
+    while ( !ready.empty() && tasks[ready.front()].status != task_ready ) {
+        ready.pop_front();
+    }
+    if ( ready.empty()) {
+        return false;
+    }
+
+    size_t id = ready.front();
+    ready.pop_front();
+    Task &task = tasks[id];
+
+    size_t fuel = quantum;
+    if ( task.max_steps > 0 ) {
+        fuel = std::min(fuel, task.max_steps - task.steps);
+    }
+
+    bool done;
+    try {
+        size_t before = task.machine->steps();
+        done = task.machine->run(fuel);
+        task.steps += task.machine->steps() - before;
+    } catch ( const EvalCancelled & ) {
+        task.error = "evaluation cancelled";
+        end(task, task_cancelled);
+        throw;
+    } catch ( const std::runtime_error &error ) {
+        task.error = error.what();
+        end(task, task_failed);
+        return true;
+    }
+
+    if ( done ) {
+        task.result = task.machine->result();
+        end(task, task_finished);
+    } else if ( task.max_steps > 0 && task.steps >= task.max_steps ) {
+        task.error = "step limit reached";
+        end(task, task_cancelled);
+    } else {
+        ready.push_back(id);
+    }
+    return true;
+}
+
+
+/**
+ * \brief Takes turns until every task finished, failed or was cancelled
+ */
+void Scheduler::run() {
+    while ( step()) {
+    }
+}
+
+
+/**
+ * \brief Stops a task for good, does nothing when it is already over
+ * @param id - the task
+ */
+void Scheduler::cancel(size_t id) {
+    if ( id >= tasks.size()) {
+        throw std::runtime_error("no such task");
+    }
+    Task &task = tasks[id];
+    if ( task.status == task_ready ) {
+        task.error = "evaluation cancelled";
+        end(task, task_cancelled);
+    }
+}
+
+
+/**
+ * \brief Drops every task, their ids start over from 0
+ */
+void Scheduler::clear() {
+    tasks.clear();
+    ready.clear();
+    live = 0;
+}
+
+
+/**
+ * \brief Number of tasks that still want turns
+ * @return - the tasks that are ready
+ */
+size_t Scheduler::pending() const {
+    return live;
+}
+
+
+/**
+ * \brief Where a task is
+ * @param id - the task
+ * @return - its status
+ */
+task_status_t Scheduler::status(size_t id) const {
+    if ( id >= tasks.size()) {
+        throw std::runtime_error("no such task");
+    }
+    return tasks[id].status;
+}
+
+
+/**
+ * \brief The value of a task
+ * @param id - the task
+ * @return - the value once it finished, nullptr otherwise
+ */
+PTR(Val) Scheduler::result(size_t id) const {
+    if ( id >= tasks.size()) {
+        throw std::runtime_error("no such task");
+    }
+    return tasks[id].result;
+}
+
+
+/**
+ * \brief Why a task did not finish
+ * @param id - the task
+ * @return - the error message when it failed or was cancelled, empty otherwise
+ */
+const std::string &Scheduler::error(size_t id) const {
+    if ( id >= tasks.size()) {
+        throw std::runtime_error("no such task");
+    }
+    return tasks[id].error;
+}
+
+
+/**
+ * \brief Steps a task made
+ * @param id - the task
+ * @return - the steps of all its turns so far
+ */
+size_t Scheduler::steps(size_t id) const {
+    if ( id >= tasks.size()) {
+        throw std::runtime_error("no such task");
+    }
+    return tasks[id].steps;
+}
+
+
+#if USE_GC_POINTERS
+
+/**
+ * \brief Marks the results of the finished tasks
+ * @param heap - the heap being collected
+ */
+void Scheduler::trace_roots(GcHeap &heap) {
+    for ( const Task &task : tasks ) {
+        heap.mark(task.result);
+    }
+}
+
+#endif
+
+
+/**
+ * \brief Marks a ready task as over and drops its machine, with the continuations and environments it held
+ * @param task - the task
+ * @param status - what became of it
+ */
+void Scheduler::end(Task &task, task_status_t status) {
+    task.status = status;
+    task.machine.reset();
+    live--;
+}
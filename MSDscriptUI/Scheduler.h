@@ -0,0 +1,103 @@
+#ifndef MSDSCRIPT_SCHEDULER_H
+#define MSDSCRIPT_SCHEDULER_H
+
+/**
+ * \file Scheduler.h
+ * \brief many evaluations sharing one thread
+ *
+ * Every evaluation runs on a CEK machine of its own, so it can be stopped after a number of steps and resumed later.
+ * The scheduler takes turns between them, which keeps one program that runs for a long time, or forever, from
+ * holding up the others.
+ */
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "pointer.h"
+#include "CEK.h"
+
+class Expr;
+
+class Val;
+
+class Env;
+
+/**
+ * \brief Where a scheduled evaluation is
+ */
+typedef enum {
+    task_ready = 0, ///< waiting for its next turn
+    task_finished,  ///< has a value
+    task_failed,    ///< raised an error
+    task_cancelled  ///< was stopped by cancel() or ran out of steps
+} task_status_t;
+
+
+/**
+ * \brief Runs evaluations round robin on the current thread, a quantum of steps each
+ *
+ * spawn() adds an evaluation and returns its id, which stays valid until clear(). Each turn resumes the evaluation
+ * at the front of the queue for quantum steps of its machine and puts it at the back if it did not finish. A task
+ * can also be given a step limit, after which it is cancelled as a runaway.
+ *
+ * Values and environments are made in the current arena, so in the arena pointer mode every task has to be run
+ * and its result used within the ArenaScope it was spawned in. In the gc pointer mode the scheduler is a root set
+ * that keeps the results alive, the machines of the tasks are root sets of their own.
+ */
+#if USE_GC_POINTERS
+class Scheduler : public GcRoots {
+#else
+class Scheduler {
+#endif
+public:
+    explicit Scheduler(size_t quantum = 1000);
+
+    size_t spawn(PTR(Expr) e, PTR(Env) env = nullptr, size_t max_steps = 0);
+
+    bool step();
+
+    void run();
+
+    void cancel(size_t id);
+
+    void clear();
+
+    size_t pending() const;
+
+    task_status_t status(size_t id) const;
+
+    PTR(Val) result(size_t id) const;
+
+    const std::string &error(size_t id) const;
+
+    size_t steps(size_t id) const;
+
+#if USE_GC_POINTERS
+    void trace_roots(GcHeap &heap);
+#endif
+
+private:
+    /**
+     * \brief One evaluation and what became of it
+     */
+    struct Task {
+        std::unique_ptr<CEKMachine> machine; ///< the suspended evaluation, dropped once it is over
+        task_status_t status;
+        size_t max_steps; ///< steps before the task is cancelled, 0 for no limit
+        size_t steps; ///< steps it made in all its turns
+        PTR(Val) result; ///< the value when finished
+        std::string error; ///< the message when failed or cancelled
+    };
+
+    size_t quantum; ///< steps per turn
+    std::vector<Task> tasks; ///< every task by id
+    std::deque<size_t> ready; ///< ids of the tasks to take turns, cancelled ones are skipped when they come up
+    size_t live; ///< tasks still ready
+
+    void end(Task &task, task_status_t status);
+};
+
+
+#endif //MSDSCRIPT_SCHEDULER_H
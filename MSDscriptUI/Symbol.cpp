@@ -0,0 +1,65 @@
+#include "Symbol.h"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * \file Symbol.cpp
+ * \brief contains the global identifier table
+ *
+ * The table only grows. Names live in a deque, so references returned by symbol_name stay valid while other
+ * threads intern new names.
+ */
+
+
+/**
+ * \brief The names and their ids
+ */
+struct SymbolTable {
+    std::mutex lock;
+    std::unordered_map<std::string, symbol_t> ids;
+    std::deque<std::string> names;
+};
+
+
+/**
+ * \brief The one table shared by the whole process
+ * @return - the table
+ */
+static SymbolTable &symbol_table() {
+    static SymbolTable *table = new SymbolTable();
+    return *table;
+}
+
+
+/**
+ * \brief Returns the id of a name, adding the name to the table the first time it is seen
+ * @param name - the identifier
+ * @return - the symbol id, equal names always get the same id
+ */
+symbol_t intern(const std::string &name) {
+    SymbolTable &table = symbol_table();
+    std::lock_guard<std::mutex> guard(table.lock);
+
+    auto found = table.ids.find(name);
+    if ( found != table.ids.end()) {
+        return found->second;
+    }
+
+    symbol_t symbol = (symbol_t) table.names.size();
+    table.names.push_back(name);
+    table.ids.emplace(name, symbol);
+    return symbol;
+}
+
+
+/**
+ * \brief Returns the name of a symbol, for printing and error messages
+ * @param symbol - an id returned by intern
+ * @return - the identifier
+ */
+const std::string &symbol_name(symbol_t symbol) {
+    SymbolTable &table = symbol_table();
+    std::lock_guard<std::mutex> guard(table.lock);
+    return table.names[symbol];
+}
@@ -0,0 +1,22 @@
+#ifndef MSDSCRIPT_SYMBOL_H
+#define MSDSCRIPT_SYMBOL_H
+
+/**
+ * \file Symbol.h
+ * \brief global identifier table
+ *
+ * Every variable name is interned once by the parser. After that expressions, values and environments pass
+ * and compare 32-bit symbol ids instead of strings.
+ */
+
+#include <cstdint>
+#include <string>
+
+typedef uint32_t symbol_t;
+
+symbol_t intern(const std::string &name);
+
+const std::string &symbol_name(symbol_t symbol);
+
+
+#endif //MSDSCRIPT_SYMBOL_H
@@ -0,0 +1,348 @@
+#include "TypeChecker.h"
+#include "Expr.h"
+
+/**
+ * \file TypeChecker.cpp
+ * \brief contains the implementation of the type inference pass
+ */
+
+
+/**
+ * \brief Infers the types of a program, annotating its nodes when it is well typed
+ * @param e - the program, as returned by the Resolver
+ * @return - true when the program is well typed and was annotated
+ */
+bool TypeChecker::check(PTR(Expr) e) {
+    types.clear();
+    scope.clear();
+    node_types.clear();
+    level = 0;
+    walk = 0;
+
+    if ( infer(e) < 0 ) {
+        return false;
+    }
+
+    for ( const std::pair<Expr *, int> &node : node_types ) {
+        switch ( types[find(node.second)].kind ) {
+            case tv_int:
+                node.first->type = type_int;
+                break;
+            case tv_bool:
+                node.first->type = type_bool;
+                break;
+            case tv_fun:
+                node.first->type = type_fun;
+                break;
+            case tv_var:
+                //used at several types, or never used at all
+                break;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * \brief Adds a type to the graph
+ * @param kind - what the type is
+ * @param arg - the argument of a function type
+ * @param result - the result of a function type
+ * @return - the index of the new type
+ */
+int TypeChecker::fresh(type_kind_t kind, int arg, int result) {
+    Type type;
+    type.kind = kind;
+    type.parent = (int) types.size();
+    type.arg = arg;
+    type.result = result;
+    type.level = level;
+    type.mark = 0;
+    types.push_back(type);
+    return type.parent;
+}
+
+
+/**
+ * \brief Finds the type a type was unified with, shortening the path on the way
+ * @param t - a type
+ * @return - the representative of its class
+ */
+int TypeChecker::find(int t) {
+    int root = t;
+    while ( types[root].parent != root ) {
+        root = types[root].parent;
+    }
+    while ( types[t].parent != root ) {
+        int next = types[t].parent;
+        types[t].parent = root;
+        t = next;
+    }
+    return root;
+}
+
+
+/**
+ * \brief Makes two types equal
+ *
+ * A variable is only bound to a type that does not contain it, so the types never become cyclic.
+ * @param a - a type
+ * @param b - another type
+ * @return - false when the types cannot be equal
+ */
+bool TypeChecker::unify(int a, int b) {
+    a = find(a);
+    b = find(b);
+    if ( a == b ) {
+        return true;
+    }
+
+    if ( types[a].kind == tv_var ) {
+        return bind(a, b);
+    }
+    if ( types[b].kind == tv_var ) {
+        return bind(b, a);
+    }
+
+    if ( types[a].kind != types[b].kind ) {
+        return false;
+    }
+    if ( types[a].kind != tv_fun ) {
+        return true;
+    }
+
+    int a_arg = types[a].arg;
+    int a_result = types[a].result;
+    types[a].parent = b;
+    return unify(a_arg, types[b].arg) && unify(a_result, types[b].result);
+}
+
+
+/**
+ * \brief Binds a variable to a type, unless the type contains the variable
+ *
+ * The variables of the type are lowered to the level of the variable, a variable that becomes part of the type of
+ * a variable of an enclosing _let must not be generalized by the inner _let.
+ * @param var - the representative of a tv_var
+ * @param t - the representative of another type
+ * @return - false when the variable occurs in the type, binding it would make a cyclic type
+ */
+bool TypeChecker::bind(int var, int t) {
+    int max_level = types[var].level;
+    walk++;
+    std::vector<int> work = {t};
+
+    while ( !work.empty()) {
+        int next = find(work.back());
+        work.pop_back();
+
+        Type &type = types[next];
+        if ( type.mark == walk ) {
+            continue;
+        }
+        type.mark = walk;
+
+        if ( next == var ) {
+            return false;
+        }
+        if ( type.kind == tv_var && type.level > max_level ) {
+            type.level = max_level;
+        } else if ( type.kind == tv_fun ) {
+            work.push_back(type.arg);
+            work.push_back(type.result);
+        }
+    }
+
+    types[var].parent = t;
+    return true;
+}
+
+
+/**
+ * \brief Marks the variables of a type that were made inside the current _let as generic
+ * @param t - the type of the right hand side of the _let
+ */
+void TypeChecker::generalize(int t) {
+    walk++;
+    std::vector<int> work = {t};
+
+    while ( !work.empty()) {
+        int next = find(work.back());
+        work.pop_back();
+
+        Type &type = types[next];
+        if ( type.mark == walk ) {
+            continue;
+        }
+        type.mark = walk;
+
+        if ( type.kind == tv_var && type.level > level ) {
+            type.level = generic_level;
+        } else if ( type.kind == tv_fun ) {
+            work.push_back(type.arg);
+            work.push_back(type.result);
+        }
+    }
+}
+
+
+/**
+ * \brief Copies a type with fresh variables for its generic ones, for one use of a _let variable
+ * @param t - the type of the variable
+ * @param copies - the copy made of every type already copied, which keeps shared parts shared
+ * @return - the copy
+ */
+int TypeChecker::instantiate(int t, std::unordered_map<int, int> &copies) {
+    t = find(t);
+
+    auto found = copies.find(t);
+    if ( found != copies.end()) {
+        return found->second;
+    }
+
+    type_kind_t kind = types[t].kind;
+    if ( kind == tv_var ) {
+        if ( types[t].level != generic_level ) {
+            return t;
+        }
+        int copy = fresh(tv_var);
+        copies.emplace(t, copy);
+        return copy;
+    }
+    if ( kind != tv_fun ) {
+        return t;
+    }
+
+    //registered before its parts are copied, so a part that leads back here gets the copy
+    int copy = fresh(tv_fun);
+    copies.emplace(t, copy);
+    int arg = instantiate(types[t].arg, copies);
+    int result = instantiate(types[t].result, copies);
+    types[copy].arg = arg;
+    types[copy].result = result;
+    return copy;
+}
+
+
+/**
+ * \brief Infers the type of an expression and records it for the node
+ * @param e - the expression
+ * @return - the type, -1 when the expression is not well typed
+ */
+int TypeChecker::infer(PTR(Expr) e) {
+    int result = -1;
+
+    switch ( e->kind ) {
+
+        case expr_num:
+            result = fresh(tv_int);
+            break;
+
+        case expr_bool:
+            result = fresh(tv_bool);
+            break;
+
+        case expr_add:
+        case expr_mult: {
+            PTR(Expr) lhs = e->kind == expr_add ? static_cast<AddExpr *>(&*e)->lhs : static_cast<MultExpr *>(&*e)->lhs;
+            PTR(Expr) rhs = e->kind == expr_add ? static_cast<AddExpr *>(&*e)->rhs : static_cast<MultExpr *>(&*e)->rhs;
+            int lhs_type = infer(lhs);
+            int rhs_type = lhs_type < 0 ? -1 : infer(rhs);
+            result = fresh(tv_int);
+            if ( rhs_type < 0 || !unify(lhs_type, result) || !unify(rhs_type, result)) {
+                return -1;
+            }
+            break;
+        }
+
+        case expr_eq: {
+            EqExpr *eq = static_cast<EqExpr *>(&*e);
+            int lhs_type = infer(eq->lhs);
+            int rhs_type = lhs_type < 0 ? -1 : infer(eq->rhs);
+            if ( rhs_type < 0 || !unify(lhs_type, rhs_type)) {
+                return -1;
+            }
+            result = fresh(tv_bool);
+            break;
+        }
+
+        case expr_var: {
+            VarExpr *var = static_cast<VarExpr *>(&*e);
+            for ( int i = (int) scope.size() - 1; i >= 0 && result < 0; i-- ) {
+                if ( scope[i].name == var->value ) {
+                    std::unordered_map<int, int> copies;
+                    result = scope[i].generic ? instantiate(scope[i].type, copies) : scope[i].type;
+                }
+            }
+            if ( result < 0 ) {
+                //a free variable, the program raises an error when it gets there
+                return -1;
+            }
+            break;
+        }
+
+        case expr_let: {
+            LetExpr *let = static_cast<LetExpr *>(&*e);
+            level++;
+            int rhs_type = infer(let->rhs);
+            level--;
+            if ( rhs_type < 0 ) {
+                return -1;
+            }
+            generalize(rhs_type);
+
+            scope.push_back({let->value, rhs_type, true});
+            result = infer(let->body);
+            scope.pop_back();
+            if ( result < 0 ) {
+                return -1;
+            }
+            break;
+        }
+
+        case expr_if: {
+            IfExpr *ifExpr = static_cast<IfExpr *>(&*e);
+            int condition = infer(ifExpr->ifExpr);
+            if ( condition < 0 || !unify(condition, fresh(tv_bool))) {
+                return -1;
+            }
+            int then_type = infer(ifExpr->thenExpr);
+            int else_type = then_type < 0 ? -1 : infer(ifExpr->elseExpr);
+            if ( else_type < 0 || !unify(then_type, else_type)) {
+                return -1;
+            }
+            result = then_type;
+            break;
+        }
+
+        case expr_fun: {
+            FunExpr *fun = static_cast<FunExpr *>(&*e);
+            int arg = fresh(tv_var);
+            scope.push_back({fun->formal_arg, arg, false});
+            int body = infer(fun->body);
+            scope.pop_back();
+            if ( body < 0 ) {
+                return -1;
+            }
+            result = fresh(tv_fun, arg, body);
+            break;
+        }
+
+        case expr_call: {
+            CallExpr *call = static_cast<CallExpr *>(&*e);
+            int to_be_called = infer(call->to_be_called);
+            int actual_arg = to_be_called < 0 ? -1 : infer(call->actual_arg);
+            if ( actual_arg < 0 ) {
+                return -1;
+            }
+            result = fresh(tv_var);
+            if ( !unify(to_be_called, fresh(tv_fun, actual_arg, result))) {
+                return -1;
+            }
+            break;
+        }
+    }
+
+    node_types.emplace_back(&*e, result);
+    return result;
+}
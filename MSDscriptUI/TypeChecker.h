@@ -0,0 +1,95 @@
+#ifndef MSDSCRIPT_TYPECHECKER_H
+#define MSDSCRIPT_TYPECHECKER_H
+
+/**
+ * \file TypeChecker.h
+ * \brief type inference pass
+ *
+ * Infers Hindley-Milner types for a resolved program and marks every node whose values are known to be integers,
+ * booleans or functions, so interp() can use them without checking
+ */
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "pointer.h"
+#include "Symbol.h"
+
+class Expr;
+
+/**
+ * \brief Infers the types of a program and annotates its nodes with them
+ *
+ * Types are int, bool, functions and type variables. A _let is generalized, so a function bound by a _let can be
+ * used at several types. == wants both sides to have the same type. A variable is never bound to a type that
+ * contains it, so a function applied to itself, such as f in f(f), has no type. Programs that recurse that way are
+ * left unannotated.
+ *
+ * Nodes are only annotated when the whole program is well typed, and only with types that are known, a node whose
+ * type is a variable of a polymorphic function keeps type_unknown. A well typed program cannot raise a type error,
+ * so every annotated check can be left out. A program that is not well typed is left as it is and runs with all
+ * its checks, free variables make a program not well typed.
+ *
+ * The nodes are changed in place, so the pass runs on the tree the Resolver returned, which nothing else shares.
+ */
+class TypeChecker {
+public:
+    bool check(PTR(Expr) e);
+
+private:
+    /**
+     * \brief What a type is
+     */
+    typedef enum {
+        tv_var = 0, ///< not known yet, or generic
+        tv_int,
+        tv_bool,
+        tv_fun
+    } type_kind_t;
+
+    /**
+     * \brief One node of the type graph, types refer to each other by index
+     */
+    struct Type {
+        type_kind_t kind;
+        int parent; ///< the type this one was unified with, itself for a representative
+        int arg; ///< argument of a tv_fun
+        int result; ///< result of a tv_fun
+        int level; ///< _let nesting where a tv_var was made, generic_level once generalized
+        unsigned mark; ///< the last walk that visited the type, walks of shared types stop there
+    };
+
+    /**
+     * \brief A variable in scope
+     */
+    struct Binding {
+        symbol_t name;
+        int type;
+        bool generic; ///< bound by a _let, instantiated at every use
+    };
+
+    static const int generic_level = 1 << 30; ///< level of the generalized variables of a _let
+
+    std::vector<Type> types; ///< the type graph
+    std::vector<Binding> scope; ///< the variables in scope, innermost last
+    std::vector<std::pair<Expr *, int>> node_types; ///< the type of every node, read once the program checked
+    int level; ///< _let nesting at the current point
+    unsigned walk; ///< number of the current walk
+
+    int fresh(type_kind_t kind, int arg = -1, int result = -1);
+
+    int find(int t);
+
+    bool unify(int a, int b);
+
+    bool bind(int var, int t);
+
+    void generalize(int t);
+
+    int instantiate(int t, std::unordered_map<int, int> &copies);
+
+    int infer(PTR(Expr) e);
+};
+
+
+#endif //MSDSCRIPT_TYPECHECKER_H
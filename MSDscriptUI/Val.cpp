@@ -5,6 +5,8 @@
 #include "Val.h"
 #include "Expr.h"
 #include "Env.h"
+#include "Jit.h"
+#include "Cancel.h"
 #include <memory>
 
 /**
@@ -195,10 +197,12 @@ bool BoolVal::is_true() {
  * \param
  * \return a FunVal object with the formal argument and body inside
  */
-FunVal::FunVal(std::string formal_arg, PTR(Expr) body, PTR(Env) env) {
+FunVal::FunVal(symbol_t formal_arg, PTR(Expr) body, PTR(Env) env) {
     this->formal_arg = formal_arg;
     this->body = body;
+    this->source = body;
     this->env = env;
+    this->frame_size = -1;
 }
 
 
@@ -213,7 +217,7 @@ bool FunVal::equals(PTR(Val) e) {
         return false;
     }
 
-    return this->formal_arg == funVal->formal_arg && this->body->equals(funVal->body);
+    return this->formal_arg == funVal->formal_arg && this->source->equals(funVal->source);
 
 }
 
@@ -226,9 +230,9 @@ void FunVal::print(std::ostream &ot) {
     ot << "(";
     ot << "_fun ";
     ot << "(";
-    ot << this->formal_arg;
+    ot << symbol_name(this->formal_arg);
     ot << ") ";
-    this->body->print(ot);
+    this->source->print(ot);
     ot << ")";
 
 }
@@ -260,7 +264,26 @@ PTR(Val) FunVal::mult_with(PTR(Val) other_function) {
  * @return a Val object
  */
 PTR(Val) FunVal::call(PTR(Val) actual_arg) {
-    return this->body->interp(NEW(ExtendedEnv)(this->formal_arg, actual_arg, this->env));
+    return call_value(Value::from_val(actual_arg)).to_val();
+}
+
+
+/**
+ * \brief Calls the function with a tagged argument, so numbers and booleans are never boxed on the way
+ * @param actual_arg - the argument
+ * @return - the value of the body
+ */
+Value FunVal::call_value(const Value &actual_arg) {
+    check_cancelled();
+
+    Value result;
+    if ( this->jit != nullptr && this->jit->call(this, actual_arg, result)) {
+        return result;
+    }
+    if ( this->frame_size >= 0 ) {
+        return this->body->interp_value(NEW(FrameEnv)(this->frame_size, actual_arg, this->env));
+    }
+    return this->body->interp_value(NEW(ExtendedEnv)(this->formal_arg, actual_arg, this->env));
 }
 
 
@@ -269,7 +292,9 @@ PTR(Val) FunVal::call(PTR(Val) actual_arg) {
  * @return expression object with the appropriate fields
  */
 PTR(Expr) FunVal::to_expr() {
-    return NEW (FunExpr)(this->formal_arg, this->body);
+    PTR(FunExpr) fun = NEW (FunExpr)(this->formal_arg, this->body);
+    fun->source = this->source;
+    return fun;
 }
 
 
@@ -281,3 +306,15 @@ bool FunVal::is_true() {
     throw std::runtime_error("FunVal is not of type boolean");
 }
 
+
+#if USE_GC_POINTERS
+
+/**
+ * \brief Marks the environment the function was made in, the body is not collected
+ * @param heap - the heap being collected
+ */
+void FunVal::trace(GcHeap &heap) {
+    heap.mark(this->env);
+}
+
+#endif
@@ -9,6 +9,8 @@
 #include <stdexcept>
 #include <sstream>
 #include "pointer.h"
+#include "Symbol.h"
+#include "Value.h"
 #include <memory>
 
 /**
@@ -22,10 +24,14 @@ class Expr;
 
 class Env;
 
+struct FunctionProto;
+
+class JitFunction;
+
 /**
  * \brief Value class that has many methods to alter, compare, and print the contents of the value object
  */
-CLASS (Val) {
+GC_CLASS (Val) {
 public:
     virtual bool equals(PTR(Val) e) = 0;
 
@@ -108,13 +114,21 @@ public:
  */
 class FunVal : public Val {
 public:
-    std::string formal_arg;
+    symbol_t formal_arg; ///< the interned name of the argument
 
     PTR(Expr) body;
 
+    PTR(Expr) source; ///< the body as the program wrote it, which is printed and compared, see FunExpr::source
+
     PTR(Env) env;
 
-    FunVal(std::string formal_arg, PTR(Expr) body, PTR(Env) env = nullptr);
+    std::shared_ptr<FunctionProto> code; ///< bytecode for the body when the value was made by the VM
+
+    int frame_size; ///< slots a call needs when the body was resolved, -1 otherwise
+
+    std::shared_ptr<JitFunction> jit; ///< call count and native code of the _fun this was made from, when the JIT is on
+
+    FunVal(symbol_t formal_arg, PTR(Expr) body, PTR(Env) env = nullptr);
 
     bool equals(PTR(Val) e);
 
@@ -126,10 +140,16 @@ public:
 
     PTR(Val) call(PTR(Val) actual_arg);
 
+    Value call_value(const Value &actual_arg);
+
     PTR (Expr) to_expr();
 
     bool is_true();
 
+#if USE_GC_POINTERS
+    void trace(GcHeap &heap);
+#endif
+
 };
 
 
@@ -0,0 +1,145 @@
+#include "Value.h"
+#include "Val.h"
+#include <stdexcept>
+
+/**
+ * \file Value.cpp
+ * \brief contains the operations on tagged values
+ *
+ * Immediate operands take the fast paths. Anything involving a heap Val is handed to the Val methods, so the
+ * results and error messages always match interp()
+ */
+
+
+/**
+ * \brief Wraps a heap value, the Val is kept as it is
+ * @param val - the value to wrap
+ * @return - a tag_object Value
+ */
+Value Value::from_val(PTR(Val) val) {
+    Value v;
+    v.tag = tag_object;
+    v.object = val;
+    return v;
+}
+
+
+/**
+ * \brief Converts the value into a Val, allocating a NumVal or BoolVal for immediates
+ * @return - the equivalent Val object
+ */
+PTR(Val) Value::to_val() const {
+    switch ( tag ) {
+        case tag_int:
+            return NEW (NumVal)(num);
+        case tag_bool:
+            return NEW (BoolVal)(boolean);
+        default:
+            return object;
+    }
+}
+
+
+/**
+ * \brief The integer of a tag_object Value that holds a NumVal, for as_int
+ * @return - the integer
+ */
+int Value::boxed_int() const {
+    return static_cast<NumVal *>(&*object)->val;
+}
+
+
+/**
+ * \brief The boolean of a tag_object Value that holds a BoolVal, for as_bool
+ * @return - the boolean
+ */
+bool Value::boxed_bool() const {
+    return static_cast<BoolVal *>(&*object)->boolean;
+}
+
+
+/**
+ * \brief Checks the value of a condition
+ * @return - the boolean, throws the same error as IfExpr::interp when the value is not a boolean
+ */
+bool Value::is_true() const {
+    if ( tag == tag_bool ) {
+        return boolean;
+    }
+
+    if ( tag == tag_object ) {
+        PTR(BoolVal) condition = CAST (BoolVal)(object);
+        if ( condition != nullptr ) {
+            return condition->boolean;
+        }
+    }
+
+    throw std::runtime_error("if statement doesn't evaluate to a boolean, must evaluate to a boolean");
+}
+
+
+/**
+ * \brief Compares two values the same way Val::equals does
+ * @param other - the value to compare against
+ * @return - true when both values are equal
+ */
+bool Value::equals(const Value &other) const {
+    if ( tag == tag_int && other.tag == tag_int ) {
+        return num == other.num;
+    }
+    if ( tag == tag_bool && other.tag == tag_bool ) {
+        return boolean == other.boolean;
+    }
+    if ( tag != tag_object && other.tag != tag_object ) {
+        return false;
+    }
+    return to_val()->equals(other.to_val());
+}
+
+
+/**
+ * \brief Prints the value the same way Val::to_string does
+ * @return - the printed value
+ */
+std::string Value::to_string() const {
+    switch ( tag ) {
+        case tag_int:
+            return std::to_string(num);
+        case tag_bool:
+            return boolean ? "_true" : "_false";
+        default:
+            return object->to_string();
+    }
+}
+
+
+/**
+ * \brief Adds two values, integers wrap around like NumVal::add_to
+ * @param lhs - left operand
+ * @param rhs - right operand
+ * @return - the sum
+ */
+Value add_values(const Value &lhs, const Value &rhs) {
+    if ( lhs.tag == tag_int && rhs.tag == tag_int ) {
+        return Value::from_int((int) ((unsigned) lhs.num + (unsigned) rhs.num));
+    }
+
+    PTR(Val) result = lhs.to_val()->add_to(rhs.to_val());
+    return Value::from_int(CAST (NumVal)(result)->val);
+}
+
+
+/**
+ * \brief Multiplies two values, integers wrap around like NumVal::mult_with
+ * @param lhs - left operand
+ * @param rhs - right operand
+ * @return - the product
+ */
+Value mult_values(const Value &lhs, const Value &rhs) {
+    if ( lhs.tag == tag_int && rhs.tag == tag_int ) {
+        return Value::from_int((int) ((unsigned) lhs.num * (unsigned) rhs.num));
+    }
+
+    PTR(Val) result = lhs.to_val()->mult_with(rhs.to_val());
+    return Value::from_int(CAST (NumVal)(result)->val);
+}
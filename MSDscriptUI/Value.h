@@ -0,0 +1,105 @@
+#ifndef MSDSCRIPT_VALUE_H
+#define MSDSCRIPT_VALUE_H
+
+/**
+ * \file Value.h
+ * \brief tagged value representation
+ *
+ * A Value keeps integers and booleans inline, so arithmetic and comparisons never allocate. Only values that
+ * need a heap object, such as FunVal closures, carry a Val pointer.
+ */
+
+#include <string>
+#include "pointer.h"
+
+class Val;
+
+/**
+ * \brief The kinds of value a Value can hold
+ */
+typedef enum {
+    tag_int = 0,  ///< an immediate integer
+    tag_bool = 1, ///< an immediate boolean
+    tag_object = 2 ///< a heap Val, usually a FunVal
+} value_tag_t;
+
+
+/**
+ * \brief A value that is either an immediate integer, an immediate boolean or a pointer to a Val
+ *
+ * A tag_object Value may also hold a NumVal or BoolVal made by interp(). The operations below treat those
+ * exactly like the matching immediates.
+ */
+class Value {
+public:
+    value_tag_t tag;
+
+    union {
+        int num;
+        bool boolean;
+    };
+
+    PTR(Val) object; ///< only set for tag_object
+
+    Value() : tag(tag_int), num(0), object(nullptr) {}
+
+    static Value from_int(int n) {
+        Value v;
+        v.num = n;
+        return v;
+    }
+
+    static Value from_bool(bool b) {
+        Value v;
+        v.tag = tag_bool;
+        v.boolean = b;
+        return v;
+    }
+
+    static Value from_val(PTR(Val) val);
+
+    PTR(Val) to_val() const;
+
+    bool is_int() const {
+        return tag == tag_int;
+    }
+
+    bool is_bool() const {
+        return tag == tag_bool;
+    }
+
+    /**
+     * \brief The integer of a value known to be one, such as an operand the TypeChecker proved is a number
+     * @return - the integer, without checking the kind
+     */
+    int as_int() const {
+        return tag == tag_int ? num : boxed_int();
+    }
+
+    /**
+     * \brief The boolean of a value known to be one, such as a condition the TypeChecker proved is a boolean
+     * @return - the boolean, without checking the kind
+     */
+    bool as_bool() const {
+        return tag == tag_bool ? boolean : boxed_bool();
+    }
+
+    bool is_true() const;
+
+    bool equals(const Value &other) const;
+
+    std::string to_string() const;
+
+private:
+    int boxed_int() const;
+
+    bool boxed_bool() const;
+};
+
+
+Value add_values(const Value &lhs, const Value &rhs);
+
+Value mult_values(const Value &lhs, const Value &rhs);
+
+
+#endif //MSDSCRIPT_VALUE_H
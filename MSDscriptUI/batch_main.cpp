@@ -0,0 +1,124 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include "AstCache.h"
+#include "Batch.h"
+#include "Jit.h"
+#include "Lexer.h"
+#include "pointer.h"
+#include "Prelude.h"
+
+/**
+ * \file batch_main.cpp
+ * \brief command line front end of the batch runner
+ *
+ * usage: msdscript-batch [--interp | --print | --pretty-print] [--jit] [--ast-cache dir] [--prelude file
+ *                        [--prelude-snapshot file]] [-j threads] [file]
+ *
+ * Reads one expression per line from the file, or from standard input when no file is given, and writes one
+ * result per line in the same order. Exits with 1 if any expression raised an error and 2 on bad arguments.
+ * --jit compiles functions that are called often to native code. --ast-cache keeps the parsed form of every
+ * expression in the directory, so later runs load the expressions they already saw instead of parsing them.
+ * --prelude evaluates a file of _let bindings once, and every expression can use its definitions. With
+ * --prelude-snapshot the evaluated prelude is saved to that file, and later runs with the same prelude restore it
+ * from there instead of evaluating it again.
+ */
+
+
+/**
+ * \brief Prints how to call the program
+ */
+static void usage() {
+    std::cerr << "usage: msdscript-batch [--interp | --print | --pretty-print] [--jit] [--ast-cache dir] "
+                 "[--prelude file [--prelude-snapshot file]] [-j threads] [file]" << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+    batch_mode_t mode = batch_interp;
+    int threads = 0;
+    std::string path;
+    std::string cache_directory;
+    std::string prelude_path;
+    std::string snapshot_path;
+
+    for ( int i = 1; i < argc; i++ ) {
+        std::string arg = argv[i];
+
+        if ( arg == "--interp" ) {
+            mode = batch_interp;
+        } else if ( arg == "--print" ) {
+            mode = batch_print;
+        } else if ( arg == "--pretty-print" ) {
+            mode = batch_pretty_print;
+        } else if ( arg == "--jit" ) {
+            set_jit_enabled(true);
+        } else if ( arg == "--ast-cache" && i + 1 < argc ) {
+            cache_directory = argv[++i];
+        } else if ( arg == "--prelude" && i + 1 < argc ) {
+            prelude_path = argv[++i];
+        } else if ( arg == "--prelude-snapshot" && i + 1 < argc ) {
+            snapshot_path = argv[++i];
+        } else if ( arg == "-j" && i + 1 < argc ) {
+            threads = std::atoi(argv[++i]);
+        } else if ( arg.compare(0, 2, "-j") == 0 && arg.size() > 2 ) {
+            threads = std::atoi(arg.c_str() + 2);
+        } else if ( arg == "--help" ) {
+            usage();
+            return 0;
+        } else if ( arg.size() > 1 && arg[0] == '-' ) {
+            usage();
+            return 2;
+        } else if ( path.empty()) {
+            path = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    std::ios::sync_with_stdio(false);
+
+#if USE_ALLOC_STATS
+    alloc_stats_reset();
+#endif
+
+    try {
+        std::unique_ptr<AstCache> ast_cache;
+        if ( !cache_directory.empty()) {
+            ast_cache.reset(new AstCache(cache_directory));
+        }
+
+        std::unique_ptr<Prelude> prelude;
+        if ( !prelude_path.empty()) {
+            MappedFile file(prelude_path);
+            prelude.reset(new Prelude(file.view(), snapshot_path));
+        }
+
+        BatchRunner runner(mode, threads, 64, ast_cache.get(), prelude.get());
+        size_t failures;
+
+        if ( path.empty() || path == "-" ) {
+            std::stringstream input;
+            input << std::cin.rdbuf();
+            std::string text = input.str();
+            failures = runner.run(split_records(text), std::cout);
+        } else {
+            MappedFile file(path);
+            failures = runner.run(split_records(file.view()), std::cout);
+        }
+
+#if USE_ALLOC_STATS
+        //the workers share the counters, so there is one report for the whole batch
+        std::cerr << alloc_stats_report() << std::endl;
+#endif
+
+        return failures == 0 ? 0 : 1;
+
+    } catch ( const std::exception &error ) {
+        std::cerr << "msdscript-batch: " << error.what() << std::endl;
+        return 2;
+    }
+}
@@ -0,0 +1,399 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include "parse.hpp"
+#include "Expr.h"
+#include "Val.h"
+#include "Arena.h"
+#include "Bytecode.h"
+#include "CEK.h"
+#include "Optimizer.h"
+#include "Resolver.h"
+#include "TypeChecker.h"
+#include "Jit.h"
+#include "Scheduler.h"
+#include "FlatAst.h"
+#include "AstCache.h"
+#include "Prelude.h"
+
+/**
+ * \file bench_main.cpp
+ * \brief benchmarks for parsing, evaluation and printing
+ *
+ * usage: msdscript-bench [--min-time=ms] [filter...]
+ *
+ * Every benchmark runs on a generated workload, doubling the number of iterations until one batch takes at least
+ * the minimum time, 200ms by default. Only benchmarks whose name contains one of the filters are run.
+ *
+ * The pointer mode is picked when building, for example qmake MSDscriptBench.pro "DEFINES+=USE_ARENA_POINTERS=1".
+ * Allocations are counted by replacing the global operator new, so objects placed in an arena do not show up,
+ * only the heap allocations that remain.
+ *
+ * \author Josh Barton
+ */
+
+
+static std::atomic<size_t> allocations(0); ///< calls to operator new so far
+static std::atomic<size_t> allocated_bytes(0); ///< bytes asked for by those calls
+
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if ( p == nullptr ) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+
+static size_t sink = 0; ///< results are folded in here so no benchmark can be skipped by the compiler
+
+static std::vector<std::string> filters; ///< benchmarks to run, all of them when empty
+
+static double min_time_ms = 200; ///< shortest batch that counts as a measurement
+
+
+/**
+ * \brief Returns the name of the n-th generated variable, a0 would not lex so names are letters only
+ * @param n - the index of the variable
+ * @return - a, b, ..., z, ba, bb, ...
+ */
+static std::string variable_name(int n) {
+    std::string name;
+    do {
+        name.insert(name.begin(), (char) ('a' + n % 26));
+        n /= 26;
+    } while ( n > 0 );
+    return name;
+}
+
+
+/**
+ * \brief (1 + (2 * (3 + ... ))) nested depth levels deep
+ * @param depth - number of parenthesized levels
+ * @return - the program text
+ */
+static std::string deep_nesting(int depth) {
+    std::string text;
+    for ( int i = 0; i < depth; i++ ) {
+        text += "(" + std::to_string(i) + (i % 2 == 0 ? " + " : " * ");
+    }
+    text += "1";
+    text.append(depth, ')');
+    return text;
+}
+
+
+/**
+ * \brief 0 + 1 * 2 + 3 * ... without any parentheses
+ * @param length - number of terms
+ * @return - the program text
+ */
+static std::string long_chain(int length) {
+    std::string text = "0";
+    for ( int i = 1; i < length; i++ ) {
+        text += (i % 2 == 0 ? " + " : " * ") + std::to_string(i);
+    }
+    return text;
+}
+
+
+/**
+ * \brief A _let for every variable, each one built from the one before
+ * @param count - number of _let expressions
+ * @return - the program text
+ */
+static std::string many_lets(int count) {
+    std::string text;
+    for ( int i = 0; i < count; i++ ) {
+        text += "_let " + variable_name(i) + " = ";
+        text += i == 0 ? "1" : variable_name(i - 1) + " + " + std::to_string(i);
+        text += " _in ";
+    }
+    text += variable_name(count - 1);
+    return text;
+}
+
+
+/**
+ * \brief A balanced tree of _if, ==, + and * with 2^depth leaves
+ * @param depth - height of the tree
+ * @return - the program text
+ */
+static std::string balanced_tree(int depth) {
+    if ( depth == 0 ) {
+        return "x";
+    }
+    std::string sub = balanced_tree(depth - 1);
+    switch ( depth % 3 ) {
+        case 0:
+            return "(_if " + sub + " == 0 _then " + sub + " _else 1)";
+        case 1:
+            return "(" + sub + " + " + sub + ")";
+        default:
+            return "(" + sub + " * " + sub + ")";
+    }
+}
+
+
+/**
+ * \brief A prelude of helper functions, each one calling the one before, followed by the program that is ignored
+ * @param count - number of helpers
+ * @return - the prelude text, ending in "_in 0"
+ */
+static std::string library(int count) {
+    std::string text;
+    for ( int i = 0; i < count; i++ ) {
+        text += "_let " + variable_name(i) + " = _fun (x) ";
+        text += i == 0 ? "x + 1" : variable_name(i - 1) + "(x * 2 + -1)";
+        text += " _in ";
+    }
+    return text + "0";
+}
+
+
+static const std::string factorial =
+        "_let fact = _fun (f) _fun (n) _if n == 0 _then 1 _else n * f(f)(n + -1) _in fact(fact)(20)";
+
+static const std::string fibonacci =
+        "_let fib = _fun (f) _fun (n) _if n == 0 _then 0 _else _if n == 1 _then 1 _else f(f)(n + -1) + f(f)(n + -2) "
+        "_in fib(fib)(18)";
+
+//builds two closures per step and composes them
+static const std::string closures =
+        "_let compose = _fun (f) _fun (g) _fun (x) f(g(x)) _in "
+        "_let adder = _fun (n) _fun (x) x + n _in "
+        "_let loop = _fun (loop) _fun (n) _fun (acc) "
+        "_if n == 0 _then acc _else loop(loop)(n + -1)(compose(adder(n))(adder(1))(acc)) _in "
+        "loop(loop)(1000)(0)";
+
+
+/**
+ * \brief Times a benchmark and prints one line for it
+ *
+ * Every iteration runs inside an ArenaScope on the same arena, so in arena mode the cost of resetting it is part
+ * of the measurement. In gc mode every iteration ends with a safepoint, so the collections are part of it too.
+ * @param name - the name of the benchmark, matched against the filters
+ * @param op - one iteration
+ */
+static void run_benchmark(const std::string &name, const std::function<void()> &op) {
+    if ( !filters.empty()) {
+        bool selected = false;
+        for ( const std::string &filter : filters ) {
+            selected = selected || name.find(filter) != std::string::npos;
+        }
+        if ( !selected ) {
+            return;
+        }
+    }
+
+    Arena arena;
+    size_t iterations = 1;
+
+    while ( true ) {
+        size_t allocations_before = allocations;
+        size_t bytes_before = allocated_bytes;
+        auto start = std::chrono::steady_clock::now();
+
+        for ( size_t i = 0; i < iterations; i++ ) {
+            ArenaScope scope(arena);
+            op();
+#if USE_GC_POINTERS
+            GcHeap::current().safepoint();
+#endif
+        }
+
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if ( elapsed >= min_time_ms * 1e6 || iterations >= ((size_t) 1 << 30)) {
+            printf("%-28s %10zu %14.0f %12.1f %14.0f\n", name.c_str(), iterations, elapsed / (double) iterations,
+                   (double) (allocations - allocations_before) / (double) iterations,
+                   (double) (allocated_bytes - bytes_before) / (double) iterations);
+            fflush(stdout);
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+
+/**
+ * \brief Adds the parse benchmark for one generated program
+ * @param name - what the program stresses
+ * @param text - the program
+ */
+static void bench_parse(const std::string &name, const std::string &text) {
+    run_benchmark("parse/" + name, [&] {
+        sink += parse_str(text)->hash;
+    });
+    run_benchmark("parse_flat/" + name, [&] {
+        sink += parse_flat(text).nodes.size();
+    });
+
+    //only the first iteration parses, every later one loads the file it wrote
+    AstCache cache((std::filesystem::temp_directory_path() / "msdscript-bench-ast").string());
+    run_benchmark("parse_cached/" + name, [&] {
+        sink += cache.parse(text)->hash;
+    });
+}
+
+
+/**
+ * \brief Adds the evaluation benchmarks for one program, on every engine
+ *
+ * The program is parsed, optimized, resolved and compiled once, only evaluation is timed.
+ * @param name - what the program stresses
+ * @param text - the program
+ */
+static void bench_eval(const std::string &name, const std::string &text) {
+    PTR(Expr) parsed = parse_str(text);
+    Optimizer optimizer;
+    Resolver resolver;
+    PTR(Expr) program = resolver.resolve(optimizer.optimize(parsed));
+    Compiler compiler;
+    std::shared_ptr<FunctionProto> proto = compiler.compile(parsed);
+
+    run_benchmark("interp/" + name, [&] {
+        sink += program->interp()->to_string().size();
+    });
+
+    //the same tree again, with the checks the TypeChecker proved unneeded left out
+    TypeChecker checker;
+    PTR(Expr) typed = resolver.resolve(optimizer.optimize(parsed));
+    checker.check(typed);
+    run_benchmark("typed/" + name, [&] {
+        sink += typed->interp()->to_string().size();
+    });
+    set_jit_enabled(true);
+    run_benchmark("jit/" + name, [&] {
+        sink += program->interp()->to_string().size();
+    });
+    set_jit_enabled(false);
+    run_benchmark("cek/" + name, [&] {
+        sink += cek_interp(program)->to_string().size();
+    });
+    //the same machine suspended and resumed every 100 steps
+    run_benchmark("sched/" + name, [&] {
+        Scheduler scheduler(100);
+        size_t id = scheduler.spawn(program);
+        scheduler.run();
+        sink += scheduler.result(id)->to_string().size();
+    });
+    run_benchmark("vm/" + name, [&] {
+        VM vm;
+        sink += vm.run(proto)->to_string().size();
+    });
+    FlatAst flat = parse_flat(text);
+    run_benchmark("flat/" + name, [&] {
+        sink += flat.interp()->to_string().size();
+    });
+}
+
+
+/**
+ * \brief Adds the start-up benchmarks for a short program that uses a prelude
+ *
+ * Once with the prelude written in front of the program, so it is parsed and evaluated every time, and once with
+ * the program evaluated in the environment restored from the prelude's snapshot.
+ * @param name - what the prelude holds
+ * @param text - the prelude, ending in "_in 0"
+ * @param program - the program
+ */
+static void bench_prelude(const std::string &name, const std::string &text, const std::string &program) {
+    std::string prepended = text.substr(0, text.size() - 1) + "(" + program + ")";
+    run_benchmark("prelude_prepended/" + name, [&] {
+        Optimizer optimizer;
+        Resolver resolver;
+        sink += resolver.resolve(optimizer.optimize(parse_str(prepended)))->interp()->to_string().size();
+    });
+
+    Prelude prelude(text);
+    run_benchmark("prelude_restored/" + name, [&] {
+        Optimizer optimizer;
+        Resolver resolver;
+        PTR(Env) env = prelude.restore();
+        sink += resolver.resolve(optimizer.optimize(parse_str(program)))->interp(env)->to_string().size();
+    });
+}
+
+
+/**
+ * \brief Adds the printing benchmarks for one generated program
+ * @param name - what the program stresses
+ * @param text - the program
+ */
+static void bench_print(const std::string &name, const std::string &text) {
+    PTR(Expr) e = parse_str(text);
+
+    run_benchmark("to_string/" + name, [&] {
+        sink += e->to_string().size();
+    });
+    run_benchmark("to_string_pretty/" + name, [&] {
+        sink += e->to_string_pretty().size();
+    });
+
+    FlatAst flat = parse_flat(text);
+    run_benchmark("flat_to_string/" + name, [&] {
+        sink += flat.to_string().size();
+    });
+}
+
+
+int main(int argc, char *argv[]) {
+    for ( int i = 1; i < argc; i++ ) {
+        std::string arg = argv[i];
+        if ( arg.compare(0, 11, "--min-time=") == 0 ) {
+            min_time_ms = std::atof(arg.c_str() + 11);
+        } else {
+            filters.push_back(arg);
+        }
+    }
+
+#if USE_ARENA_POINTERS
+    const char *mode = "arena";
+#elif USE_PLAIN_POINTERS
+    const char *mode = "plain";
+#elif USE_GC_POINTERS
+    const char *mode = "gc";
+#else
+    const char *mode = "shared_ptr";
+#endif
+    printf("msdscript benchmarks, %s pointers\n", mode);
+    printf("%-28s %10s %14s %12s %14s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+
+    //the workloads are made before any ArenaScope, so in arena mode they live in the global arena
+    bench_parse("deep_nesting", deep_nesting(2000));
+    bench_parse("long_chain", long_chain(20000));
+    bench_parse("many_lets", many_lets(2000));
+
+    bench_eval("factorial", factorial);
+    bench_eval("fibonacci", fibonacci);
+    bench_eval("closures", closures);
+
+    bench_prelude("library", library(500), "a(3) + b(4)");
+
+    bench_print("many_lets", many_lets(2000));
+    bench_print("balanced_tree", balanced_tree(14));
+
+    //keeps the results alive without printing them
+    return sink == 42 ? 1 : 0;
+}
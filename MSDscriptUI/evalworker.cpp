@@ -0,0 +1,84 @@
+#include "evalworker.h"
+#include "Arena.h"
+#include "Cancel.h"
+#include <iostream>
+
+
+//constructor
+EvalWorker::EvalWorker(const std::atomic<bool> &stop, QObject *parent) : QObject{parent}, stop(stop)
+{
+}
+
+
+
+void EvalWorker::evaluate(const QString &text, bool pretty_print) {
+
+    //convert the QString into a normal string
+    std::string str_to_be_parsed = text.toUtf8().constData();
+
+    QString result_to_display;
+
+    //set by the handlers, the signal is emitted once what the evaluation left is collected
+    bool was_cancelled = false;
+    QString error_message;
+    bool was_failed = false;
+
+#if USE_ALLOC_STATS
+    alloc_stats_reset();
+#endif
+
+    try {
+
+        //everything made while parsing and evaluating is freed together at the end of this block
+        ArenaScope arena_scope;
+
+        //every function call checks the flag the cancel button and the timeout set, and that recursion leaves
+        //some of the stack unused, so a program that never stops recursing fails instead of crashing the window
+        CancelScope cancel_scope(stop, stack_size - 8 * 1024 * 1024);
+
+        //the cache parses the text again only if it changed, and keeps its nodes outside of this arena
+        if ( pretty_print ) {
+
+            result_to_display = QString::fromStdString(cache.pretty_print(str_to_be_parsed));
+
+        } else {
+
+            //closed parts that were evaluated earlier come from the cache, the rest is simplified, resolved and
+            //evaluated
+            result_to_display = QString::fromStdString(cache.interp(str_to_be_parsed));
+
+        }
+
+    } catch ( const EvalCancelled & ) {
+
+        was_cancelled = true;
+
+    } catch ( const std::exception &error ) {
+
+        error_message = QString::fromStdString(error.what());
+        was_failed = true;
+
+    }
+
+#if USE_GC_POINTERS
+    //nothing the evaluation made is reachable any more, whether it finished, failed or was cancelled
+    GcHeap::current().collect();
+#endif
+
+    if ( was_cancelled ) {
+        emit cancelled();
+        return;
+    }
+    if ( was_failed ) {
+        emit failed(error_message);
+        return;
+    }
+
+#if USE_ALLOC_STATS
+    //after the arena scope, so anything still live outlived the evaluation
+    std::cerr << alloc_stats_report() << std::endl;
+#endif
+
+    emit finished(result_to_display);
+
+}
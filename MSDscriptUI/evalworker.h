@@ -0,0 +1,50 @@
+#ifndef EVALWORKER_H
+#define EVALWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include "EvalCache.h"
+
+/**
+ * \brief Parses and evaluates programs on the thread it is moved to, so the window never waits for them
+ *
+ * Results come back through signals. Setting the stop flag ends the running evaluation at its next function call.
+ */
+class EvalWorker : public QObject
+{
+    Q_OBJECT
+
+
+public:
+
+    //the thread the worker is moved to needs this much stack, interp() recurses once per nested expression and call
+    static const unsigned int stack_size = 64 * 1024 * 1024;
+
+    explicit EvalWorker(const std::atomic<bool> &stop, QObject *parent = nullptr);
+
+
+public slots:
+
+    void evaluate(const QString &text, bool pretty_print);
+
+
+signals:
+
+    void finished(const QString &result);
+
+    void failed(const QString &message);
+
+    void cancelled();
+
+
+private:
+
+    const std::atomic<bool> &stop;
+
+    //parses and values from earlier evaluations, so resubmitting an edited program only redoes what changed
+    EvalCache cache;
+
+};
+
+#endif // EVALWORKER_H
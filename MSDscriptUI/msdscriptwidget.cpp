@@ -1,7 +1,4 @@
 #include "msdscriptwidget.h"
-#include "parse.hpp"
-#include "Expr.h"
-#include "Val.h"
 
 
 //constructor
@@ -20,6 +17,11 @@ MSDscriptWidget::MSDscriptWidget(QWidget *parent) : QWidget{parent}
     interp_button = new QRadioButton("Interp");
     print_button = new QRadioButton("Pretty Print");
     submit_button = new QPushButton("Submit");
+    cancel_button = new QPushButton("Cancel");
+    run_layout = new QHBoxLayout;
+    timeout_label = new QLabel("Timeout (s):");
+    timeout_box = new QSpinBox;
+    status_label = new QLabel;
     result_box = new QGridLayout;
     result_label = new QLabel("Result:");
     result_text = new QTextEdit;
@@ -38,6 +40,24 @@ MSDscriptWidget::MSDscriptWidget(QWidget *parent) : QWidget{parent}
     reset_button->setMinimumWidth(button_width);
     reset_button->setMaximumWidth(button_width);
 
+    cancel_button->setMinimumWidth(button_width);
+    cancel_button->setMaximumWidth(button_width);
+    cancel_button->setEnabled(false);
+
+
+    //0 means no timeout
+    timeout_box->setRange(0, 3600);
+    timeout_box->setValue(10);
+    timeout_box->setSpecialValueText("none");
+
+
+    //submit, cancel and the timeout share a row
+    run_layout->addWidget(submit_button);
+    run_layout->addWidget(cancel_button);
+    run_layout->addWidget(timeout_label);
+    run_layout->addWidget(timeout_box);
+    run_layout->addStretch();
+
 
     //set the text box sizes
     expression_text->setMinimumWidth(text_box_width);
@@ -57,10 +77,11 @@ MSDscriptWidget::MSDscriptWidget(QWidget *parent) : QWidget{parent}
     main_layout->addWidget(expression_label, 0, 0);
     main_layout->addWidget(expression_text, 0, 2);
     main_layout->addWidget(radio_buttons_box, 1, 2);
-    main_layout->addWidget(submit_button, 2, 2);
+    main_layout->addLayout(run_layout, 2, 2);
     main_layout->addWidget(result_label, 3, 0);
     main_layout->addWidget(result_text, 3, 2);
     main_layout->addWidget(reset_button, 4, 2);
+    main_layout->addWidget(status_label, 5, 2);
 
 
     //set the layout
@@ -75,6 +96,45 @@ MSDscriptWidget::MSDscriptWidget(QWidget *parent) : QWidget{parent}
     connect(reset_button, &QPushButton::clicked, this, &MSDscriptWidget::resetWindow);
 
 
+    //connect cancelEvaluation to click
+    connect(cancel_button, &QPushButton::clicked, this, &MSDscriptWidget::cancelEvaluation);
+
+
+    //tick while an evaluation runs
+    running = false;
+    timed_out = false;
+    stop_flag = false;
+    progress_timer = new QTimer(this);
+    progress_timer->setInterval(100);
+    connect(progress_timer, &QTimer::timeout, this, &MSDscriptWidget::updateProgress);
+
+
+    //the worker lives on its own thread, signals between the two are queued
+    worker = new EvalWorker(stop_flag);
+    worker->moveToThread(&worker_thread);
+    connect(&worker_thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(this, &MSDscriptWidget::evaluationRequested, worker, &EvalWorker::evaluate);
+    connect(worker, &EvalWorker::finished, this, &MSDscriptWidget::showResult);
+    connect(worker, &EvalWorker::failed, this, &MSDscriptWidget::showError);
+    connect(worker, &EvalWorker::cancelled, this, &MSDscriptWidget::showCancelled);
+
+    //give deep programs more than the default stack
+    worker_thread.setStackSize(EvalWorker::stack_size);
+    worker_thread.start();
+
+
+}
+
+
+
+//destructor
+MSDscriptWidget::~MSDscriptWidget() {
+
+    //stop a running evaluation at its next call, then wait for the thread so the worker is not destroyed under it
+    stop_flag = true;
+    worker_thread.quit();
+    worker_thread.wait();
+
 }
 
 
@@ -106,41 +166,134 @@ void MSDscriptWidget::calculateResult() {
 
 
 
-    if ( expression != nullptr && type_of_operation != "none" ) {
+    if ( expression != nullptr && type_of_operation != "none" && !running ) {
+
+
+        //the worker sends the result back through a signal
+        stop_flag = false;
+        timed_out = false;
+        running = true;
+
+        submit_button->setEnabled(false);
+        cancel_button->setEnabled(true);
+        status_label->setText("Running...");
+
+        elapsed_timer.start();
+        progress_timer->start();
+
+        emit evaluationRequested(expression, type_of_operation == "Print");
+
+    }
+
+
+
+}
+
+
+
+void MSDscriptWidget::cancelEvaluation() {
+
+
+    //the worker notices at its next function call and answers with cancelled
+    if ( running ) {
+
+        stop_flag = true;
+        status_label->setText("Cancelling...");
 
+    }
+
+
+
+}
 
-        //parse the expression string
-        PTR(Expr) obj = parse_str( str_to_be_parsed );
 
-        QString result_to_display;
 
-        if ( type_of_operation == "Print" ) {
+void MSDscriptWidget::updateProgress() {
 
-            //convert the object into a string
-            result_to_display = QString::fromStdString(obj->to_string_pretty());
 
-        } else {
+    qint64 elapsed = elapsed_timer.elapsed();
 
-            result_to_display = QString::fromStdString(obj->interp()->to_string());
+    if ( stop_flag ) {
+        return;
+    }
 
-        }
+    status_label->setText(QString("Running... %1 s").arg(elapsed / 1000.0, 0, 'f', 1));
 
+    //a timeout of 0 means no limit
+    int timeout = timeout_box->value();
 
+    if ( timeout > 0 && elapsed >= timeout * 1000 ) {
 
-        //display result in the result text area
-        result_text->setPlainText(result_to_display);
+        timed_out = true;
+        cancelEvaluation();
 
     }
 
 
 
+}
+
+
+
+void MSDscriptWidget::showResult(const QString &result) {
+
+
+    //display result in the result text area
+    result_text->setPlainText(result);
+    finishEvaluation("Finished in %1 s");
+
+
+
+}
+
+
+
+void MSDscriptWidget::showError(const QString &message) {
+
+
+    result_text->setPlainText("error: " + message);
+    finishEvaluation("Failed after %1 s");
+
+
+
+}
+
+
+
+void MSDscriptWidget::showCancelled() {
+
+
+    result_text->clear();
+    finishEvaluation(timed_out ? "Timed out after %1 s" : "Cancelled after %1 s");
+
+
+
+}
+
+
+
+void MSDscriptWidget::finishEvaluation(const QString &status) {
+
+
+    progress_timer->stop();
+    running = false;
+
+    submit_button->setEnabled(true);
+    cancel_button->setEnabled(false);
+    status_label->setText(status.arg(elapsed_timer.elapsed() / 1000.0, 0, 'f', 2));
+
+
+
 }
 
 void MSDscriptWidget::resetWindow() {
 
 
+    cancelEvaluation();
+
     expression_text->clear();
     result_text->clear();
+    status_label->clear();
 
     //to clear the radio buttons
     QList <QRadioButton *> listRadioButtons = radio_buttons_box->findChildren<QRadioButton *>();
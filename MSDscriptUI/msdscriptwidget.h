@@ -3,6 +3,8 @@
 
 #include <QWidget>
 #include <QtWidgets>
+#include <atomic>
+#include "evalworker.h"
 
 class MSDscriptWidget : public QWidget
 {
@@ -13,6 +15,8 @@ public:
 
     explicit MSDscriptWidget(QWidget *parent = nullptr);
 
+    ~MSDscriptWidget();
+
 
 private:
 
@@ -25,6 +29,11 @@ private:
     QRadioButton *interp_button;
     QRadioButton *print_button;
     QPushButton *submit_button;
+    QPushButton *cancel_button;
+    QHBoxLayout *run_layout;
+    QLabel *timeout_label;
+    QSpinBox *timeout_box;
+    QLabel *status_label;
     QGridLayout *result_box;
     QLabel *result_label;
     QTextEdit *result_text;
@@ -32,6 +41,19 @@ private:
     QSpacerItem *horizontalSpacer1;
     QSpacerItem *horizontalSpacer2;
 
+    //evaluation runs on its own thread so the window stays responsive, the flag stops it
+    QThread worker_thread;
+    EvalWorker *worker;
+    std::atomic<bool> stop_flag;
+
+    //shows the elapsed time while an evaluation runs and enforces the timeout
+    QTimer *progress_timer;
+    QElapsedTimer elapsed_timer;
+    bool running;
+    bool timed_out;
+
+    void finishEvaluation(const QString &status);
+
 
 private slots:
 
@@ -39,10 +61,21 @@ private slots:
 
     void resetWindow();
 
+    void cancelEvaluation();
+
+    void updateProgress();
+
+    void showResult(const QString &result);
+
+    void showError(const QString &message);
+
+    void showCancelled();
+
 
 
 signals:
 
+    void evaluationRequested(const QString &text, bool pretty_print);
 
 };
 
@@ -1,452 +1,588 @@
 #include <iostream>
-#include <cctype>
 #include "parse.hpp"
+#include "Cancel.h"
+#include "ExprTable.h"
+#include "FlatAst.h"
 
 
 /**
  * \file parse.cpp
  * \brief contains functions that parse input into the correct expression objects
  *
+ * The source is split into tokens by tokenize() first, the recursive descent functions then only look at tokens.
+ * They are templates over the builder that makes the nodes, an ExprBuilder for Expr trees and a FlatAst for the
+ * array form, so both come from the same grammar.
+ *
  * \author Josh Barton
  */
 
 
 /**
- * \brief Function that consumes a character from the input stream
- * @param in - stream of characters
- * @param expect - the character we expect to be consumed
+ * \brief Makes Expr nodes for the parser, through the current ExprTable when there is one
  */
-static void consume(std::istream &in, int expect) {
-    int c = in.get();
+struct ExprBuilder {
+    typedef PTR (Expr)node_t;
+
+    ExprTable *table; ///< the table that shares repeated subtrees, nullptr for plain nodes
+
+    node_t num(int n) {
+        return table ? table->num(n) : NEW (NumExpr)(n);
+    }
+
+    node_t boolean(bool b) {
+        return table ? table->boolean(b) : NEW (BoolExpr)(b);
+    }
+
+    node_t var(symbol_t name) {
+        return table ? table->var(name) : NEW (VarExpr)(name);
+    }
+
+    node_t add(node_t lhs, node_t rhs) {
+        return table ? table->add(lhs, rhs) : NEW (AddExpr)(lhs, rhs);
+    }
+
+    node_t mult(node_t lhs, node_t rhs) {
+        return table ? table->mult(lhs, rhs) : NEW (MultExpr)(lhs, rhs);
+    }
+
+    node_t eq(node_t lhs, node_t rhs) {
+        return table ? table->eq(lhs, rhs) : NEW (EqExpr)(lhs, rhs);
+    }
+
+    node_t let(symbol_t name, node_t rhs, node_t body) {
+        return table ? table->let(name, rhs, body) : NEW (LetExpr)(name, rhs, body);
+    }
+
+    node_t if_expr(node_t ifExpr, node_t thenExpr, node_t elseExpr) {
+        return table ? table->if_expr(ifExpr, thenExpr, elseExpr) : NEW (IfExpr)(ifExpr, thenExpr, elseExpr);
+    }
+
+    node_t fun(symbol_t formal_arg, node_t body) {
+        return table ? table->fun(formal_arg, body) : NEW (FunExpr)(formal_arg, body);
+    }
+
+    node_t call(node_t to_be_called, node_t actual_arg) {
+        return table ? table->call(to_be_called, actual_arg) : NEW (CallExpr)(to_be_called, actual_arg);
+    }
+};
+
+
+template<class Builder>
+static typename Builder::node_t parse_expr(TokenCursor &in, Builder &build);
+
+template<class Builder>
+static typename Builder::node_t parse_multicand(TokenCursor &in, Builder &build);
 
-    if ( c != expect ) {
+template<class Builder>
+static typename Builder::node_t parse_inner(TokenCursor &in, Builder &build);
+
+template<class Builder>
+static typename Builder::node_t parse_let(TokenCursor &in, Builder &build);
+
+template<class Builder>
+static typename Builder::node_t parse_if(TokenCursor &in, Builder &build);
+
+template<class Builder>
+static typename Builder::node_t parse_fun(TokenCursor &in, Builder &build);
+
+
+/**
+ * \brief Function that consumes a token
+ * @param in - position in the token array
+ * @param expect - the kind of token we expect to be consumed
+ */
+static void consume(TokenCursor &in, token_kind_t expect) {
+    if ( in.next->kind != expect ) {
         throw std::runtime_error("consume mismatch");
     }
+    in.next++;
 }
 
 
 /**
- * \brief Function that consumes a specific keyword which is a string
- * @param in - stream of characters
- * @param expected - the string we are expecting to consume
+ * \brief Returns the precedence of a binary operator token
+ * @param kind - the token
+ * @return - the precedence, prec_none if the token is not a binary operator
  */
-static void consume_keyword(std::istream &in, std::string expected) {
+static precedence_t binary_precedence(token_kind_t kind) {
+    switch ( kind ) {
+        case tok_eqeq:
+            return prec_eq;
+        case tok_plus:
+            return prec_add;
+        case tok_star:
+            return prec_mult;
+        default:
+            return prec_none;
+    }
+}
 
-    for ( char c: expected ) {
 
-        if ( c == in.peek()) {
-            consume(in, c);
-        } else {
-            throw std::runtime_error("consume mismatch");
-        }
+/**
+ * \brief Builds the expression for one binary operator
+ * @param op - the precedence of the operator, which identifies it
+ * @param lhs - left hand side
+ * @param rhs - right hand side
+ * @param build - makes the node
+ * @return - returns an EqExpr, AddExpr or MultExpr object
+ */
+template<class Builder>
+static typename Builder::node_t make_binary(precedence_t op, typename Builder::node_t lhs,
+                                            typename Builder::node_t rhs, Builder &build) {
+    if ( op == prec_eq ) {
+        return build.eq(lhs, rhs);
+    } else if ( op == prec_add ) {
+        return build.add(lhs, rhs);
+    } else {
+        return build.mult(lhs, rhs);
     }
 }
 
 
 /**
- * \brief Skip_whitespace function skips any space in the input stream
+ * \brief Parses a chain of binary operators without recursing once per operator
  *
- * Utilizes the consume function to consume the space characters in the input stream
- * @param in - stream of characters
+ * Precedence climbing with explicit stacks, so a generated sum of any length only grows two vectors. Every
+ * operator is right associative, 1 + 2 + 3 is 1 + (2 + 3), the same shapes the recursive grammar builds.
+ * @param in - position in the token array
+ * @param min_precedence - operators below this one end the chain
+ * @param build - makes the nodes
+ * @return - returns an expression object
  */
-void skip_whitespace(std::istream &in) {
+template<class Builder>
+static typename Builder::node_t parse_binary(TokenCursor &in, precedence_t min_precedence, Builder &build) {
+    std::vector<typename Builder::node_t> operands;
+    std::vector<precedence_t> operators;
+
+    operands.push_back(parse_multicand(in, build));
+
     while ( true ) {
-        int c = in.peek();
+        if ( in.next->kind == tok_equals && min_precedence <= prec_eq ) {
+            //a single = where == was expected
+            throw std::runtime_error("consume mismatch");
+        }
 
-        if ( !isspace(c)) {
+        precedence_t op = binary_precedence(in.next->kind);
+        if ( op == prec_none || op < min_precedence ) {
             break;
         }
-        consume(in, c);
+        in.next++;
+
+        //operators that bind tighter than op are complete, equal ones stay to group to the right
+        while ( !operators.empty() && operators.back() > op ) {
+            typename Builder::node_t rhs = operands.back();
+            operands.pop_back();
+            operands.back() = make_binary(operators.back(), operands.back(), rhs, build);
+            operators.pop_back();
+        }
+
+        operators.push_back(op);
+        operands.push_back(parse_multicand(in, build));
+    }
+
+    while ( !operators.empty()) {
+        typename Builder::node_t rhs = operands.back();
+        operands.pop_back();
+        operands.back() = make_binary(operators.back(), operands.back(), rhs, build);
+        operators.pop_back();
     }
+
+    return operands.back();
 }
 
 
 /**
  * \brief This function parses an expression object
- * @param in - stream of characters
+ * @param in - position in the token array
+ * @param build - makes the nodes
  * @return - returns an expression object
  */
-PTR (Expr)parse_expr(std::istream &in) {
-    PTR (Expr)e = parse_comparg(in);
-
-    skip_whitespace(in);
-
-    int firstEquals = in.peek();
-    int secondEquals = in.peek();
-
-    if ( firstEquals == '=' && secondEquals == '=' ) {
-        consume_keyword(in, "==");
-        skip_whitespace(in);
-        PTR (Expr)rhs = parse_expr(in);
-        return NEW (EqExpr)(e, rhs);
-    } else {
-        return e;
-    }
+template<class Builder>
+static typename Builder::node_t parse_expr(TokenCursor &in, Builder &build) {
+    //every nested _let, _if, _fun and parenthesis comes through here, so a stack budget bounds the parser too
+    check_cancelled();
+    return parse_binary(in, prec_eq, build);
 }
 
 
 /**
- * \brief This function parses a comparsion object and checks for addition between expressions
- * @param in - stream of characters
+ * \brief This function parses a multiplication object and checks to see if a CallExpr function needs to be created
+ *
+ * The ( of a call has to follow the function directly, f (1) is not a call
+ * @param in - position in the token array
+ * @param build - makes the nodes
  * @return - returns an expression object
  */
-PTR (Expr)parse_comparg(std::istream &in) {
-    PTR (Expr)e = parse_addend(in);
-
-    skip_whitespace(in);
-
-    int c = in.peek();
-    if ( c == '+' ) {
-        consume(in, '+');
-        skip_whitespace(in);
-        PTR (Expr)rhs = parse_comparg(in);
-        e = NEW (AddExpr)(e, rhs);
+template<class Builder>
+static typename Builder::node_t parse_multicand(TokenCursor &in, Builder &build) {
+    typename Builder::node_t e = parse_inner(in, build);
+
+    while ( in.next->kind == tok_lparen && !in.next->after_space ) {
+        consume(in, tok_lparen);
+        typename Builder::node_t actual_arg = parse_expr(in, build);
+        consume(in, tok_rparen);
+        e = build.call(e, actual_arg);
     }
+
     return e;
 }
 
 
 /**
- * \brief This function parses an addition object and checks for multiplication between expressions
- * @param in - stream of characters
- * @return - returns an expression object
+ * \brief This function parses a number token into a NumExpr object
+ * @param in - position in the token array
+ * @param build - makes the node
+ * @return - returns a NumExpr object
  */
-PTR (Expr)parse_addend(std::istream &in) {
-    PTR (Expr)e = parse_multicand(in);
-
-    skip_whitespace(in);
-    int c = in.peek();
-    if ( c == '*' ) {
-        consume(in, '*');
-        skip_whitespace(in);
-        PTR (Expr)rhs = parse_addend(in);
-        return NEW (MultExpr)(e, rhs);
-    } else {
-        return e;
-    }
+template<class Builder>
+static typename Builder::node_t parse_num(TokenCursor &in, Builder &build) {
+    int n = in.next->num;
+    consume(in, tok_num);
+    return build.num(n);
 }
 
 
 /**
- * \brief This function parses a multiplication object and checks to see if a CallExpr function needs to be created
- * @param in - stream of characters
- * @return - returns an expression object
+ * \brief This function parses a variable token and creates a VarExpr object of that variable
+ * @param in - position in the token array
+ * @param build - makes the node
+ * @return - returns a VarExpr object with the desired variable
  */
-PTR (Expr)parse_multicand(std::istream &in) {
-    PTR (Expr)e = parse_inner(in);
-
-    while ( in.peek() == '(' ) {
-        consume(in, '(');
-        PTR (Expr)actual_arg = parse_expr(in);
-        consume(in, ')');
-        e = NEW (CallExpr)(e, actual_arg);
+template<class Builder>
+static typename Builder::node_t parse_variable(TokenCursor &in, Builder &build) {
+    if ( in.next->kind != tok_var ) {
+        throw std::runtime_error("invalid input");
     }
 
-    return e;
+    symbol_t name = in.next->name;
+    consume(in, tok_var);
+    return build.var(name);
 }
 
 
 /**
- * \brief This function parses all the inner expressions that are nested inside the overall starting expression
- * @param in - stream of characters
- * @return - returns an expression object
+ * \brief This function parses the keyword _true or _false into a BoolExpr object
+ * @param in - position in the token array
+ * @param build - makes the node
+ * @return - returns a BoolExpr object
  */
-PTR (Expr)parse_inner(std::istream &in) {
-    skip_whitespace(in);
-
-    std::string kw;
-
-    int c = in.peek();
-    if ((c == '-') || isdigit(c)) {
-        return parse_num(in);
-    } else if ( c == '(' ) {
-        consume(in, '(');
-        PTR (Expr)e = parse_expr(in);
-        skip_whitespace(in);
-        c = in.peek();
-        if ( c != ')' ) {
-            throw std::runtime_error("missing close parenthesis");
-        } else {
-            consume(in, ')');
-        }
-        return e;
-
-    } else if ( isalpha(c)) {
-        return parse_variable(in);
-    } else if ( c == '_' ) {
-        consume(in, '_');
-        kw = peek_keyword(in);
-
-        if ( kw == "_let" ) {
-            return parse_let(in);
-        } else if ( kw == "_true" || kw == "_false" ) {
-            return parse_bool(in, kw);
-        } else if ( kw == "_if" ) {
-            return parse_if(in);
-        } else if ( kw == "_fun" ) {
-            return parse_fun(in);
-        } else {
-            throw std::runtime_error("invalid input");
-        }
+template<class Builder>
+static typename Builder::node_t parse_bool(TokenCursor &in, Builder &build) {
+    if ( in.next->kind == tok_true ) {
+        consume(in, tok_true);
+        return build.boolean(true);
+    } else if ( in.next->kind == tok_false ) {
+        consume(in, tok_false);
+        return build.boolean(false);
     } else {
-        consume(in, c);
-        throw std::runtime_error("invalid input");
+        throw std::runtime_error("keyword is not a bool");
     }
 }
 
 
 /**
- * \brief This function parses a number from the input stream into a NumExpr object
- * @param in - stream of characters
- * @return - returns a NumExpr object
+ * \brief This function parses all the inner expressions that are nested inside the overall starting expression
+ * @param in - position in the token array
+ * @param build - makes the nodes
+ * @return - returns an expression object
  */
-PTR (Expr)parse_num(std::istream &in) {
+template<class Builder>
+static typename Builder::node_t parse_inner(TokenCursor &in, Builder &build) {
+
+    switch ( in.next->kind ) {
+        case tok_num:
+            return parse_num(in, build);
+
+        case tok_lparen: {
+            consume(in, tok_lparen);
+            typename Builder::node_t e = parse_expr(in, build);
+            if ( in.next->kind != tok_rparen ) {
+                throw std::runtime_error("missing close parenthesis");
+            }
+            consume(in, tok_rparen);
+            return e;
+        }
+
+        case tok_var:
+            return parse_variable(in, build);
+
+        case tok_let:
+            return parse_let(in, build);
+
+        case tok_true:
+        case tok_false:
+            return parse_bool(in, build);
 
-    int n = 0;
-    bool negative = false;
+        case tok_if:
+            return parse_if(in, build);
 
-    if ( in.peek() == '-' ) {
-        negative = true;
-        consume(in, '-');
+        case tok_fun:
+            return parse_fun(in, build);
 
-        if ( !isdigit(in.peek())) {
+        default:
             throw std::runtime_error("invalid input");
-        }
     }
+}
 
-    while ( true ) {
-        int c = in.peek();
 
-        if ( isdigit(c)) {
-            consume(in, c);
-            n = n * 10 + (c - '0');
-        } else
-            break;
+/**
+ * \brief This function parses the keyword _let and everything after the let into a LetExpr object
+ * @param in - position in the token array
+ * @param build - makes the nodes
+ * @return - returns a LetExpr object
+ */
+template<class Builder>
+static typename Builder::node_t parse_let(TokenCursor &in, Builder &build) {
+    consume(in, tok_let);
+
+    if ( in.next->kind != tok_var ) {
+        throw std::runtime_error("invalid input");
     }
+    symbol_t name = in.next->name;
+    consume(in, tok_var);
 
-    if ( negative ) {
-        n = -n;
+    if ( in.next->kind != tok_equals ) {
+        throw std::runtime_error("invalid input");
     }
+    consume(in, tok_equals);
+    typename Builder::node_t rhs = parse_expr(in, build);
 
-    return NEW (NumExpr)(n);
+    if ( in.next->kind != tok_in ) {
+        throw std::runtime_error("invalid input");
+    }
+    consume(in, tok_in);
+    typename Builder::node_t body = parse_expr(in, build);
 
+    return build.let(name, rhs, body);
 }
 
 
 /**
- * \brief This function parses a variable from a string and creates a VarExpr object of that variable
- * @param in - stream of characters
- * @return - returns a VarExpr object with the desired variable
+ * \brief This function parses the keyword _if and turns the information after the _if into an IfExpr object
+ * @param in - position in the token array
+ * @param build - makes the nodes
+ * @return - returns an IfExpr object
  */
-PTR (Expr)parse_variable(std::istream &in) {
-    skip_whitespace(in);
+template<class Builder>
+static typename Builder::node_t parse_if(TokenCursor &in, Builder &build) {
+    consume(in, tok_if);
+    typename Builder::node_t ifExpr = parse_expr(in, build);
 
-    std::string s;
+    consume(in, tok_then);
+    typename Builder::node_t thenExpr = parse_expr(in, build);
 
-    while ( true ) {
-        char c = in.peek();
-
-        if ( isalpha(c)) {
-            consume(in, c);
-            s += c;
-        } else {
-            if ( in.peek() == '_' || in.peek() == '-' ) {
-                throw std::runtime_error("invalid input");
-            }
-            break;
-        }
-    }
+    consume(in, tok_else);
+    typename Builder::node_t elseExpr = parse_expr(in, build);
 
-    return NEW (VarExpr)(s);
+    return build.if_expr(ifExpr, thenExpr, elseExpr);
 }
 
 
 /**
- * \brief This function parses the keyword _let and everything after the let into a LetExpr object
- * @param in - stream of characters
- * @return - returns a LetExpr object
+ * \brief This function parses the keyword _fun and take the information following the _fun keyword and creates a FunExpr object
+ * @param in - position in the token array
+ * @param build - makes the nodes
+ * @return - returns a FunExpr object
  */
-PTR (Expr)parse_let(std::istream &in) {
-    skip_whitespace(in);
-    std::string kw;
-
-    PTR (Expr)variable;
-    PTR (Expr)rhs;
-    PTR (Expr)body;
-
-    int c = in.peek();
-    if ( c == 'l' ) {
-        consume_keyword(in, "let");
-        skip_whitespace(in);
-        variable = parse_variable(in);
+template<class Builder>
+static typename Builder::node_t parse_fun(TokenCursor &in, Builder &build) {
+    consume(in, tok_fun);
+    consume(in, tok_lparen);
+
+    //the formal argument may be left empty
+    symbol_t formal_arg = intern("");
+    if ( in.next->kind == tok_var ) {
+        formal_arg = in.next->name;
+        consume(in, tok_var);
     }
 
-    skip_whitespace(in);
+    consume(in, tok_rparen);
 
-    if ( in.peek() == '=' ) {
-        consume(in, '=');
-        skip_whitespace(in);
-        rhs = parse_expr(in);
-    }
-
-    skip_whitespace(in);
+    typename Builder::node_t body = parse_expr(in, build);
+    return build.fun(formal_arg, body);
+}
 
-    if ( in.peek() == '_' ) {
-        consume(in, '_');
-        consume_keyword(in, "in");
-        skip_whitespace(in);
-        body = parse_expr(in);
-    }
 
-    return NEW (LetExpr)(CAST (VarExpr)(variable)->value, rhs, body);
+/**
+ * \brief This function parses an expression object
+ * @param in - position in the token array
+ * @return - returns an expression object
+ */
+PTR (Expr)parse_expr(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_expr(in, build);
 }
 
 
 /**
- * \brief This function parses the keyword _true or _false into a BoolExpr object
- * @param in - stream of characters
- * @param kw - takes the keyword as a parameter
- * @return - returns a BoolExpr object
+ * \brief This function parses a comparsion object and checks for addition between expressions
+ * @param in - position in the token array
+ * @return - returns an expression object
  */
-PTR (Expr)parse_bool(std::istream &in, std::string &kw) {
-    skip_whitespace(in);
-
-    if ( kw == "_true" ) {
-        consume_keyword(in, "true");
-        return NEW (BoolExpr)(true);
-    } else if ( kw == "_false" ) {
-        consume_keyword(in, "false");
-        return NEW (BoolExpr)(false);
-    } else {
-        throw std::runtime_error("keyword is not a bool");
-    }
+PTR (Expr)parse_comparg(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_binary(in, prec_add, build);
 }
 
 
 /**
- * \brief This function parses the keyword _if and turns the information after the _if into an IfExpr object
- * @param in - stream of characters
- * @return - returns an IfExpr object
+ * \brief This function parses an addition object and checks for multiplication between expressions
+ * @param in - position in the token array
+ * @return - returns an expression object
  */
-PTR (Expr)parse_if(std::istream &in) {
-    skip_whitespace(in);
-
-    PTR (Expr)ifExpr;
-    PTR (Expr)thenExpr;
-    PTR (Expr)elseExpr;
+PTR (Expr)parse_addend(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_binary(in, prec_mult, build);
+}
 
-    if ( in.peek() == 'i' ) {
-        consume_keyword(in, "if");
-        skip_whitespace(in);
-        ifExpr = parse_expr(in);
-    }
 
-    skip_whitespace(in);
-    consume(in, '_');
+/**
+ * \brief This function parses a multiplication object and checks to see if a CallExpr function needs to be created
+ * @param in - position in the token array
+ * @return - returns an expression object
+ */
+PTR (Expr)parse_multicand(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_multicand(in, build);
+}
 
-    if ( in.peek() == 't' ) {
-        consume_keyword(in, "then");
-        skip_whitespace(in);
-        thenExpr = parse_expr(in);
-    }
 
-    skip_whitespace(in);
-    consume(in, '_');
+/**
+ * \brief This function parses all the inner expressions that are nested inside the overall starting expression
+ * @param in - position in the token array
+ * @return - returns an expression object
+ */
+PTR (Expr)parse_inner(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_inner(in, build);
+}
 
-    if ( in.peek() == 'e' ) {
-        consume_keyword(in, "else");
-        skip_whitespace(in);
-        elseExpr = parse_expr(in);
-    }
 
-    return NEW (IfExpr)(ifExpr, thenExpr, elseExpr);
+/**
+ * \brief This function parses a number token into a NumExpr object
+ * @param in - position in the token array
+ * @return - returns a NumExpr object
+ */
+PTR (Expr)parse_num(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_num(in, build);
 }
 
 
 /**
- * \brief This function parses the keyword _fun and take the information following the _fun keyword and creates a FunExpr object
- * @param in - stream of characters
- * @return - returns a FunExpr object
+ * \brief This function parses a variable token and creates a VarExpr object of that variable
+ * @param in - position in the token array
+ * @return - returns a VarExpr object with the desired variable
  */
-PTR (Expr)parse_fun(std::istream &in) {
-    skip_whitespace(in);
+PTR (Expr)parse_variable(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_variable(in, build);
+}
 
-    std::string formal_arg;
-    PTR (Expr)body;
 
-    consume_keyword(in, "fun");
+/**
+ * \brief This function parses the keyword _let and everything after the let into a LetExpr object
+ * @param in - position in the token array
+ * @return - returns a LetExpr object
+ */
+PTR (Expr)parse_let(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_let(in, build);
+}
 
-    skip_whitespace(in);
-    consume(in, '(');
 
-    //consume the formal_arg
-    while ( true ) {
-        char c = in.peek();
-
-        if ( isalpha(c)) {
-            consume(in, c);
-            formal_arg += c;
-        } else {
-            //exception
-            if ( in.peek() == '_' || in.peek() == '-' ) {
-                throw std::runtime_error("invalid input");
-            }
-            break;
-        }
-    }
-
-    skip_whitespace(in);
-    consume(in, ')');
+/**
+ * \brief This function parses the keyword _true or _false into a BoolExpr object
+ * @param in - position in the token array
+ * @return - returns a BoolExpr object
+ */
+PTR (Expr)parse_bool(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_bool(in, build);
+}
 
-    body = parse_expr(in);
 
-    return NEW (FunExpr)(formal_arg, body);
+/**
+ * \brief This function parses the keyword _if and turns the information after the _if into an IfExpr object
+ * @param in - position in the token array
+ * @return - returns an IfExpr object
+ */
+PTR (Expr)parse_if(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_if(in, build);
 }
 
 
 /**
- * \brief This function checks the input stream to determine what the keyword is next in the input stream
- * @param in - stream of characters
- * @return - returns a string that contains the keyword that is next in the stream of characters
+ * \brief This function parses the keyword _fun and creates a FunExpr object
+ * @param in - position in the token array
+ * @return - returns a FunExpr object
  */
-std::string peek_keyword(std::istream &in) {
-    skip_whitespace(in);
-
-    std::string keyword;
-
-    int c = in.peek();
-
-    if ( c == 'l' ) {
-        keyword = "_let";
-    } else if ( c == 'i' ) {
-        keyword = "_if";
-    } else if ( c == 't' ) {
-        keyword = "_true";
-    } else if ( c == 'f' ) {
-        consume(in, 'f');
-        int nextCharacter = in.peek();
-
-        if ( nextCharacter == 'a' ) {
-            keyword = "_false";
-        } else {
-            keyword = "_fun";
-        }
+PTR (Expr)parse_fun(TokenCursor &in) {
+    ExprBuilder build = {ExprTable::current()};
+    return parse_fun(in, build);
+}
 
-        in.putback(c);
 
-    }
+/**
+ * \brief This function parses a string and returns an Expr object equivalent to the string
+ *
+ * Anything after the first complete expression is ignored
+ * @param s - a string of the desired Expr objects to be created
+ * @return - returns an expression object
+ */
+PTR (Expr)parse_str(std::string_view s) {
+    std::vector<Token> tokens = tokenize(s);
 
-    return keyword;
+    //share repeated subtrees, the table only lives for this parse
+    ExprTableScope table_scope;
+    TokenCursor cursor = {tokens.data()};
+    return parse_expr(cursor);
 }
 
 
 /**
- * \brief This function parses a string and returns an Expr object equivalent to the string
+ * \brief Parses a string into a table that outlives the parse
+ *
+ * Subtrees that are already in the table come back as the same nodes, so parsing an edited program again shares
+ * every part that did not change with the previous parse
  * @param s - a string of the desired Expr objects to be created
+ * @param table - the table the nodes are looked up in and added to
  * @return - returns an expression object
  */
-PTR (Expr)parse_str(std::string s) {
-    std::istringstream string_stream(s);
-    return parse_expr(string_stream);
+PTR (Expr)parse_str(std::string_view s, ExprTable &table) {
+    std::vector<Token> tokens = tokenize(s);
+
+    ExprTableScope table_scope(table);
+    TokenCursor cursor = {tokens.data()};
+    return parse_expr(cursor);
+}
+
+
+/**
+ * \brief This function parses a whole file, which is memory-mapped instead of copied into a string
+ * @param path - the file to parse
+ * @return - returns an expression object
+ */
+PTR (Expr)parse_file(const std::string &path) {
+    MappedFile file(path);
+    return parse_str(file.view());
 }
 
+
+/**
+ * \brief Parses a string straight into the array form, without making any Expr objects
+ *
+ * Anything after the first complete expression is ignored
+ * @param s - the program
+ * @return - the program with its variables resolved
+ */
+FlatAst parse_flat(std::string_view s) {
+    std::vector<Token> tokens = tokenize(s);
+
+    FlatAst program;
+    TokenCursor cursor = {tokens.data()};
+    program.root = parse_expr(cursor, program);
+    program.resolve();
+    return program;
+}
@@ -1,48 +1,58 @@
-
 #ifndef parse_hpp
 #define parse_hpp
 
-#include <stdio.h>
+#include <string>
+#include <string_view>
 #include "Expr.h"
+#include "Lexer.h"
 #include "pointer.h"
 
+class ExprTable;
+
+class FlatAst;
+
 /**
  * \file parse.hpp
  * \brief contains the functions in the parse.cpp file
  *
  */
 
-static void consume(std::istream &in, int expect);
+/**
+ * \brief The position of the parser in a token array
+ */
+struct TokenCursor {
+    const Token *next; ///< the next token to parse, the array always ends with tok_end
+};
 
-static void consume_keyword(std::istream &in, std::string expected);
+PTR (Expr)parse_expr(TokenCursor &in);
 
-void skip_whitespace(std::istream &in);
+PTR (Expr)parse_comparg(TokenCursor &in);
 
-PTR (Expr)parse_expr(std::istream &in);
+PTR (Expr)parse_addend(TokenCursor &in);
 
-PTR (Expr)parse_comparg(std::istream &in);
+PTR (Expr)parse_inner(TokenCursor &in);
 
-PTR (Expr)parse_addend(std::istream &in);
+PTR (Expr)parse_multicand(TokenCursor &in);
 
-PTR (Expr)parse_inner(std::istream &in);
+PTR (Expr)parse_num(TokenCursor &in);
 
-PTR (Expr)parse_multicand(std::istream &in);
+PTR (Expr)parse_variable(TokenCursor &in);
 
-PTR (Expr)parse_num(std::istream &in);
+PTR (Expr)parse_let(TokenCursor &in);
 
-PTR (Expr)parse_variable(std::istream &in);
+PTR (Expr)parse_bool(TokenCursor &in);
 
-PTR (Expr)parse_let(std::istream &in);
+PTR (Expr)parse_if(TokenCursor &in);
 
-PTR (Expr)parse_bool(std::istream &in, std::string &kw);
+PTR (Expr)parse_fun(TokenCursor &in);
 
-PTR (Expr)parse_if(std::istream &in);
+PTR (Expr)parse_str(std::string_view s);
 
-PTR (Expr)parse_fun(std::istream &in);
+PTR (Expr)parse_str(std::string_view s, ExprTable &table);
 
-std::string peek_keyword(std::istream &in);
+PTR (Expr)parse_file(const std::string &path);
 
-PTR (Expr)parse_str(std::string s);
+FlatAst parse_flat(std::string_view s);
 
 
 #endif
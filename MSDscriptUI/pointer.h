@@ -7,10 +7,63 @@
 
 #include <memory>
 
+// Pick at most one of these, either here or with -D on the compiler command line.
+//  USE_PLAIN_POINTERS  raw new, nothing is ever freed
+//  USE_ARENA_POINTERS  raw pointers into the current Arena, freed a whole program at a time by ArenaScope
+//  USE_GC_POINTERS     raw pointers, Val and Env freed by the mark-sweep collector of Gc.h, the rest as in arena mode
+//  (none)              std::shared_ptr reference counting
+// USE_ALLOC_STATS can be added to any of them, NEW(T) then counts objects per class, see AllocStats.h
+#ifndef USE_PLAIN_POINTERS
 #define USE_PLAIN_POINTERS 0
-#if USE_PLAIN_POINTERS
+#endif
+
+#ifndef USE_ARENA_POINTERS
+#define USE_ARENA_POINTERS 0
+#endif
+
+#ifndef USE_GC_POINTERS
+#define USE_GC_POINTERS 0
+#endif
+
+#ifndef USE_ALLOC_STATS
+#define USE_ALLOC_STATS 0
+#endif
+
+#if USE_ARENA_POINTERS
+
+# include "Arena.h"
+
+# if USE_ALLOC_STATS
+#  define NEW(T)   counted_arena_new<T>
+# else
+#  define NEW(T)   arena_new<T>
+# endif
+# define PTR(T)    T*
+# define CAST(T)   dynamic_cast<T*>
+# define CLASS(T)  class T
+# define THIS      this
 
-# define NEW(T)    new T
+#elif USE_PLAIN_POINTERS
+
+# if USE_ALLOC_STATS
+#  define NEW(T)   counted_new<T>
+# else
+#  define NEW(T)   new T
+# endif
+# define PTR(T)    T*
+# define CAST(T)   dynamic_cast<T*>
+# define CLASS(T)  class T
+# define THIS      this
+
+#elif USE_GC_POINTERS
+
+# include "Gc.h"
+
+# if USE_ALLOC_STATS
+#  define NEW(T)   counted_gc_new<T>
+# else
+#  define NEW(T)   gc_new<T>
+# endif
 # define PTR(T)    T*
 # define CAST(T)   dynamic_cast<T*>
 # define CLASS(T)  class T
@@ -18,7 +71,11 @@
 
 #else
 
-# define NEW(T)    std::make_shared<T>
+# if USE_ALLOC_STATS
+#  define NEW(T)   counted_make_shared<T>
+# else
+#  define NEW(T)   std::make_shared<T>
+# endif
 # define PTR(T)    std::shared_ptr<T>
 # define CAST(T)   std::dynamic_pointer_cast<T>
 # define CLASS(T)  class T : public std::enable_shared_from_this<T>
@@ -26,4 +83,15 @@
 
 #endif
 
-#endif
\ No newline at end of file
+// the root of a class hierarchy the collector owns in the gc mode, CLASS(T) in the other modes
+#if USE_GC_POINTERS
+# define GC_CLASS(T) class T : public GcObject
+#else
+# define GC_CLASS(T) CLASS(T)
+#endif
+
+#if USE_ALLOC_STATS
+# include "AllocStats.h"
+#endif
+
+#endif
@@ -0,0 +1,204 @@
+#!/bin/sh
+#
+# Regression tests for msdscript-batch
+#
+# usage: run_tests.sh path/to/msdscript-batch
+#
+# Runs the programs in this directory through every mode of the batch runner and compares the output with the
+# .expected files next to them. The AST cache and the prelude snapshot are also checked with damaged files, which
+# have to be ignored and written again. Exits with 1 if any test failed.
+
+if [ $# -ne 1 ] || [ ! -x "$1" ]; then
+    echo "usage: $0 path/to/msdscript-batch" >&2
+    exit 2
+fi
+
+case "$1" in
+    /*) batch="$1" ;;
+    *) batch="$(pwd)/$1" ;;
+esac
+tests="$(cd "$(dirname "$0")" && pwd)"
+work="$(mktemp -d "${TMPDIR:-/tmp}/msdscript-tests.XXXXXX")" || exit 2
+trap 'rm -rf "$work"' EXIT
+cd "$work" || exit 2
+
+passed=0
+failed=0
+
+
+#compares the output of the last run with the expected output and exit status
+#  check name expected-file expected-status
+check() {
+    if [ "$status" -ne "$3" ]; then
+        echo "FAIL $1: exit status $status, expected $3"
+        failed=$((failed + 1))
+    elif ! cmp -s "$2" out; then
+        echo "FAIL $1: output differs from $(basename "$2")"
+        diff "$2" out | head -20
+        failed=$((failed + 1))
+    else
+        passed=$((passed + 1))
+    fi
+}
+
+
+#checks that damaged files were written again, the same as the undamaged ones
+#  rewritten name expected actual
+rewritten() {
+    if diff -r "$2" "$3" > /dev/null; then
+        passed=$((passed + 1))
+    else
+        echo "FAIL $1: not written again"
+        failed=$((failed + 1))
+    fi
+}
+
+
+#runs the batch runner on its arguments, with the output in out
+run() {
+    "$batch" "$@" > out 2> err
+    status=$?
+}
+
+
+#overwrites one byte of a file
+#  poke file offset
+poke() {
+    printf 'X' | dd of="$1" bs=1 seek="$2" conv=notrunc 2> /dev/null
+}
+
+
+#damages every file of a directory, or a single file, in one of several ways, the body starts after the 40 byte
+#header of a cached program
+#  damage how path...
+damage() {
+    how=$1
+    shift
+    for file in "$@"; do
+        size=$(wc -c < "$file")
+        case "$how" in
+            empty) : > "$file" ;;
+            garbage) cp "$tests/prelude.txt" "$file" ;;
+            header) head -c 20 "$file" > part && mv part "$file" ;;
+            half) head -c $((size / 2)) "$file" > part && mv part "$file" ;;
+            magic) poke "$file" 0 ;;
+            version) poke "$file" 4 ;;
+            body) poke "$file" $((40 + (size - 40) / 2)) ;;
+            last) poke "$file" $((size - 1)) ;;
+        esac
+    done
+}
+
+damages="empty garbage header half magic version body last"
+
+
+#evaluation, printing and the JIT
+for threads in 1 4; do
+    run -j $threads "$tests/programs.txt"
+    check "interp -j $threads" "$tests/programs.expected" 1
+    run --jit -j $threads "$tests/programs.txt"
+    check "jit -j $threads" "$tests/programs.expected" 1
+done
+run --print "$tests/programs.txt"
+check "print" "$tests/programs.print.expected" 1
+run --pretty-print "$tests/programs.txt"
+check "pretty-print" "$tests/programs.pretty.expected" 1
+run < "$tests/programs.txt"
+check "standard input" "$tests/programs.expected" 1
+
+
+#many chunks, which have to come out in input order
+awk 'BEGIN { for ( i = 1; i <= 1000; i++ ) print i " * " i }' > many.txt
+awk 'BEGIN { for ( i = 1; i <= 1000; i++ ) print i * i }' > many.expected
+run -j 8 many.txt
+check "many records" many.expected 0
+
+
+#records deeper than the recursive passes handle, evaluated on the CEK machine and printed iteratively
+awk 'BEGIN { n = 20000; s = ""; for ( i = 0; i < n; i++ ) s = s "(1+"; s = s "1"; for ( i = 0; i < n; i++ ) s = s ")";
+             print s }' > deep.txt
+echo 20001 > deep.expected
+run deep.txt
+check "deep interp" deep.expected 0
+run --jit deep.txt
+check "deep jit" deep.expected 0
+run --print deep.txt
+check "deep print" deep.txt 0
+
+
+#the AST cache, empty, filled and damaged
+run --ast-cache cache "$tests/programs.txt"
+check "ast-cache cold" "$tests/programs.expected" 1
+if [ "$(ls cache | grep -c '\.msdast$')" -eq 0 ]; then
+    echo "FAIL ast-cache cold: no files written"
+    failed=$((failed + 1))
+fi
+run --ast-cache cache "$tests/programs.txt"
+check "ast-cache warm" "$tests/programs.expected" 1
+run --ast-cache cache --jit "$tests/programs.txt"
+check "ast-cache warm jit" "$tests/programs.expected" 1
+run --ast-cache cache --print "$tests/programs.txt"
+check "ast-cache warm print" "$tests/programs.print.expected" 1
+run --ast-cache cache --pretty-print "$tests/programs.txt"
+check "ast-cache warm pretty-print" "$tests/programs.pretty.expected" 1
+
+for how in $damages; do
+    rm -rf damaged && cp -r cache damaged
+    damage "$how" damaged/*.msdast
+    run --ast-cache damaged "$tests/programs.txt"
+    check "ast-cache $how" "$tests/programs.expected" 1
+    rewritten "ast-cache $how" cache damaged
+    run --ast-cache damaged "$tests/programs.txt"
+    check "ast-cache $how, written again" "$tests/programs.expected" 1
+done
+
+#every file holding another program
+rm -rf damaged && cp -r cache damaged
+first=$(ls damaged/*.msdast | head -1)
+for file in damaged/*.msdast; do
+    cp "$first" "$file.copy" && mv "$file.copy" "$file"
+done
+run --ast-cache damaged "$tests/programs.txt"
+check "ast-cache other program" "$tests/programs.expected" 1
+rewritten "ast-cache other program" cache damaged
+
+
+#the prelude, evaluated, snapshotted and restored
+run --prelude "$tests/prelude.txt" "$tests/prelude_programs.txt"
+check "prelude" "$tests/prelude_programs.expected" 1
+run --prelude "$tests/prelude.txt" --jit -j 4 "$tests/prelude_programs.txt"
+check "prelude jit" "$tests/prelude_programs.expected" 1
+run --prelude "$tests/prelude.txt" --prelude-snapshot prelude.snap "$tests/prelude_programs.txt"
+check "prelude-snapshot cold" "$tests/prelude_programs.expected" 1
+if [ ! -s prelude.snap ]; then
+    echo "FAIL prelude-snapshot cold: no snapshot written"
+    failed=$((failed + 1))
+fi
+run --prelude "$tests/prelude.txt" --prelude-snapshot prelude.snap "$tests/prelude_programs.txt"
+check "prelude-snapshot warm" "$tests/prelude_programs.expected" 1
+run --prelude "$tests/prelude.txt" --prelude-snapshot prelude.snap --jit -j 4 "$tests/prelude_programs.txt"
+check "prelude-snapshot warm jit" "$tests/prelude_programs.expected" 1
+run --prelude "$tests/prelude.txt" --prelude-snapshot prelude.snap --ast-cache cache "$tests/prelude_programs.txt"
+check "prelude-snapshot with ast-cache" "$tests/prelude_programs.expected" 1
+
+for how in $damages; do
+    cp prelude.snap damaged.snap
+    damage "$how" damaged.snap
+    run --prelude "$tests/prelude.txt" --prelude-snapshot damaged.snap "$tests/prelude_programs.txt"
+    check "prelude-snapshot $how" "$tests/prelude_programs.expected" 1
+    rewritten "prelude-snapshot $how" prelude.snap damaged.snap
+    run --prelude "$tests/prelude.txt" --prelude-snapshot damaged.snap "$tests/prelude_programs.txt"
+    check "prelude-snapshot $how, written again" "$tests/prelude_programs.expected" 1
+done
+
+#a snapshot of another prelude
+sed 's/base = 100/base = 200/' "$tests/prelude.txt" > other.txt
+rm -f damaged.snap
+run --prelude other.txt --prelude-snapshot damaged.snap "$tests/prelude_programs.txt"
+run --prelude "$tests/prelude.txt" --prelude-snapshot damaged.snap "$tests/prelude_programs.txt"
+check "prelude-snapshot of another prelude" "$tests/prelude_programs.expected" 1
+rewritten "prelude-snapshot of another prelude" prelude.snap damaged.snap
+
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]